@@ -0,0 +1,142 @@
+#ifndef MALL_BENCH_BENCHMARK_HPP_
+#define MALL_BENCH_BENCHMARK_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mall::bench
+{
+    struct Option
+    {
+        // 名前にこの文字列を含むケースのみ実行する
+        std::string filter;
+        // 最低計測回数と最低計測時間[s], 両方を満たすまで計測する
+        std::size_t minIterations    = 10;
+        double minTime               = 0.5;
+        std::size_t warmupIterations = 3;
+        // TextSystemのケースで使用するフォント(空ならスキップ)
+        std::string fontPath;
+        // 規模を小さくして実行する(CIのスモークテスト用)
+        bool quick = false;
+    };
+
+    struct Result
+    {
+        std::string name;
+        std::uint64_t items;  // 1回の計測で処理する要素数
+        std::size_t iterations;
+        double mean;  // [ns]
+        double median;
+        double min;
+        double max;
+        double stddev;
+    };
+
+    class Runner
+    {
+    public:
+        Runner(const Option& option)
+            : mOption(option)
+        {
+        }
+
+        const Option& option() const
+        {
+            return mOption;
+        }
+
+        bool enabled(std::string_view name) const
+        {
+            return mOption.filter.empty() || name.find(mOption.filter) != std::string_view::npos;
+        }
+
+        // funcを1回の計測単位として繰り返し実行する
+        template <typename Func>
+        void run(std::string_view name, const std::uint64_t items, Func&& func)
+        {
+            if (!enabled(name))
+                return;
+
+            for (std::size_t i = 0; i < mOption.warmupIterations; ++i)
+                func();
+
+            std::vector<double> samples;
+            samples.reserve(mOption.minIterations);
+
+            double total = 0;
+            while (samples.size() < mOption.minIterations || total < mOption.minTime * 1e9)
+            {
+                const auto begin = std::chrono::steady_clock::now();
+                func();
+                const auto end = std::chrono::steady_clock::now();
+
+                const double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+                samples.emplace_back(ns);
+                total += ns;
+            }
+
+            std::sort(samples.begin(), samples.end());
+
+            Result result;
+            result.name       = std::string(name);
+            result.items      = items;
+            result.iterations = samples.size();
+            result.mean       = total / samples.size();
+            result.median     = samples.size() % 2 ? samples[samples.size() / 2] : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2.;
+            result.min        = samples.front();
+            result.max        = samples.back();
+
+            double var = 0;
+            for (const auto& s : samples)
+                var += (s - result.mean) * (s - result.mean);
+            result.stddev = std::sqrt(var / samples.size());
+
+            std::cerr << std::left << std::setw(48) << result.name << std::right << std::fixed << std::setprecision(3)
+                      << std::setw(14) << result.median / 1e3 << " us (median, " << result.iterations << " iterations)\n";
+
+            mResults.emplace_back(std::move(result));
+        }
+
+        // CIで比較しやすいよう, 1ケース1オブジェクトのJSONで書き出す
+        void writeJSON(std::ostream& os) const
+        {
+            os << std::fixed << std::setprecision(1);
+            os << "{\n\"benchmarks\":[";
+            for (std::size_t i = 0; i < mResults.size(); ++i)
+            {
+                const auto& r = mResults[i];
+                os << (i ? ",\n" : "\n")
+                   << "{\"name\":\"" << r.name << "\""
+                   << ",\"items\":" << r.items
+                   << ",\"iterations\":" << r.iterations
+                   << ",\"mean_ns\":" << r.mean
+                   << ",\"median_ns\":" << r.median
+                   << ",\"min_ns\":" << r.min
+                   << ",\"max_ns\":" << r.max
+                   << ",\"stddev_ns\":" << r.stddev
+                   << ",\"items_per_second\":" << (r.median > 0 ? r.items * 1e9 / r.median : 0.) << "}";
+            }
+            os << "\n]\n}\n";
+        }
+
+    private:
+        Option mOption;
+        std::vector<Result> mResults;
+    };
+
+    // 最適化で計測対象が消されないようにする
+    template <typename T>
+    inline void doNotOptimize(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+}  // namespace mall::bench
+
+#endif
@@ -0,0 +1,946 @@
+#include <assimp/scene.h>
+
+#include <Mall/ComponentData/MaterialData.hpp>
+#include <Mall/ComponentData/MeshData.hpp>
+#include <Mall/ComponentData/RigidBodyData.hpp>
+#include <Mall/ComponentData/SkeletalMeshData.hpp>
+#include <Mall/ComponentData/TextData.hpp>
+#include <Mall/ComponentData/TransformData.hpp>
+#include <Mall/Engine.hpp>
+#include <Mall/Engine/GlyphAtlas.hpp>
+#include <Mall/Engine/Graphics.hpp>
+#include <Mall/Engine/JobSystem.hpp>
+#include <Mall/Engine/Physics.hpp>
+#include <Mall/Engine/ResourceBank.hpp>
+#include <Mall/Engine/SceneBVH.hpp>
+#include <Mall/Engine/SpriteBatcher.hpp>
+#include <Mall/Engine/TransformHierarchy.hpp>
+#include <Mall/Engine/TransformStore.hpp>
+#include <Mall/System/EngineBasicSystem.hpp>
+#include <Mall/Utility/CoverageExpand.hpp>
+#include <Mall/Utility/Frustum.hpp>
+#include <Mall/Utility/ParallelForEach.hpp>
+#include <Mall/Utility/SkylinePacker.hpp>
+#include <Mall/Utility/TransformMath.hpp>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <soloud.h>
+#include <soloud_wav.h>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "Benchmark.hpp"
+
+using namespace mall;
+using namespace mall::bench;
+
+namespace
+{
+    std::string caseName(std::string_view base, const std::uint64_t n)
+    {
+        return std::string(base) + "/" + std::to_string(n);
+    }
+
+    // TransformSystem::onUpdateの各処理を単体で比べる(System全体はbenchSceneで測る)
+    void benchTransformSystem(Runner& runner)
+    {
+        const std::size_t entityNum = runner.option().quick ? 10000 : 100000;
+
+        std::mt19937 rng(0);
+        std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+        std::vector<TransformData> transforms(entityNum);
+        std::vector<glm::mat4> worlds(entityNum);
+        for (auto& t : transforms)
+            t.setup(glm::vec3(dist(rng), dist(rng), dist(rng)) * 100.f, glm::vec3(dist(rng), dist(rng), dist(rng)), glm::vec3(0, -9.8f, 0), glm::vec3(1.f), glm::quat(glm::vec3(dist(rng), dist(rng), dist(rng))));
+
+        const float deltaTime = 1.f / 60.f;
+
+        runner.run(caseName("TransformSystem/integrate", entityNum), entityNum,
+                   [&]()
+                   {
+                       for (auto& transform : transforms)
+                           transform.integrate(deltaTime);
+                       doNotOptimize(transforms.data());
+                   });
+
+        runner.run(caseName("TransformSystem/worldMatrix", entityNum), entityNum,
+                   [&]()
+                   {
+                       for (std::size_t i = 0; i < entityNum; ++i)
+                       {
+                           const auto& transform = transforms[i];
+                           worlds[i]             = glm::translate(glm::mat4(1.f), transform.getPos()) * glm::toMat4(transform.getRot()) * glm::scale(transform.getScale());
+                       }
+                       doNotOptimize(worlds.data());
+                   });
+
+        runner.run(caseName("TransformSystem/worldMatrix(composeTRS)", entityNum), entityNum,
+                   [&]()
+                   {
+                       for (std::size_t i = 0; i < entityNum; ++i)
+                       {
+                           const auto& transform = transforms[i];
+                           worlds[i]             = composeTRS(transform.getPos(), transform.getRot(), transform.getScale());
+                       }
+                       doNotOptimize(worlds.data());
+                   });
+
+        // 変更が無い場合は比較だけで合成を省く
+        runner.run(caseName("TransformSystem/worldMatrix(static)", entityNum), entityNum,
+                   [&]()
+                   {
+                       for (std::size_t i = 0; i < entityNum; ++i)
+                       {
+                           auto& transform = transforms[i];
+                           if (transform.updateDirty())
+                               worlds[i] = transform.getWorld();
+                       }
+                       doNotOptimize(worlds.data());
+                   });
+
+        // TransformSystemと同じくParallelForEachで分割した場合
+        JobSystem jobSystem;
+        ParallelForEach<TransformData> integrate;
+        {
+            auto&& lmdCollect = integrate.collect();
+            for (auto& transform : transforms)
+                lmdCollect(transform);
+        }
+
+        runner.run(caseName("TransformSystem/integrate(parallel)", entityNum), entityNum,
+                   [&]()
+                   {
+                       integrate.run(jobSystem,
+                                     [deltaTime](TransformData& transform)
+                                     {
+                                         transform.integrate(deltaTime);
+                                     });
+                       doNotOptimize(transforms.data());
+                   });
+
+        // 同じ値をTransformStore(SoA)に置いた場合
+        TransformStore store;
+        for (const auto& transform : transforms)
+            store.create(transform.getPos(), transform.getVel(), transform.getAcc(), transform.getScale(), transform.getRot());
+
+        runner.run(caseName("TransformStore/integrate", entityNum), entityNum,
+                   [&]()
+                   {
+                       store.integrate(deltaTime);
+                       doNotOptimize(&store);
+                   });
+
+        runner.run(caseName("TransformStore/composeWorld", entityNum), entityNum,
+                   [&]()
+                   {
+                       store.composeWorld();
+                       doNotOptimize(store.getWorldData());
+                   });
+
+        runner.run(caseName("TransformStore/integrate(parallel)", entityNum), entityNum,
+                   [&]()
+                   {
+                       jobSystem.parallelFor(store.size(), 4096,
+                                             [&store, deltaTime](const std::size_t begin, const std::size_t end)
+                                             {
+                                                 store.integrate(deltaTime, begin, end);
+                                             });
+                       doNotOptimize(&store);
+                   });
+    }
+
+    // 1体あたりchildNum個の子を持つキャラクターを並べ, 一部だけ動かした場合の伝播
+    void benchTransformHierarchy(Runner& runner)
+    {
+        const std::size_t rootNum  = runner.option().quick ? 1000 : 10000;
+        const std::size_t childNum = 8;
+        const std::size_t nodeNum  = rootNum * (childNum + 1);
+
+        TransformHierarchy hierarchy;
+        std::vector<TransformHierarchy::NodeID> roots;
+        for (std::size_t i = 0; i < rootNum; ++i)
+        {
+            const auto root = hierarchy.create();
+            hierarchy.setLocal(root, glm::translate(glm::mat4(1.f), glm::vec3(static_cast<float>(i), 0, 0)));
+            for (std::size_t c = 0; c < childNum; ++c)
+                hierarchy.setLocal(hierarchy.create(root), glm::translate(glm::mat4(1.f), glm::vec3(0, static_cast<float>(c), 0)));
+            roots.emplace_back(root);
+        }
+        hierarchy.propagate();
+
+        runner.run(caseName("TransformHierarchy/propagate(static)", nodeNum), nodeNum,
+                   [&]()
+                   {
+                       hierarchy.propagate();
+                       doNotOptimize(&hierarchy);
+                   });
+
+        // 10%のルートを動かす
+        runner.run(caseName("TransformHierarchy/propagate(10%)", nodeNum), nodeNum,
+                   [&]()
+                   {
+                       for (std::size_t i = 0; i < rootNum; i += 10)
+                           hierarchy.setLocal(roots[i], hierarchy.getLocal(roots[i]));
+                       hierarchy.propagate();
+                       doNotOptimize(&hierarchy);
+                   });
+
+        runner.run(caseName("TransformHierarchy/propagate(all)", nodeNum), nodeNum,
+                   [&]()
+                   {
+                       for (const auto root : roots)
+                           hierarchy.setLocal(root, hierarchy.getLocal(root));
+                       hierarchy.propagate();
+                       doNotOptimize(&hierarchy);
+                   });
+    }
+
+    // RenderSystemのカリングと同じく, ローカルの境界球をワールド行列で変換して判定する
+    void benchFrustumCulling(Runner& runner)
+    {
+        const std::size_t entityNum = runner.option().quick ? 10000 : 100000;
+
+        std::mt19937 rng(0);
+        std::uniform_real_distribution<float> dist(-500.f, 500.f);
+
+        std::vector<glm::mat4> worlds(entityNum);
+        for (auto& world : worlds)
+            world = glm::translate(glm::mat4(1.f), glm::vec3(dist(rng), 0, dist(rng)));
+
+        Frustum frustum;
+        frustum.setup(glm::perspective(45.f, 16.f / 9.f, 0.1f, 1000.f) * glm::lookAtRH(glm::vec3(0, 10, 0), glm::vec3(0, 10, -1), glm::vec3(0, 1, 0)));
+
+        const glm::vec4 sphere(0, 0, 0, 2.f);
+        std::size_t visibleNum = 0;
+        runner.run(caseName("Frustum/intersects", entityNum), entityNum,
+                   [&]()
+                   {
+                       visibleNum = 0;
+                       for (const auto& world : worlds)
+                           visibleNum += frustum.intersects(world, sphere) ? 1 : 0;
+                       doNotOptimize(&visibleNum);
+                   });
+    }
+
+    // benchFrustumCullingと同じ配置をBVHに登録して判定する
+    void benchSceneBVH(Runner& runner)
+    {
+        const std::size_t entityNum = runner.option().quick ? 10000 : 100000;
+
+        std::mt19937 rng(0);
+        std::uniform_real_distribution<float> dist(-500.f, 500.f);
+
+        SceneBVH bvh;
+        std::vector<SceneBVH::ProxyID> proxies(entityNum);
+        std::vector<glm::vec3> centers(entityNum);
+        for (std::size_t i = 0; i < entityNum; ++i)
+        {
+            centers[i] = glm::vec3(dist(rng), 0, dist(rng));
+            proxies[i] = bvh.createProxy({ centers[i] - glm::vec3(2.f), centers[i] + glm::vec3(2.f) }, SceneBVH::LayerMesh);
+        }
+
+        // 構築(追加, 削除があったフレームと同じ)
+        runner.run(caseName("SceneBVH/rebuild", entityNum), entityNum,
+                   [&]()
+                   {
+                       bvh.destroyProxy(proxies[0]);
+                       proxies[0] = bvh.createProxy({ centers[0] - glm::vec3(2.f), centers[0] + glm::vec3(2.f) }, SceneBVH::LayerMesh);
+                       bvh.update();
+                       doNotOptimize(&bvh);
+                   });
+
+        // 10%を少しだけ動かす(refitのみ)
+        float offset = 0.f;
+        runner.run(caseName("SceneBVH/refit(10%)", entityNum), entityNum,
+                   [&]()
+                   {
+                       offset = offset > 0.f ? 0.f : 0.5f;
+                       for (std::size_t i = 0; i < entityNum; i += 10)
+                       {
+                           const glm::vec3 c = centers[i] + glm::vec3(offset, 0, 0);
+                           bvh.updateProxy(proxies[i], { c - glm::vec3(2.f), c + glm::vec3(2.f) });
+                       }
+                       bvh.update();
+                       doNotOptimize(&bvh);
+                   });
+
+        Frustum frustum;
+        frustum.setup(glm::perspective(45.f, 16.f / 9.f, 0.1f, 1000.f) * glm::lookAtRH(glm::vec3(0, 10, 0), glm::vec3(0, 10, -1), glm::vec3(0, 1, 0)));
+
+        std::vector<SceneBVH::ProxyID> visible;
+        visible.reserve(entityNum);
+        runner.run(caseName("SceneBVH/queryFrustum", entityNum), entityNum,
+                   [&]()
+                   {
+                       visible.clear();
+                       bvh.queryFrustum(frustum, SceneBVH::LayerAll, visible);
+                       doNotOptimize(visible.data());
+                   });
+
+        const std::size_t rayNum = 1000;
+        runner.run(caseName("SceneBVH/raycast", rayNum), rayNum,
+                   [&]()
+                   {
+                       SceneBVH::RayHit hit;
+                       std::size_t hitNum = 0;
+                       for (std::size_t i = 0; i < rayNum; ++i)
+                       {
+                           const float x = -500.f + 1000.f * static_cast<float>(i) / rayNum;
+                           hitNum += bvh.raycast(glm::vec3(x, 100.f, 0), glm::vec3(0.01f, -1.f, 0.3f), 1000.f, SceneBVH::LayerAll, hit) ? 1 : 0;
+                       }
+                       doNotOptimize(&hitNum);
+                   });
+    }
+
+    // RenderSystemのスプライト描画と同じく, 矩形を集めて並びのハッシュを取り, 1つのバッファへ転送する(ヘッドレス)
+    void benchSpriteBatcher(Runner& runner)
+    {
+        const std::size_t spriteNum = runner.option().quick ? 2000 : 20000;
+        constexpr std::size_t TextureNum = 8;
+
+        Graphics graphics(nullptr);
+        SpriteBatcher batcher(graphics, 2);
+
+        std::vector<Cutlass::HTexture> textures(TextureNum);
+        std::vector<glm::vec3> positions(spriteNum);
+        for (std::size_t i = 0; i < spriteNum; ++i)
+            positions[i] = glm::vec3(static_cast<float>(i % 64) * 16.f, static_cast<float>(i / 64) * 16.f, 0.5f);
+
+        // 同じテクスチャが64個ずつ続く並び
+        runner.run(caseName("SpriteBatcher/build", spriteNum), spriteNum,
+                   [&]()
+                   {
+                       batcher.clear();
+                       for (std::size_t i = 0; i < spriteNum; ++i)
+                       {
+                           const auto& pos = positions[i];
+                           SpriteBatcher::Vertex vertices[4] = {
+                               { pos, glm::vec2(0, 0), glm::vec4(1.f) },
+                               { pos + glm::vec3(16.f, 0, 0), glm::vec2(1.f, 0), glm::vec4(1.f) },
+                               { pos + glm::vec3(0, 16.f, 0), glm::vec2(0, 1.f), glm::vec4(1.f) },
+                               { pos + glm::vec3(16.f, 16.f, 0), glm::vec2(1.f, 1.f), glm::vec4(1.f) },
+                           };
+                           batcher.push(textures[(i / 64) % TextureNum], &textures[(i / 64) % TextureNum], vertices);
+                       }
+
+                       const auto hash = batcher.hashBatches(0);
+                       batcher.upload();
+                       doNotOptimize(&hash);
+                   });
+    }
+
+    // ResourceBankのスプライトアトラスと同じ大きさのページに, スプライト程度の大きさの矩形を詰める
+    void benchSkylinePacker(Runner& runner)
+    {
+        const std::size_t rectNum = runner.option().quick ? 1000 : 10000;
+
+        std::mt19937 rng(0);
+        std::uniform_int_distribution<std::uint32_t> dist(8, 128);
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> rects(rectNum);
+        for (auto& r : rects)
+            r = { dist(rng), dist(rng) };
+
+        std::vector<SkylinePacker> pages;
+        runner.run(caseName("SkylinePacker/insert", rectNum), rectNum,
+                   [&]()
+                   {
+                       pages.clear();
+                       for (const auto& r : rects)
+                       {
+                           std::uint32_t x = 0, y = 0;
+                           bool placed     = false;
+                           for (auto& page : pages)
+                               if ((placed = page.insert(r.first, r.second, x, y)))
+                                   break;
+
+                           if (!placed)
+                           {
+                               pages.emplace_back(ResourceBank::AtlasPageSize, ResourceBank::AtlasPageSize);
+                               pages.back().insert(r.first, r.second, x, y);
+                           }
+                       }
+                       doNotOptimize(pages.data());
+                   });
+    }
+
+    // depth段の一本鎖の骨格と, 全ボーンにキーを持つアニメーションを作る
+    std::unique_ptr<aiScene> createDeepRig(const std::size_t depth, const std::size_t keyNum, SkeletalMeshData::Skeleton& skeleton_out)
+    {
+        auto pScene = std::make_unique<aiScene>();
+
+        pScene->mNumAnimations = 1;
+        pScene->mAnimations    = new aiAnimation*[1];
+        auto pAnimation        = pScene->mAnimations[0] = new aiAnimation();
+
+        pAnimation->mDuration       = static_cast<double>(keyNum - 1);
+        pAnimation->mTicksPerSecond = 1.;
+        pAnimation->mNumChannels    = static_cast<unsigned int>(depth);
+        pAnimation->mChannels       = new aiNodeAnim*[depth];
+
+        skeleton_out.bones.resize(depth);
+        skeleton_out.boneMap.clear();
+        skeleton_out.globalInverse = glm::mat4(1.f);
+
+        aiNode* pParent = nullptr;
+        for (std::size_t i = 0; i < depth; ++i)
+        {
+            const std::string name = "bone" + std::to_string(i);
+
+            auto pNode = new aiNode(name);
+            pNode->mTransformation.a4 = 1.f;
+            if (pParent)
+            {
+                pParent->mNumChildren = 1;
+                pParent->mChildren    = new aiNode*[1];
+                pParent->mChildren[0] = pNode;
+                pNode->mParent        = pParent;
+            }
+            else
+                pScene->mRootNode = pNode;
+            pParent = pNode;
+
+            // 後ろのボーンほど線形探索が長くなるよう逆順に並べる
+            auto pChannel = pAnimation->mChannels[depth - 1 - i] = new aiNodeAnim();
+            pChannel->mNodeName                                  = aiString(name);
+            pChannel->mNumPositionKeys = pChannel->mNumRotationKeys = pChannel->mNumScalingKeys = static_cast<unsigned int>(keyNum);
+            pChannel->mPositionKeys                                 = new aiVectorKey[keyNum];
+            pChannel->mRotationKeys                                 = new aiQuatKey[keyNum];
+            pChannel->mScalingKeys                                  = new aiVectorKey[keyNum];
+            for (std::size_t k = 0; k < keyNum; ++k)
+            {
+                const double time          = static_cast<double>(k);
+                pChannel->mPositionKeys[k] = aiVectorKey(time, aiVector3D(0.f, 1.f, 0.1f * k));
+                pChannel->mRotationKeys[k] = aiQuatKey(time, aiQuaternion(aiVector3D(0.f, 0.f, 1.f), 0.05f * k));
+                pChannel->mScalingKeys[k]  = aiVectorKey(time, aiVector3D(1.f));
+            }
+
+            skeleton_out.bones[i].offset    = glm::mat4(1.f);
+            skeleton_out.bones[i].transform = glm::mat4(1.f);
+            skeleton_out.boneMap.emplace(name, static_cast<std::uint32_t>(i));
+        }
+
+        skeleton_out.scene.create(pScene.get());
+
+        return pScene;
+    }
+
+    void benchTraverseNode(Runner& runner)
+    {
+        const std::size_t keyNum = 32;
+
+        for (const std::size_t depth : {32, 128, 512})
+        {
+            const auto name = caseName("Skeleton/traverseNode", depth);
+            if (!runner.enabled(name))
+                continue;
+
+            SkeletalMeshData::Skeleton skeleton;
+            auto pScene = createDeepRig(depth, keyNum, skeleton);
+
+            std::size_t frame = 0;
+            runner.run(name, depth,
+                       [&]()
+                       {
+                           // フレームごとに異なるキー区間を引くが, 実行ごとの列は同じになる
+                           const float time = std::fmod(0.37f * frame++, static_cast<float>(keyNum - 1));
+                           skeleton.traverseNode(time, 0, pScene->mRootNode, glm::mat4(1.f), glm::mat4(1.f));
+                           doNotOptimize(skeleton.bones.data());
+                       });
+        }
+    }
+
+    // division * division頂点のグリッドをOBJで書き出す
+    std::string writeGridOBJ(const std::size_t division)
+    {
+        const auto path = (std::filesystem::temp_directory_path() / ("mall_bench_grid_" + std::to_string(division) + ".obj")).string();
+
+        std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+        for (std::size_t z = 0; z < division; ++z)
+            for (std::size_t x = 0; x < division; ++x)
+                ofs << "v " << x << " " << std::sin(0.1 * (x + z)) << " " << z << "\n";
+        for (std::size_t z = 0; z < division; ++z)
+            for (std::size_t x = 0; x < division; ++x)
+                ofs << "vt " << static_cast<double>(x) / division << " " << static_cast<double>(z) / division << "\n";
+        ofs << "vn 0 1 0\n";
+
+        // OBJのインデックスは1始まり
+        for (std::size_t z = 0; z + 1 < division; ++z)
+            for (std::size_t x = 0; x + 1 < division; ++x)
+            {
+                const std::size_t i0 = z * division + x + 1;
+                const std::size_t i1 = i0 + 1;
+                const std::size_t i2 = i0 + division;
+                const std::size_t i3 = i2 + 1;
+                ofs << "f " << i0 << "/" << i0 << "/1 " << i2 << "/" << i2 << "/1 " << i3 << "/" << i3 << "/1 " << i1 << "/" << i1 << "/1\n";
+            }
+
+        return path;
+    }
+
+    // processMeshはprivateなので, 読み込み単体とResourceBank::createの差で見る
+    void benchProcessMesh(Runner& runner)
+    {
+        const std::size_t division = runner.option().quick ? 128 : 512;
+        const std::uint64_t vertexNum = division * division;
+
+        const auto importName = caseName("Assimp/ReadFile", vertexNum);
+        const auto createName = caseName("ResourceBank/create(processMesh)", vertexNum);
+        if (!runner.enabled(importName) && !runner.enabled(createName))
+            return;
+
+        const auto path = writeGridOBJ(division);
+
+        runner.run(importName, vertexNum,
+                   [&]()
+                   {
+                       Assimp::Importer importer;
+                       doNotOptimize(importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs));
+                   });
+
+        ResourceBank resourceBank(nullptr);
+        runner.run(createName, vertexNum,
+                   [&]()
+                   {
+                       MeshData mesh;
+                       MaterialData material;
+                       resourceBank.create(path, mesh, material);
+                       doNotOptimize(mesh.meshes.data());
+                       resourceBank.clearCache(path);
+                   });
+
+        std::filesystem::remove(path);
+    }
+
+    enum class BenchWorld
+    {
+        eScene,
+    };
+
+    // ヘッドレスのエンジン上でEngineBasicSystemの各Systemをそのまま動かすシーン
+    template <typename Key, typename Common>
+    class BenchSceneSystem : public mvecs::ISystem<Key, Common>
+    {
+        SYSTEM(BenchSceneSystem, Key, Common)
+
+    public:
+        // アプリケーションを作る前に設定しておく
+        inline static std::string meshPath;
+        inline static std::size_t entityNum = 0;
+        inline static double movingRatio    = 0;  // TransformStoreに置いて毎フレーム動かす割合
+
+        virtual void onInit()
+        {
+            this->template addSystem<EngineBasicSystem<Key, Common>>(0);
+
+            for (std::size_t i = 0; i < entityNum; ++i)
+                this->template createEntity<TransformData, MeshData, MaterialData>();
+
+            auto& common      = this->common();
+            const auto moving = static_cast<std::size_t>(entityNum * movingRatio);
+            std::size_t i     = 0;
+            this->template forEach<TransformData, MeshData, MaterialData>(
+                [&](TransformData& transform, MeshData& mesh, MaterialData& material)
+                {
+                    // 256個ずつ並べる
+                    const glm::vec3 pos(static_cast<float>(i % 256) * 2.f, 0, static_cast<float>(i / 256) * 2.f);
+                    if (i < moving)
+                        transform.setup(*common.transformStore, pos, glm::vec3(0, 1.f, 0));
+                    else
+                        transform.setup(pos);
+
+                    common.resourceBank->create(meshPath, mesh, material);
+                    ++i;
+                });
+        }
+
+        virtual void onUpdate()
+        {
+        }
+
+        virtual void onEnd()
+        {
+            this->template forEach<TransformData, MeshData, MaterialData>(
+                [&](TransformData& transform, MeshData& mesh, MaterialData& material)
+                {
+                    transform.release();
+                    this->common().resourceBank->destroy(mesh, material);
+                });
+        }
+    };
+
+    // 手で写したループではなく, initializeHeadlessしたエンジンでmall::update(1フレーム分)をそのまま測る
+    void benchScene(Runner& runner)
+    {
+        using SceneSystem = BenchSceneSystem<BenchWorld, Engine>;
+
+        const std::size_t entityNum = runner.option().quick ? 1000 : 10000;
+        const auto staticName       = caseName("Scene/update(static)", entityNum);
+        const auto movingName       = caseName("Scene/update(moving)", entityNum);
+        if (!runner.enabled(staticName) && !runner.enabled(movingName))
+            return;
+
+        // 小さいメッシュ1つを全エンティティで共有する(インスタンシングの対象になる)
+        const auto path = writeGridOBJ(8);
+
+        auto&& lmdRun = [&](const std::string& name, const double movingRatio)
+        {
+            if (!runner.enabled(name))
+                return;
+
+            SceneSystem::meshPath    = path;
+            SceneSystem::entityNum   = entityNum;
+            SceneSystem::movingRatio = movingRatio;
+
+            mvecs::Application<BenchWorld, Engine> app;
+            initializeHeadless(1280, 720, app);
+            app.addWorld(BenchWorld::eScene).template addSystem<SceneSystem>(0);
+
+            // 最初のフレームでエンティティを作り, BVHへの登録等を済ませておく
+            mall::update(app);
+
+            runner.run(name, entityNum,
+                       [&]()
+                       {
+                           mall::update(app);
+                           doNotOptimize(&app.common().graphics->getFrameStats());
+                       });
+
+            app.dispatchEnd();
+            mall::update(app);
+        };
+
+        lmdRun(staticName, 0);
+        lmdRun(movingName, 1.);
+
+        std::filesystem::remove(path);
+    }
+
+    void benchTextRasterize(Runner& runner)
+    {
+        const auto name = std::string("TextData/rasterize");
+        if (!runner.enabled(name))
+            return;
+
+        if (runner.option().fontPath.empty())
+        {
+            std::cerr << "skip " << name << " (--font is not specified)\n";
+            return;
+        }
+
+        ResourceBank resourceBank(nullptr);
+
+        TextData text;
+        if (!resourceBank.create(runner.option().fontPath, text))
+            return;
+
+        const std::wstring_view str = L"The quick brown fox jumps over the lazy";
+        text.setText(str, 2048, 96);
+
+        std::vector<TextData::RGBA> writeData(text.width * text.height);
+
+        runner.run(name, str.size(),
+                   [&]()
+                   {
+                       text.rasterize(writeData.data());
+                       doNotOptimize(writeData.data());
+                   });
+
+        resourceBank.destroy(text);
+        resourceBank.clearCache(runner.option().fontPath);
+    }
+
+    // TextData/rasterizeと同じ大きさの被覆率をRGBA8に展開する(フォントは使わない)
+    void benchCoverageExpand(Runner& runner)
+    {
+        const std::size_t pixelNum = 2048 * 96;
+
+        std::mt19937 rng(0);
+        std::uniform_int_distribution<int> dist(0, 255);
+        std::vector<std::uint8_t> coverage(pixelNum);
+        for (auto& c : coverage)
+            c = static_cast<std::uint8_t>(dist(rng));
+
+        std::vector<std::uint8_t> pixels(pixelNum * 4);
+        const std::uint32_t color = GlyphAtlas::packColor(glm::vec4(1.f, 0.5f, 0.25f, 1.f));
+
+        runner.run(caseName("CoverageExpand/scalar", pixelNum), pixelNum,
+                   [&]()
+                   {
+                       expandCoverageScalar(coverage.data(), pixelNum, color, pixels.data());
+                       doNotOptimize(pixels.data());
+                   });
+
+        runner.run(caseName("CoverageExpand/simd", pixelNum), pixelNum,
+                   [&]()
+                   {
+                       expandCoverage(coverage.data(), pixelNum, color, pixels.data());
+                       doNotOptimize(pixels.data());
+                   });
+    }
+
+    // TextData/rasterizeと同じ文字列をグリフアトラスの矩形に並べる(2回目以降はアトラスに当たる)
+    void benchTextLayout(Runner& runner)
+    {
+        const auto name          = std::string("TextData/layout");
+        const auto unchangedName = std::string("TextData/updateLayout/unchanged");
+        if (!runner.enabled(name) && !runner.enabled(unchangedName))
+            return;
+
+        if (runner.option().fontPath.empty())
+        {
+            std::cerr << "skip " << name << " (--font is not specified)\n";
+            return;
+        }
+
+        Graphics graphics(nullptr);
+        GlyphAtlas glyphAtlas(graphics);
+        ResourceBank resourceBank(nullptr);
+        resourceBank.setGlyphAtlas(&glyphAtlas);
+
+        TextData text;
+        if (!resourceBank.create(runner.option().fontPath, text))
+            return;
+
+        const std::wstring_view str = L"The quick brown fox jumps over the lazy";
+        text.setText(str, 2048, 96);
+
+        if (runner.enabled(name))
+            runner.run(name, str.size(),
+                       [&]()
+                       {
+                           text.layout(glyphAtlas);
+                           glyphAtlas.flush();
+                           doNotOptimize(text.storage.get().quads.data());
+                       });
+
+        // 文字列が変わらないフレーム(毎フレームsetTextしても組み立て直さない)
+        if (runner.enabled(unchangedName))
+            runner.run(unchangedName, str.size(),
+                       [&]()
+                       {
+                           text.setText(str, 2048, 96);
+                           const bool updated = text.updateLayout(glyphAtlas);
+                           doNotOptimize(&updated);
+                       });
+
+        resourceBank.destroy(text);
+        resourceBank.clearCache(runner.option().fontPath);
+    }
+
+    // ログやチャット程度の長い文字列を折り返しながら, テキストごとにJobSystemで並列に組み立てる
+    void benchTextLayoutParallel(Runner& runner)
+    {
+        const std::size_t textNum     = runner.option().quick ? 8 : 64;
+        constexpr std::size_t CharNum = 2000;
+        const auto name               = caseName("TextData/layout/parallel", textNum);
+        if (!runner.enabled(name))
+            return;
+
+        if (runner.option().fontPath.empty())
+        {
+            std::cerr << "skip " << name << " (--font is not specified)\n";
+            return;
+        }
+
+        Graphics graphics(nullptr);
+        GlyphAtlas glyphAtlas(graphics);
+        JobSystem jobSystem;
+        ResourceBank resourceBank(nullptr);
+        resourceBank.setGlyphAtlas(&glyphAtlas);
+
+        const std::wstring_view words = L"The quick brown fox jumps over the lazy dog. ";
+        std::wstring str;
+        while (str.size() < CharNum)
+            str += words;
+        str.resize(CharNum);
+
+        std::vector<TextData> texts(textNum);
+        for (auto& text : texts)
+        {
+            if (!resourceBank.create(runner.option().fontPath, text))
+                return;
+            text.pixelHeight = 24.f;
+            text.setText(str, 800, 4096);
+        }
+
+        runner.run(name, textNum * CharNum,
+                   [&]()
+                   {
+                       jobSystem.parallelFor(texts.size(), 1,
+                                             [&](const std::size_t begin, const std::size_t end)
+                                             {
+                                                 for (std::size_t i = begin; i < end; ++i)
+                                                     texts[i].layout(glyphAtlas);
+                                             });
+                       glyphAtlas.flush();
+                       doNotOptimize(texts.front().storage.get().quads.data());
+                   });
+
+        for (auto& text : texts)
+            resourceBank.destroy(text);
+        resourceBank.clearCache(runner.option().fontPath);
+    }
+
+    void benchSoLoudMix(Runner& runner)
+    {
+        constexpr unsigned int sampleRate = 44100;
+        constexpr unsigned int blockSize  = 512;
+
+        // 1秒の正弦波
+        std::vector<float> wave(sampleRate);
+        for (std::size_t i = 0; i < wave.size(); ++i)
+            wave[i] = 0.5f * std::sin(2.f * 3.14159265f * 440.f * i / sampleRate);
+
+        for (const unsigned int voiceNum : {1u, 16u, 64u, 255u})
+        {
+            const auto name = caseName("SoLoud/mix", voiceNum);
+            if (!runner.enabled(name))
+                continue;
+
+            // Soloudはボイス配列を内部に持つため大きい
+            auto pSoloud = std::make_unique<SoLoud::Soloud>();
+            pSoloud->init(SoLoud::Soloud::CLIP_ROUNDOFF, SoLoud::Soloud::NULLDRIVER, sampleRate, blockSize);
+            pSoloud->setMaxActiveVoiceCount(voiceNum);
+
+            SoLoud::Wav wav;
+            wav.loadRawWave(wave.data(), static_cast<unsigned int>(wave.size()), static_cast<float>(sampleRate), 1, true, false);
+            wav.setLooping(true);
+
+            // 位相をずらして再生しておく
+            for (unsigned int i = 0; i < voiceNum; ++i)
+            {
+                auto handle = pSoloud->play(wav, 1.f / voiceNum);
+                pSoloud->setRelativePlaySpeed(handle, 0.5f + static_cast<float>(i) / voiceNum);
+            }
+
+            std::vector<float> buffer(blockSize * 2);
+            runner.run(name, blockSize,
+                       [&]()
+                       {
+                           pSoloud->mix(buffer.data(), blockSize);
+                           doNotOptimize(buffer.data());
+                       });
+
+            pSoloud->stopAll();
+            pSoloud->deinit();
+        }
+    }
+
+    void benchPhysics(Runner& runner)
+    {
+        const auto sizes = runner.option().quick ? std::vector<std::size_t>{256} : std::vector<std::size_t>{256, 1024, 4096};
+
+        for (const std::size_t boxNum : sizes)
+        {
+            const auto name = caseName("Physics/update", boxNum);
+            if (!runner.enabled(name))
+                continue;
+
+            Physics physics;
+
+            RigidBodyData ground;
+            physics.createBox(glm::vec3(1000.f, 1.f, 1000.f), glm::vec3(0, -1.f, 0), 0.f, ground);
+
+            // 16 x 16の層を積み上げる
+            std::vector<RigidBodyData> boxes(boxNum);
+            for (std::size_t i = 0; i < boxNum; ++i)
+            {
+                const float x = static_cast<float>(i % 16) * 2.1f;
+                const float z = static_cast<float>((i / 16) % 16) * 2.1f;
+                const float y = 1.f + static_cast<float>(i / 256) * 2.1f;
+                physics.createBox(glm::vec3(1.f), glm::vec3(x, y, z), 1.f, boxes[i]);
+            }
+
+            runner.run(name, boxNum,
+                       [&]()
+                       {
+                           physics.update(1.f / 60.f, 1, 1.f / 60.f);
+                       });
+        }
+    }
+
+    void printUsage(const char* argv0)
+    {
+        std::cerr << "usage: " << argv0 << " [options]\n"
+                  << "  --filter <str>      run only benchmarks whose name contains <str>\n"
+                  << "  --iterations <n>    measure exactly <n> iterations per benchmark\n"
+                  << "  --min-time <sec>    minimum measuring time per benchmark (default 0.5)\n"
+                  << "  --font <path>       font file for the text benchmark\n"
+                  << "  --out <path>        write JSON results to <path> (default stdout)\n"
+                  << "  --quick             smaller problem sizes\n";
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    Option option;
+    std::string outPath;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        const bool hasValue        = i + 1 < argc;
+
+        if (arg == "--filter" && hasValue)
+            option.filter = argv[++i];
+        else if (arg == "--iterations" && hasValue)
+        {
+            option.minIterations = std::max<std::size_t>(1, std::stoul(argv[++i]));
+            option.minTime       = 0;
+        }
+        else if (arg == "--min-time" && hasValue)
+            option.minTime = std::stod(argv[++i]);
+        else if (arg == "--font" && hasValue)
+            option.fontPath = argv[++i];
+        else if (arg == "--out" && hasValue)
+            outPath = argv[++i];
+        else if (arg == "--quick")
+            option.quick = true;
+        else
+        {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    Runner runner(option);
+
+    benchTransformSystem(runner);
+    benchTransformHierarchy(runner);
+    benchFrustumCulling(runner);
+    benchSceneBVH(runner);
+    benchSpriteBatcher(runner);
+    benchSkylinePacker(runner);
+    benchTraverseNode(runner);
+    benchProcessMesh(runner);
+    benchScene(runner);
+    benchTextRasterize(runner);
+    benchCoverageExpand(runner);
+    benchTextLayout(runner);
+    benchTextLayoutParallel(runner);
+    benchSoLoudMix(runner);
+    benchPhysics(runner);
+
+    if (outPath.empty())
+        runner.writeJSON(std::cout);
+    else
+    {
+        std::ofstream ofs(outPath, std::ios::out | std::ios::trunc);
+        if (!ofs)
+        {
+            std::cerr << "failed to open output file!\npath : " << outPath << "\n";
+            return 1;
+        }
+        runner.writeJSON(ofs);
+    }
+
+    return 0;
+}
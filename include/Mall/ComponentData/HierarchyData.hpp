@@ -0,0 +1,32 @@
+#ifndef MALL_COMPONENTDATA_HIERARCHYDATA_HPP_
+#define MALL_COMPONENTDATA_HIERARCHYDATA_HPP_
+
+#include <MVECS/IComponentData.hpp>
+
+#include "../Engine/TransformHierarchy.hpp"
+
+namespace mall
+{
+    /**
+     * @brief 親子関係を持つエンティティに付ける
+     * @detail このコンポーネントを持つエンティティのTransformDataは親から見たローカルな値として扱われ,
+     *         MeshData, SkeletalMeshDataのworldには親の行列を掛けたものが書き込まれる
+     */
+    struct HierarchyData : public mvecs::IComponentData
+    {
+        COMPONENT_DATA(HierarchyData)
+
+        // parentには親エンティティのHierarchyData::nodeを渡す
+        void setup(TransformHierarchy& hierarchy, const TransformHierarchy::NodeID parent = TransformHierarchy::InvalidID);
+
+        void setParent(const TransformHierarchy::NodeID parent);
+
+        // エンティティの破棄前に呼ぶこと, 子はルートになる
+        void release();
+
+        TransformHierarchy* pHierarchy;
+        TransformHierarchy::NodeID node;
+    };
+}  // namespace mall
+
+#endif
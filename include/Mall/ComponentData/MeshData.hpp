@@ -7,6 +7,7 @@
 
 #include <cstdint>
 
+#include "../Engine/SceneBVH.hpp"
 #include "../Utility.hpp"
 
 namespace mall
@@ -40,6 +41,11 @@ namespace mall
             std::vector<std::uint32_t> indices;
             Cutlass::HBuffer VB;
             Cutlass::HBuffer IB;
+
+            // ローカル空間での境界(読み込み時に計算される)
+            glm::vec3 aabbMin;
+            glm::vec3 aabbMax;
+            glm::vec4 boundingSphere;  // xyz : 中心, w : 半径
         };
 
         struct RenderingInfo
@@ -55,7 +61,13 @@ namespace mall
                 std::uint32_t padding;
             };
 
-            Cutlass::HBuffer sceneCB;
+            // 同じメッシュ, マテリアルを共有するエンティティをまとめて描画する際のワールド行列
+            struct InstanceCBParam
+            {
+                constexpr static std::size_t MaxInstanceNum = 256;
+
+                glm::mat4 world[MaxInstanceNum];
+            };
         };
 
         COMPONENT_DATA(MeshData)
@@ -69,6 +81,18 @@ namespace mall
         // 毎F更新されるワールド行列
         glm::mat4 world;
 
+        // 固定タイムステップ時の1つ前のステップのワールド行列(TransformSystemがステップの最初に記録する)
+        // RenderSystemはworldとの間をEngine::interpolationAlphaで補間して描画する
+        glm::mat4 prevWorld;
+        // prevWorldを記録したステップ数(2以上で有効な値が入っている), ResourceBank::createで0になる
+        std::uint8_t prevWorldSteps;
+
+        // Engine::sceneBVH上のプロキシ(RenderSystemが登録し, ResourceBank::destroyで取り除かれる)
+        // destroyせずにエンティティごと消えた場合はRenderSystemが次のフレームで回収する
+        SceneBVH::ProxyID bvhProxy;
+        // プロキシのuserData(エンティティの識別子など, 問い合わせの結果から持ち主を引くため), RenderSystemが毎フレーム反映する
+        std::uint64_t bvhUserData;
+
         RenderingInfo renderingInfo;
     };
 }  // namespace mall
@@ -18,6 +18,9 @@ namespace mall
         {
             glm::mat4 offset;
             glm::mat4 transform;
+            // このボーンが動かす頂点のバインドポーズでのAABB(カリング用), 動かす頂点が無ければaabbMin > aabbMax
+            glm::vec3 aabbMin;
+            glm::vec3 aabbMax;
         };
 
         struct Skeleton
@@ -48,9 +51,6 @@ namespace mall
             {
                 glm::mat4 boneMat[MaxBoneNum];
             };
-
-            Cutlass::HBuffer sceneCB;
-            Cutlass::HBuffer boneCB;
         };
 
         uint32_t animationIndex;
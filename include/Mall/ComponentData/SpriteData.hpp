@@ -4,6 +4,7 @@
 #include <Cutlass/Texture.hpp>
 #include <MVECS/IComponentData.hpp>
 
+#include "../Engine/SceneBVH.hpp"
 #include "../Utility.hpp"
 
 namespace mall
@@ -23,15 +24,27 @@ namespace mall
             {
                 glm::vec3 pos;
                 glm::vec2 uv;
+                glm::vec4 color;
             };
-
-            Cutlass::HBuffer spriteVB;
         };
 
+        // 以下はフレームごと(ResourceBankが読み込み時に設定する), アトラスに詰めたフレームはページのテクスチャを指す
         TUArray<Cutlass::HTexture> textures;
+        // ピクセル単位の大きさ
+        TUArray<glm::uvec2> sizes;
+        // テクスチャ上の範囲(u0, v0, u1, v1)
+        TUArray<glm::vec4> uvRects;
+        // 描画をまとめる際のテクスチャの同一性(同じテクスチャ, 同じページなら同じ値)
+        TUArray<const void*> textureKeys;
         std::uint32_t index;
         bool centerFlag;
 
+        // Engine::spriteBVH上のプロキシ(スクリーン空間, RenderSystemが登録し, ResourceBank::destroyで取り除かれる)
+        // destroyせずにエンティティごと消えた場合はRenderSystemが次のフレームで回収する
+        SceneBVH::ProxyID bvhProxy;
+        // プロキシのuserData(MeshData::bvhUserDataと同じ)
+        std::uint64_t bvhUserData;
+
         RenderingInfo renderingInfo;
     };
 }  // namespace mall
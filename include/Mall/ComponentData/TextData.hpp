@@ -6,10 +6,13 @@
 #include <Cutlass/Texture.hpp>
 #include <MVECS/IComponentData.hpp>
 #include <memory>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include <glm/glm.hpp>
 
+#include "../Engine/GlyphAtlas.hpp"
 #include "../Utility.hpp"
 
 namespace mall
@@ -29,11 +32,37 @@ namespace mall
             {
                 glm::vec3 pos;
                 glm::vec2 uv;
+                glm::vec4 color;
             };
+        };
+
+        // 文字1つ分の矩形, 位置はwidth * heightの枠の左上を原点とするピクセル単位
+        struct Quad
+        {
+            glm::vec2 min;
+            glm::vec2 max;
+            glm::vec4 uvRect;
+            // GlyphAtlasのページ
+            const Cutlass::HTexture* pTexture;
+            // 距離場のグリフ(距離場用のパイプラインで描画する)
+            bool sdf;
+        };
+
+        // コンポーネントに直接置けない可変長のデータ(ResourceBankが確保する)
+        struct Storage
+        {
+            std::wstring text;
+            // textを書き換えるたびに増える
+            std::uint32_t version = 0;
 
-            Cutlass::HBuffer spriteVB;
+            std::vector<Quad> quads;
+            // quadsを組み立てたときの入力のハッシュ(updateLayout)
+            std::uint64_t layoutKey = 0;
         };
 
+        // 文字の高さ(ピクセル)の既定値
+        constexpr static float DefaultPixelHeight = 64.f;
+
         struct RGBA
         {
             RGBA()
@@ -50,9 +79,21 @@ namespace mall
             unsigned char a;
         };
 
+        // 文字列はstorageに複製する, 前と同じ文字列なら組み立て直さない
         void setText(std::wstring_view wstr, std::uint32_t width, std::uint32_t height, glm::vec4 color = glm::vec4(1.f, 1.f, 1.f, 1.f), bool centerFlag = true);
 
-        TUArray<wchar_t> string;
+        std::wstring_view getText() const;
+
+        // 文字列をwidth * heightのRGBAビットマップに描画する(pOutは呼び出し側で確保)
+        void rasterize(RGBA* pOut);
+
+        // 文字列をGlyphAtlasのグリフの矩形に並べてstorageに書き込む, 枠からはみ出た部分は切り捨てる
+        // 改行文字とwrapFlagでの折り返しで行を送る, 別のTextDataとなら並列に呼んでよい
+        void layout(GlyphAtlas& glyphAtlas);
+
+        // 文字列, 枠, 大きさ, フォント, sdfFlag, wrapFlagかアトラスが前回から変わっていればlayoutする, 組み立て直したらtrue
+        // 色はグリフに焼かず描画時に頂点色で付けるので, 色を変えても組み立て直さない
+        bool updateLayout(GlyphAtlas& glyphAtlas);
 
         TUPointer<stbtt_fontinfo> fontInfo;
         TUPointer<unsigned char*> fontBuffer;
@@ -60,8 +101,16 @@ namespace mall
         bool centerFlag;
         std::uint32_t width;
         std::uint32_t height;
-
-        Cutlass::HTexture texture;
+        float pixelHeight;
+        // 距離場のグリフで描画する, 1つのグリフをどの大きさでも縁を滑らかに描ける
+        bool sdfFlag;
+        // widthを超える文字を空白の位置で次の行に送る
+        bool wrapFlag;
+
+        // ResourceBankのスロットを指す, createで割り当ててdestroyでnullに戻す(setText等はcreate済みのものにだけ呼ぶ)
+        // destroyせずに破棄してもTextSystemのmark/sweepで回収される, コピーは同じスロットを共有する
+        TUPointer<Storage> storage;
+        std::uint32_t storageID;
 
         RenderingInfo renderingInfo;
     };
@@ -8,6 +8,9 @@
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include "../Engine/TransformStore.hpp"
+#include "../Utility/TransformMath.hpp"
+
 namespace mall
 {
     struct TransformData : public mvecs::IComponentData
@@ -16,6 +19,107 @@ namespace mall
 
         void setup(glm::vec3 pos = glm::vec3(0, 0, 0), glm::vec3 vel = glm::vec3(0, 0, 0), glm::vec3 acc = glm::vec3(0, 0, 0), glm::vec3 scalePerAxis = glm::vec3(1.f), glm::quat rotation = glm::quat(glm::vec3(0, 0, 0)));
 
+        // 値をTransformStore(SoA)に置く, 移動するエンティティが多い場合に使う
+        // 置いた後もpos等のメンバ(もしくはアクセサ)で読み書きしてよい, メンバはストアの値の写しで
+        // TransformSystemが更新の前に書き換えられた分をストアに書き込み(pushToStore), 更新の後にストアの値を読み戻す(pullFromStore)
+        // ストアの領域は, エンティティが破棄されて見つからなくなった次の(そのワールドの)TransformSystemの更新で解放される
+        // 1度もTransformSystemに更新されないまま破棄するならreleaseを呼ぶこと
+        void setup(TransformStore& store, glm::vec3 pos = glm::vec3(0, 0, 0), glm::vec3 vel = glm::vec3(0, 0, 0), glm::vec3 acc = glm::vec3(0, 0, 0), glm::vec3 scalePerAxis = glm::vec3(1.f), glm::quat rotation = glm::quat(glm::vec3(0, 0, 0)));
+
+        // TransformStoreの領域をすぐに解放し, 以降はメンバに値を持つ(呼ばなくてもTransformSystemが回収する)
+        void release();
+
+        // TransformStoreに置いていなければ半陰的Euler法で積分する(置いたものはTransformStore::integrateで行う)
+        void integrate(const float deltaTime);
+
+        // TransformStoreに置いたものは, 前回pullFromStoreしてからメンバを書き換えた分をストアに書き込む(TransformSystemが積分の前に呼ぶ)
+        void pushToStore();
+
+        // TransformStoreに置いたものは, ストアの値をメンバに読み戻す(TransformSystemが積分の後に呼ぶ)
+        void pullFromStore();
+
+        // 前回のワールド行列合成から値が変わっていればtrueを返し, 今の値を記録する
+        // TransformStoreに置いたものは毎フレーム動くとみなして常にtrue
+        bool updateDirty();
+
+        // 今フレームで値が変わったか(TransformSystemがupdateDirtyで更新する)
+        bool isDirty() const
+        {
+            return dirty;
+        }
+
+        bool isStored() const
+        {
+            return pStore != nullptr;
+        }
+
+        // TransformStoreに置いていなければnullptr
+        TransformStore* getStore() const
+        {
+            return pStore;
+        }
+
+        TransformStore::ID getStoreID() const
+        {
+            return storeID;
+        }
+
+        // TransformStoreに置いたものは最後にcomposeWorldした時点の値
+        glm::mat4 getWorld() const
+        {
+            return pStore ? pStore->getWorld(storeID) : composeTRS(pos, rot, scale);
+        }
+
+        glm::vec3 getPos() const
+        {
+            return pos;
+        }
+
+        glm::vec3 getVel() const
+        {
+            return vel;
+        }
+
+        glm::vec3 getAcc() const
+        {
+            return acc;
+        }
+
+        glm::vec3 getScale() const
+        {
+            return scale;
+        }
+
+        glm::quat getRot() const
+        {
+            return rot;
+        }
+
+        void setPos(const glm::vec3& v)
+        {
+            pos = v;
+        }
+
+        void setVel(const glm::vec3& v)
+        {
+            vel = v;
+        }
+
+        void setAcc(const glm::vec3& v)
+        {
+            acc = v;
+        }
+
+        void setScale(const glm::vec3& v)
+        {
+            scale = v;
+        }
+
+        void setRot(const glm::quat& q)
+        {
+            rot = q;
+        }
+
         glm::vec3 pos;
         glm::vec3 vel;
         glm::vec3 acc;
@@ -23,7 +127,33 @@ namespace mall
         glm::vec3 scale;
 
         glm::quat rot;
+
+    private:
+        // nullptrならメンバに直接値を持つ
+        TransformStore* pStore;
+        TransformStore::ID storeID;
+
+        // 変更検出用, 最後にワールド行列を合成した時の値
+        struct Composed
+        {
+            glm::vec3 pos;
+            glm::quat rot;
+            glm::vec3 scale;
+            bool valid;
+        } composed;
+
+        // TransformStoreに置いたものの, 最後にストアと揃えた時の値(pushToStoreで書き換えられた分だけを書き込むため)
+        struct Synced
+        {
+            glm::vec3 pos;
+            glm::vec3 vel;
+            glm::vec3 acc;
+            glm::vec3 scale;
+            glm::quat rot;
+        } synced;
+
+        bool dirty;
     };
 }  // namespace mall
 
-#endif
\ No newline at end of file
+#endif
@@ -4,14 +4,23 @@
 #include <MVECS/Application.hpp>
 #include <MVECS/ISystem.hpp>
 #include <MVECS/World.hpp>
+#include <algorithm>
 #include <chrono>
 #include <memory>
 
 #include "Engine/Audio.hpp"
+#include "Engine/FrameLimiter.hpp"
+#include "Engine/GlyphAtlas.hpp"
 #include "Engine/Graphics.hpp"
 #include "Engine/Input.hpp"
+#include "Engine/JobSystem.hpp"
 #include "Engine/Physics.hpp"
+#include "Engine/Profiler.hpp"
 #include "Engine/ResourceBank.hpp"
+#include "Engine/SceneBVH.hpp"
+#include "Engine/SystemScheduler.hpp"
+#include "Engine/TransformHierarchy.hpp"
+#include "Engine/TransformStore.hpp"
 
 /**
  * @brief Engine提供機能
@@ -24,21 +33,57 @@ namespace mall
     struct Engine
     {
         std::unique_ptr<Audio> audio;
+        std::unique_ptr<FrameLimiter> frameLimiter;
+        std::unique_ptr<GlyphAtlas> glyphAtlas;
         std::unique_ptr<Graphics> graphics;
         std::unique_ptr<Input> input;
+        std::unique_ptr<JobSystem> jobSystem;
         std::unique_ptr<Physics> physics;
+        std::unique_ptr<Profiler> profiler;
         std::unique_ptr<ResourceBank> resourceBank;
+        std::unique_ptr<SceneBVH> sceneBVH;
+        // スクリーン空間のスプライト用(ワールド空間のsceneBVHとは座標系が違うので分ける)
+        std::unique_ptr<SceneBVH> spriteBVH;
+        std::unique_ptr<SystemScheduler> scheduler;
+        std::unique_ptr<TransformHierarchy> transformHierarchy;
+        std::unique_ptr<TransformStore> transformStore;
 
         double deltaTime;
         std::uint32_t frame;
 
+        // 固定タイムステップ設定(setFixedTimeStepで変更すること)
+        struct FixedTimeStep
+        {
+            bool enable;
+            double tickRate;                // 1秒あたりのシミュレーション回数
+            std::uint32_t maxCatchUpSteps;  // 1フレームで追いつくために回す最大ステップ数
+            double accumulator;             // 未消化の経過時間
+        };
+
+        FixedTimeStep fixedTimeStep;
+
+        // 描画補間係数[0, 1], フレームタスク(RenderSystem等)の実行前に設定される
+        // RenderSystemはMeshDataのprevWorld(前ステップ)とworld(現ステップ)をこの値で補間して描画する
+        // 独自に描画するSystemも同様に, 前ステップの状態を覚えておき(1 - a) * prev + a * currentで描くこと
+        // 固定タイムステップ無効時は常に1
+        double interpolationAlpha;
+
         virtual ~Engine()
         {
+            scheduler.reset();
+            jobSystem.reset();
             input.reset();
             resourceBank.reset();
+            sceneBVH.reset();
+            spriteBVH.reset();
+            glyphAtlas.reset();
             physics.reset();
             audio.reset();
             graphics.reset();
+            profiler.reset();
+            frameLimiter.reset();
+            transformHierarchy.reset();
+            transformStore.reset();
         }
     };
 
@@ -53,14 +98,94 @@ namespace mall
         pContext->initialize(appName, false);
 #endif
 
-        app.common().audio        = std::make_unique<Audio>();
-        app.common().graphics     = std::make_unique<Graphics>(pContext);
-        app.common().input        = std::make_unique<Input>(pContext);
-        app.common().physics      = std::make_unique<Physics>();
-        app.common().resourceBank = std::make_unique<ResourceBank>(pContext);
+        app.common().audio              = std::make_unique<Audio>();
+        app.common().frameLimiter       = std::make_unique<FrameLimiter>();
+        app.common().graphics           = std::make_unique<Graphics>(pContext);
+        app.common().input              = std::make_unique<Input>(pContext);
+        app.common().jobSystem          = std::make_unique<JobSystem>();
+        app.common().physics            = std::make_unique<Physics>();
+        app.common().profiler           = std::make_unique<Profiler>();
+        app.common().resourceBank       = std::make_unique<ResourceBank>(pContext);
+        app.common().sceneBVH           = std::make_unique<SceneBVH>();
+        app.common().spriteBVH          = std::make_unique<SceneBVH>();
+        app.common().scheduler          = std::make_unique<SystemScheduler>();
+        app.common().transformHierarchy = std::make_unique<TransformHierarchy>();
+        app.common().transformStore     = std::make_unique<TransformStore>();
+
+        app.common().glyphAtlas         = std::make_unique<GlyphAtlas>(*app.common().graphics);
 
         app.common().graphics->createWindow(defaultWindow);
+        // パイプライン実行時に描画スレッドと競合しないようにする
+        app.common().resourceBank->setContextMutex(&app.common().graphics->getContextMutex());
+        // キャッシュの破棄を描画スレッドが使い終わるまで遅らせる
+        app.common().resourceBank->setGraphics(app.common().graphics.get());
+        // 破棄したコンポーネントのプロキシをBVHから取り除く
+        app.common().resourceBank->setSceneBVH(app.common().sceneBVH.get());
+        app.common().resourceBank->setSpriteBVH(app.common().spriteBVH.get());
+        // フォントを解放したらそのグリフを捨てる
+        app.common().resourceBank->setGlyphAtlas(app.common().glyphAtlas.get());
         app.common().frame = 0;
+
+        app.common().fixedTimeStep.enable          = false;
+        app.common().fixedTimeStep.tickRate        = 60.;
+        app.common().fixedTimeStep.maxCatchUpSteps = 5;
+        app.common().fixedTimeStep.accumulator     = 0;
+        app.common().interpolationAlpha            = 1.;
+    }
+
+    // GPU, ウィンドウ, オーディオデバイスを使わずに初期化する(CIでのベンチマーク用)
+    // 描画系の呼び出しは何も行わず, Graphics::getFrameStatsに書き込み量だけが記録される
+    template <typename Key, typename Common, typename = std::enable_if_t<std::is_base_of_v<Engine, Common>>>
+    void initializeHeadless(const std::uint32_t width, const std::uint32_t height, mvecs::Application<Key, Common>& app)
+    {
+        std::shared_ptr<Cutlass::Context> pContext;
+
+        app.common().audio              = std::make_unique<Audio>(true);
+        app.common().frameLimiter       = std::make_unique<FrameLimiter>();
+        app.common().graphics           = std::make_unique<Graphics>(pContext);
+        app.common().input              = std::make_unique<Input>(pContext);
+        app.common().jobSystem          = std::make_unique<JobSystem>();
+        app.common().physics            = std::make_unique<Physics>();
+        app.common().profiler           = std::make_unique<Profiler>();
+        app.common().resourceBank       = std::make_unique<ResourceBank>(pContext);
+        app.common().sceneBVH           = std::make_unique<SceneBVH>();
+        app.common().spriteBVH          = std::make_unique<SceneBVH>();
+        app.common().scheduler          = std::make_unique<SystemScheduler>();
+        app.common().transformHierarchy = std::make_unique<TransformHierarchy>();
+        app.common().transformStore     = std::make_unique<TransformStore>();
+
+        app.common().glyphAtlas         = std::make_unique<GlyphAtlas>(*app.common().graphics);
+
+        app.common().graphics->createWindow(width, height, "headless");
+        app.common().resourceBank->setGraphics(app.common().graphics.get());
+        app.common().resourceBank->setSceneBVH(app.common().sceneBVH.get());
+        app.common().resourceBank->setSpriteBVH(app.common().spriteBVH.get());
+        app.common().resourceBank->setGlyphAtlas(app.common().glyphAtlas.get());
+        app.common().frame = 0;
+
+        app.common().fixedTimeStep.enable          = false;
+        app.common().fixedTimeStep.tickRate        = 60.;
+        app.common().fixedTimeStep.maxCatchUpSteps = 5;
+        app.common().fixedTimeStep.accumulator     = 0;
+        app.common().interpolationAlpha            = 1.;
+    }
+
+    // 固定タイムステップの有効化/無効化
+    // 有効時はdeltaTimeが常に1 / tickRateとなり, 1フレームにつき0~maxCatchUpSteps回シミュレーションが回る
+    // 描画(SystemSchedulerのフレームタスク)はステップ数によらず毎フレーム1回, interpolationAlphaを設定してから行われる
+    template <typename Key, typename Common, typename = std::enable_if_t<std::is_base_of_v<Engine, Common>>>
+    void setFixedTimeStep(mvecs::Application<Key, Common>& app, const bool enable, const double tickRate = 60., const std::uint32_t maxCatchUpSteps = 5)
+    {
+        assert(tickRate > 0 || !"invalid tick rate!");
+        assert(maxCatchUpSteps > 0 || !"invalid max catch-up steps!");
+
+        auto& fixedTimeStep           = app.common().fixedTimeStep;
+        fixedTimeStep.enable          = enable;
+        fixedTimeStep.tickRate        = tickRate;
+        fixedTimeStep.maxCatchUpSteps = maxCatchUpSteps;
+        fixedTimeStep.accumulator     = 0;
+
+        app.common().interpolationAlpha = 1.;
     }
 
     template <typename Key, typename Common, typename = std::enable_if_t<std::is_base_of_v<Engine, Common>>>
@@ -68,19 +193,81 @@ namespace mall
     {
         static std::chrono::high_resolution_clock::time_point now, prev = std::chrono::high_resolution_clock::now();
 
+        double frameTime = 0;
+
         {  //フレーム数, fps
-            now                    = std::chrono::high_resolution_clock::now();
-            app.common().deltaTime = std::chrono::duration_cast<std::chrono::microseconds>(now - prev).count() / 1000000.;
+            now       = std::chrono::high_resolution_clock::now();
+            frameTime = std::chrono::duration_cast<std::chrono::microseconds>(now - prev).count() / 1000000.;
+        }
+
+        MALL_PROFILE_BEGIN_FRAME(app.common().profiler, app.common().frame);
+
+        {
+            MALL_PROFILE_SCOPE(app.common().profiler, "Input::update");
+            app.common().input->update();
+        }
+
+        // キー, カーソル, ゲームパッドのいずれかが操作されていれば操作中とみなす(FrameLimiterのアイドル判定)
+        if (app.common().input->hasActivity())
+            app.common().frameLimiter->notifyActivity();
+
+        auto& fixedTimeStep = app.common().fixedTimeStep;
+        if (!fixedTimeStep.enable)
+        {
+            app.common().deltaTime = frameTime;
+
+            {
+                MALL_PROFILE_SCOPE(app.common().profiler, "Application::update");
+                app.update();
+                // SchedulerSystemより後に登録されたタスクもこのフレーム内で実行する
+                app.common().scheduler->dispatch(*app.common().jobSystem);
+            }
+            {
+                MALL_PROFILE_SCOPE(app.common().profiler, "Physics::update");
+                app.common().physics->update(app.common().deltaTime);
+            }
+        }
+        else
+        {
+            const double step = 1. / fixedTimeStep.tickRate;
+
+            // 追いつけない分は捨てる(処理落ち時にステップ数が増え続けるのを防ぐ)
+            fixedTimeStep.accumulator = std::min(fixedTimeStep.accumulator + frameTime, step * fixedTimeStep.maxCatchUpSteps);
+            app.common().deltaTime    = step;
+
+            while (fixedTimeStep.accumulator >= step)
+            {
+                {
+                    MALL_PROFILE_SCOPE(app.common().profiler, "Application::update");
+                    app.update();
+                    // SchedulerSystemより後に登録されたタスクもこのフレーム内で実行する
+                    app.common().scheduler->dispatch(*app.common().jobSystem);
+                }
+                {
+                    MALL_PROFILE_SCOPE(app.common().profiler, "Physics::update");
+                    app.common().physics->update(step, 1, step);
+                }
+                fixedTimeStep.accumulator -= step;
+            }
+
+            app.common().interpolationAlpha = fixedTimeStep.accumulator / step;
         }
 
-        app.common().input->update();
+        {  // 描画の準備はステップ数によらず1フレームに1回だけ行う
+            MALL_PROFILE_SCOPE(app.common().profiler, "SystemScheduler::runFrameTasks");
+            app.common().scheduler->runFrameTasks();
+        }
 
+        {
+            MALL_PROFILE_SCOPE(app.common().profiler, "Graphics::update");
+            app.common().graphics->update();
+        }
 
-        app.update();
-        app.common().physics->update(app.common().deltaTime);
-        app.common().graphics->update();
+        {
+            MALL_PROFILE_SCOPE(app.common().profiler, "FrameLimiter::wait");
+            app.common().frameLimiter->wait();
+        }
 
-        
         {  //フレーム, 時刻更新
             ++app.common().frame;
             prev = now;
@@ -18,7 +18,8 @@ namespace mall
     class Audio
     {
     public:
-        Audio();
+        // headlessの場合は出力デバイスを開かない(SoLoudのnullドライバで動作する)
+        Audio(const bool headless = false);
 
         ~Audio();
 
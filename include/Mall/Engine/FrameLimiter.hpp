@@ -0,0 +1,73 @@
+#ifndef MALL_ENGINE_FRAMELIMITER_HPP_
+#define MALL_ENGINE_FRAMELIMITER_HPP_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace mall
+{
+    // フレームレートの上限を設ける(vsync無効時にCPUを回し続けないため)
+    // 締め切りの少し前まではsleepし, 残りはspinして精度を保つ
+    class FrameLimiter
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // 直近SampleNumフレームのフレーム時間[ms]
+        struct Stats
+        {
+            double average;
+            double stddev;
+            double min;
+            double max;
+            std::uint32_t sampleNum;
+        };
+
+        constexpr static std::size_t SampleNum = 128;
+
+        FrameLimiter();
+
+        ~FrameLimiter();
+
+        // 0以下で無制限
+        void setTargetFPS(const double fps);
+
+        // 入力がidleSeconds秒無ければidleFPSまで落とす, idleFPSが0以下なら無効
+        void setIdleFPS(const double idleFPS, const double idleSeconds = 5.);
+
+        // 入力があったことを通知する(キー, カーソル, ゲームパッドの操作はmall::updateがInput::hasActivityから自動で通知する)
+        void notifyActivity();
+
+        // フレームの最後に呼ぶ, 次の締め切りまで待機する
+        void wait();
+
+        bool isIdle() const;
+
+        double getCurrentTargetFPS() const;
+
+        Stats getStats() const;
+
+    private:
+        // プリエンプション等で大きく寝過ごした場合にspinし続けないよう上限を設ける
+        constexpr static int MaxSpinMarginMS = 2;
+
+        void sleepUntil(const Clock::time_point& deadline);
+
+        double mTargetFPS;
+        double mIdleFPS;
+        double mIdleSeconds;
+
+        Clock::time_point mNextDeadline;
+        Clock::time_point mLastActivity;
+        Clock::time_point mLastFrameEnd;
+
+        // sleepの寝過ごし量の推定値, この分だけ手前で起きてspinする
+        Clock::duration mSpinMargin;
+
+        std::array<double, SampleNum> mFrameTimes;
+        std::uint64_t mFrameCount;
+    };
+}  // namespace mall
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef MALL_ENGINE_GLYPHATLAS_HPP_
+#define MALL_ENGINE_GLYPHATLAS_HPP_
+
+#include <stb/stb_truetype.h>
+
+#include <Cutlass/Cutlass.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "../Utility/FlatHashMap.hpp"
+#include "../Utility/SkylinePacker.hpp"
+
+namespace mall
+{
+    class Graphics;
+
+    /**
+     * @brief 全てのテキストで共有するグリフのキャッシュ
+     * @detail フォント, 大きさ, 文字の組ごとに初めて使われたときだけラスタライズし, RGBA8のページに詰める
+     *         ページには白で被覆率(距離場なら距離)だけをアルファに持ち, 色は描画時に頂点色として掛ける(色ごとにグリフを作らない)
+     *         ページはCPU側にもピクセルを持ち, flushで追加のあったページだけを転送する
+     *         テキストはここで得た矩形を並べて描画するので, 文字列が同じなら毎フレームのラスタライズと転送は起きない
+     *         距離場(SDF)のグリフは大きさによらずフォントごとにSDFPixelHeightで1回だけ作り, 描画側で拡大縮小する
+     *         文字の送りとカーニングもフォントごとにキャッシュする
+     *         複数のスレッドから同時に引いてよい(キャッシュに無いものを作る間だけ他を待たせる)
+     *         Graphicsを触るflush, clearはメインスレッドから呼ぶこと(ページのテクスチャもflushで作る)
+     */
+    class GlyphAtlas
+    {
+    public:
+        struct Glyph
+        {
+            // 描画するものが無い(空白など)ならnullptr
+            const Cutlass::HTexture* pTexture;
+            // ページ上の範囲(u0, v0, u1, v1)
+            glm::vec4 uvRect;
+            // ベースライン上のペン位置からビットマップ左上までのピクセル数
+            glm::ivec2 offset;
+            glm::uvec2 size;
+            // アルファが輪郭からの距離(SDFOnEdgeが輪郭), offset, sizeはSDFPixelHeightでの値
+            bool sdf;
+        };
+
+        // フォント単位の横方向のメトリクス(stbtt_GetCodepointHMetrics)
+        struct HMetrics
+        {
+            int advanceWidth;
+            int leftSideBearing;
+        };
+
+        // ページの一辺(ピクセル)
+        constexpr static std::uint32_t PageSize = 1024;
+        // 隣のグリフを拾わないよう空ける幅
+        constexpr static std::uint32_t Padding = 1;
+
+        // 距離場を作る大きさ(ピクセル)
+        constexpr static float SDFPixelHeight = 48.f;
+        // 輪郭の外側に距離を持たせる幅(ピクセル), 縮小時に縁が欠けない程度
+        constexpr static int SDFSpread = 6;
+        // 輪郭上の値, 1ピクセル離れるごとにSDFOnEdge / SDFSpreadずつ変わる
+        constexpr static std::uint8_t SDFOnEdge = 128;
+
+        // 色をRGBA8(r | g << 8 | b << 16 | a << 24)にする(expandCoverage用)
+        static std::uint32_t packColor(const glm::vec4& color);
+
+        GlyphAtlas(Graphics& graphics);
+
+        ~GlyphAtlas();
+
+        // 無ければラスタライズしてページに詰める, 返す参照はclearまで有効
+        // sdfなら距離場のグリフを返す(pixelHeightは使わない), ただしsetSDFEnabled(false)なら通常のグリフを返す
+        const Glyph& get(const stbtt_fontinfo& font, const float pixelHeight, const std::uint32_t codepoint, const bool sdf = false);
+
+        // フォント単位の値を返す, 大きさに合わせるのは呼び出し側(stbtt_ScaleForPixelHeight)
+        void getVMetrics(const stbtt_fontinfo& font, int& ascent, int& descent, int& lineGap);
+
+        HMetrics getHMetrics(const stbtt_fontinfo& font, const std::uint32_t codepoint);
+
+        int getKernAdvance(const stbtt_fontinfo& font, const std::uint32_t left, const std::uint32_t right);
+
+        // 追加のあったページを転送する, 描画の前にメインスレッドから呼ぶこと(RenderSystem)
+        // 新しいページのテクスチャもここで作るので, それまでGlyph::pTextureの指す先は無効
+        void flush();
+
+        // fontのグリフとメトリクスを使わなくする(フォントを解放したとき), ページ上の領域はclearまで空かない
+        void forget(const stbtt_fontinfo& font);
+
+        // 全てのグリフとページを破棄する
+        void clear();
+
+        std::size_t size() const;
+
+        std::size_t getPageCount() const;
+
+        // forget, clear, setSDFEnabledのたびに増える(それ以前に得たグリフの矩形を使い続けてよいかの判定用)
+        std::uint64_t getGeneration() const;
+
+        // 距離場を描画するシェーダが無い場合に無効にする(RenderSystem)
+        void setSDFEnabled(const bool enable);
+
+        bool isSDFEnabled() const;
+
+    private:
+        // ページに書き込む色(packColor(glm::vec4(1.f)))
+        constexpr static std::uint32_t WhiteColor = 0xffffffffu;
+
+        struct Key
+        {
+            const stbtt_fontinfo* pFont;
+            float pixelHeight;
+            std::uint32_t codepoint;
+            bool sdf;
+
+            bool operator==(const Key& other) const
+            {
+                return pFont == other.pFont && pixelHeight == other.pixelHeight && codepoint == other.codepoint && sdf == other.sdf;
+            }
+        };
+
+        struct KeyHash
+        {
+            std::size_t operator()(const Key& key) const;
+        };
+
+        struct Page
+        {
+            Cutlass::HTexture texture;
+            SkylinePacker packer;
+            std::vector<std::uint8_t> pixels;
+            bool dirty;
+            // textureを作ったか(flushで作る)
+            bool created;
+            // 距離場のグリフのページ(描画するパイプラインが違うので通常のグリフと混ぜない)
+            bool sdf;
+        };
+
+        // フォントごとのメトリクス
+        struct FontCache
+        {
+            int ascent;
+            int descent;
+            int lineGap;
+            FlatHashMap<std::uint32_t, HMetrics> hMetrics;
+            // 左の文字 << 32 | 右の文字
+            FlatHashMap<std::uint64_t, int> kerning;
+        };
+
+        // 無ければ作る, mMutexを排他でロックして呼ぶこと
+        FontCache& getFontCache(const stbtt_fontinfo& font);
+
+        // width * heightの領域をsdfの種類のページに確保する, 入らなければページを足す
+        Page& allocate(const std::uint32_t width, const std::uint32_t height, const bool sdf, std::uint32_t& x, std::uint32_t& y);
+
+        Graphics& mGraphics;
+
+        // 引くだけなら共有, 追加と破棄は排他でロックする
+        std::shared_mutex mMutex;
+        std::atomic<std::uint64_t> mGeneration;
+        bool mSDFEnabled;
+
+        std::unordered_map<Key, Glyph, KeyHash> mGlyphs;
+        std::unordered_map<const stbtt_fontinfo*, std::unique_ptr<FontCache>> mFonts;
+        std::vector<std::unique_ptr<Page>> mPages;
+
+        // ラスタライズの作業領域
+        std::vector<std::uint8_t> mCoverage;
+    };
+}  // namespace mall
+
+#endif
@@ -2,12 +2,17 @@
 #define MALL_GRAPHICS_HPP_
 
 #include <Cutlass/Context.hpp>
+#include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <limits>
 #include <map>
+#include <mutex>
+#include <thread>
 
 namespace mall
 {
+    // メインスレッド(mall::updateを呼ぶスレッド)からのみ使うこと, ワーカーで作ったデータの転送はSystemの側でまとめて行う
     class Graphics
     {
     public:
@@ -29,6 +34,17 @@ namespace mall
             Cutlass::HTexture roughness;
         };
 
+        // 1フレーム(update間)にGPUへ送った量
+        struct FrameStats
+        {
+            std::uint32_t commandListCount;   // writeCommandの呼び出し回数
+            std::uint32_t commandCount;       // writeCommandで書き込まれたコマンド数
+            std::uint32_t bufferWriteCount;   // writeBufferの呼び出し回数
+            std::uint32_t textureWriteCount;  // writeTextureの呼び出し回数
+            std::uint64_t uploadedBytes;      // writeBuffer, writeTextureで転送したバイト数
+        };
+
+        // contextがnullptrの場合はヘッドレス(GPU, ウィンドウを使わない)で動作し, 書き込みは統計にのみ記録される
         Graphics(const std::shared_ptr<Cutlass::Context>& context);
 
         Graphics(const std::shared_ptr<Cutlass::Context>& context, const std::vector<Cutlass::WindowInfo>& windows);
@@ -40,6 +56,9 @@ namespace mall
 
         void getWindowSize(uint32_t& width_out, uint32_t& height_out, uint32_t windowID = 0);
 
+        // 同時に処理中になり得るフレーム数(スワップチェインの枚数)
+        uint32_t getFrameCount(uint32_t windowID = 0) const;
+
         //バッファ作成・破棄
         Cutlass::HBuffer createBuffer(const Cutlass::BufferInfo& info);
         void destroyBuffer(const Cutlass::HBuffer& handle);
@@ -54,11 +73,17 @@ namespace mall
         //ファイルからテクスチャ作成
         Cutlass::HTexture createTextureFromFile(const char* fileName);
 
+        // createBuffer, destroyBuffer, createTexture, destroyTextureのたびに増える
+        // 記録済みのコマンドを使い回す際, 参照先のリソースが作り直されていないかの判定に使う
+        std::uint64_t getResourceGeneration() const;
+
         //テクスチャからサイズを取得する
         void getTextureSize(const Cutlass::HTexture& handle, uint32_t& width_out, uint32_t& height_out, uint32_t& depth_out);
 
         //テクスチャにデータ書き込み(使用注意, 書き込むデータのサイズはテクスチャのサイズに従うもの以外危険)
         void writeTexture(const void* const pData, const Cutlass::HTexture& handle);
+        // sizeは統計用(ヘッドレス時はテクスチャサイズを取得できないため)
+        void writeTexture(const size_t size, const void* const pData, const Cutlass::HTexture& handle);
 
         // PSO取得(無ければ作成される)
         Cutlass::HGraphicsPipeline getGraphicsPipeline(
@@ -90,9 +115,19 @@ namespace mall
         //Cutlass::HCommandBuffer createSubCommand(const DefaultRenderPass passID, const Cutlass::SubCommandList& cl, const uint32_t windowID = 0);
         //void destroySubCommand(const Cutlass::HCommandBuffer& cb);
 
+        // パスのコマンドを書き換える, writeFrameCommandで書き込んだものからこちらに戻す
         void writeCommand(const DefaultRenderPass passID, const Cutlass::CommandList& cl, const uint32_t windowID = 0);
         void writeCommand(const int executionOrder, const Cutlass::CommandList& cl, const uint32_t windowID = 0);
 
+        // パスにframeCount個のコマンドを持たせ, frameIndex([0, getFrameCount()))番目に書き込んで実行するものをそれに切り替える
+        // UniformRing等の組ごとに記録したコマンドを, 組が一巡して戻ってきたときに転送し直さず使い回すためのもの
+        void writeFrameCommand(const DefaultRenderPass passID, const Cutlass::CommandList& cl, const uint32_t frameIndex, const uint32_t windowID = 0);
+        void writeFrameCommand(const int executionOrder, const Cutlass::CommandList& cl, const uint32_t frameIndex, const uint32_t windowID = 0);
+
+        // 書き込み済みのframeIndex番目のコマンドを実行するよう切り替えるだけで, コマンドは転送しない
+        void useFrameCommand(const DefaultRenderPass passID, const uint32_t frameIndex, const uint32_t windowID = 0);
+        void useFrameCommand(const int executionOrder, const uint32_t frameIndex, const uint32_t windowID = 0);
+
         //void writeCommandPrepass(const uint32_t prePassID, const Cutlass::CommandList& cl, const uint32_t windowID = 0);
         //void writeCommandPostpass(const uint32_t postPassID, const Cutlass::CommandList& cl, const uint32_t windowID = 0);
 
@@ -100,11 +135,70 @@ namespace mall
 
         bool shouldClose();
 
+        bool isHeadless() const;
+
+        // パイプライン実行の有効化/無効化(ヘッドレス時は何もしない)
+        // 有効時はwriteBuffer, writeTexture, writeCommand, destroyBuffer, destroyTextureがRenderPacketに記録され,
+        // updateで描画スレッドに渡される. 描画スレッドがフレームNを実行している間にフレームN+1のシミュレーションを進められる
+        void setPipelined(const bool enable);
+
+        bool isPipelined() const;
+
+        // Cutlass::Contextのリソースを直接作成, 破棄, 転送する場合(ResourceBank等)はこれをロックすること
+        // パイプライン実行時は描画スレッドもフレームの実行と表示の間これをロックする
+        std::mutex& getContextMutex();
+
+        // 直前のフレーム(前回のupdateまで)の統計
+        const FrameStats& getFrameStats() const;
+
     private:
+        // 1フレーム分の描画スレッドへの依頼, 記録順に適用される
+        struct RenderPacket
+        {
+            enum class OpType
+            {
+                eWriteBuffer,
+                eWriteTexture,
+                eUpdateCommand,
+                eSelectCommand,
+            };
+
+            struct Op
+            {
+                OpType type;
+                std::size_t offset;  // data内の位置, もしくはcommandLists内のインデックス
+                std::size_t size;
+                Cutlass::HBuffer buffer;
+                Cutlass::HTexture texture;
+                Cutlass::HCommandBuffer command;
+                // eSelectCommandの対象(パスはaddRenderPassで並びが変わるので実行順で引く)
+                std::uint32_t windowID;
+                int executionOrder;
+                std::size_t frameIndex;
+            };
+
+            void clear();
+
+            std::vector<Op> ops;
+            std::vector<std::uint8_t> data;
+            std::vector<Cutlass::CommandList> commandLists;
+
+            // 実行後に破棄する(描画中のリソースを消さないため)
+            std::vector<Cutlass::HBuffer> destroyBuffers;
+            std::vector<Cutlass::HTexture> destroyTextures;
+        };
+
+        // RenderPass::frameIndexがこれならcommandを実行する
+        constexpr static std::size_t NoFrameCommand = std::numeric_limits<std::size_t>::max();
+
         struct RenderPass
         {
             Cutlass::HRenderPass renderPass;
             Cutlass::HCommandBuffer command;
+            // writeFrameCommandで書き込むもの(最初に書き込まれたときにframeCount個作る)
+            std::vector<Cutlass::HCommandBuffer> frameCommands;
+            // executeで実行するframeCommandsの番号
+            std::size_t frameIndex = NoFrameCommand;
             std::string passName;
         };
 
@@ -165,6 +259,39 @@ namespace mall
         std::vector<Window> mWindows;
 
         Cutlass::HTexture mDebugTex;
+
+        FrameStats mFrameStats;
+        FrameStats mLastFrameStats;
+
+        std::atomic<std::uint64_t> mResourceGeneration;
+
+        void updateCommand(const Cutlass::CommandList& cl, const Cutlass::HCommandBuffer& command);
+
+        // executeで実行するコマンドを切り替える, パイプライン実行時はRenderPacketに記録して描画スレッドで切り替える
+        void selectCommand(const uint32_t windowID, const int executionOrder, const std::size_t frameIndex);
+
+        // 全ウィンドウのパスと表示を実行する, mContextMutexをロックして呼ぶこと
+        // (ゲームスレッドのaddRenderPass, createWindowやResourceBankの転送と, mWindowsやキューの使用が重ならないように)
+        void execute();
+
+        // executeFrameがfalseの場合は書き込みのみ反映する, mContextMutexは中でロックする
+        void applyPacket(RenderPacket& packet, const bool executeFrame);
+
+        void renderThreadLoop();
+
+        RenderPacket& getWritePacket();
+
+        std::mutex mContextMutex;
+
+        bool mPipelined;
+        std::thread mRenderThread;
+        // mPackets[mWriteIndex]にゲームスレッドが記録し, もう一方を描画スレッドが実行する
+        RenderPacket mPackets[2];
+        std::size_t mWriteIndex;
+        bool mPacketSubmitted;
+        bool mRenderThreadExit;
+        std::mutex mPacketMutex;
+        std::condition_variable mPacketCV;
     };
 }  // namespace mall
 
@@ -2,6 +2,7 @@
 #define MALL_INPUT_HPP_
 
 #include <Cutlass/Context.hpp>
+#include <array>
 #include <memory>
 
 namespace mall
@@ -9,6 +10,7 @@ namespace mall
     class Input
     {
     public:
+        // contextがnullptrの場合はヘッドレス(入力なし)
         Input(const std::shared_ptr<Cutlass::Context>& context);
 
         ~Input();
@@ -23,12 +25,28 @@ namespace mall
 
         // bool getKeyUp(const Cutlass::Key key);
 
+        // 直前のupdateでキー, カーソル, ゲームパッドのいずれかが操作されていたか(FrameLimiterのアイドル判定用)
+        // 押され続けているキー, 倒され続けているスティックも操作中とみなす
+        bool hasActivity() const;
+
+        // ウィンドウのイベントを取り出す, ゲームスレッド(mall::update)から呼ぶ
         void update();
 
     private:
+        // スティック, トリガーの遊び
+        constexpr static float GamepadDeadZone = 0.2f;
+
+        bool pollGamepadActivity() const;
+
         // std::array<uint32_t, static_cast<size_t>(Cutlass::Key::LAST)> mKeys;
         std::shared_ptr<Cutlass::Context> mpContext;
+
+        // 変化の検出用, 前回のupdateでの状態
+        std::array<bool, static_cast<std::size_t>(Cutlass::Key::LAST)> mPrevKeys;
+        double mPrevCursorX;
+        double mPrevCursorY;
+        bool mActivity;
     };
 }  // namespace mall
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,122 @@
+#ifndef MALL_ENGINE_JOBSYSTEM_HPP_
+#define MALL_ENGINE_JOBSYSTEM_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mall
+{
+    // ワークスティーリング方式のスレッドプール
+    // 各ワーカーは自分のキューの末尾から取り出し, 空なら他のキューの先頭から盗む
+    class JobSystem
+    {
+    public:
+        using Job = std::function<void()>;
+
+        // submitしたジョブの完了待ちに使う
+        class Counter
+        {
+        public:
+            Counter()
+                : mCount(0)
+            {
+            }
+
+            bool done() const
+            {
+                return mCount.load(std::memory_order_acquire) == 0;
+            }
+
+        private:
+            friend class JobSystem;
+            std::atomic<std::uint32_t> mCount;
+        };
+
+        // workerNumが0の場合はハードウェアスレッド数 - 1個のワーカーを立てる
+        JobSystem(const std::uint32_t workerNum = 0);
+
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        // 任意のスレッド(ジョブ内を含む)から呼び出せる
+        void submit(Job&& job, Counter& counter);
+
+        // counterが0になるまで, 待つ間も他のジョブを実行する
+        void wait(const Counter& counter);
+
+        // [0, count)をgrain個ずつに分割してfunc(begin, end)を並列実行し, 全て終わるまで待つ
+        template <typename Func>
+        void parallelFor(const std::size_t count, std::size_t grain, Func&& func)
+        {
+            if (count == 0)
+                return;
+
+            grain = std::max<std::size_t>(grain, 1);
+            if (count <= grain || mWorkers.empty())
+            {
+                func(static_cast<std::size_t>(0), count);
+                return;
+            }
+
+            Counter counter;
+            // 先頭の区間は呼び出し元で実行する
+            for (std::size_t begin = grain; begin < count; begin += grain)
+            {
+                const std::size_t end = std::min(begin + grain, count);
+                submit([&func, begin, end]() { func(begin, end); }, counter);
+            }
+
+            func(static_cast<std::size_t>(0), grain);
+
+            wait(counter);
+        }
+
+        // ワーカー数 + 呼び出し元スレッド
+        std::uint32_t getThreadNum() const;
+
+    private:
+        struct Task
+        {
+            Job job;
+            Counter* pCounter;
+        };
+
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        void workerLoop(const std::uint32_t index);
+
+        // 自分のキューか他のキューから1つ取り出して実行する, 何もなければfalse
+        bool tryRun(const std::uint32_t index);
+
+        bool tryPop(const std::uint32_t index, Task& task_out);
+
+        bool trySteal(const std::uint32_t index, Task& task_out);
+
+        // 呼び出しスレッドに対応するキューのインデックス(ワーカー以外は共有キュー)
+        std::uint32_t getQueueIndex() const;
+
+        std::vector<std::unique_ptr<Queue>> mQueues;  // [0, ワーカー数)はワーカー用, 末尾はワーカー以外のスレッド用
+        std::vector<std::thread> mWorkers;
+
+        std::atomic<bool> mRunning;
+        std::atomic<std::uint32_t> mPendingNum;
+        std::mutex mSleepMutex;
+        std::condition_variable mSleepCV;
+    };
+}  // namespace mall
+
+#endif
@@ -33,7 +33,8 @@ namespace mall
 
         void destroyAll();
 
-        void update(const float deltaTime);
+        // fixedTimeStepごとに最大maxSubSteps回内部ステップを回す
+        void update(const float deltaTime, const int maxSubSteps = 10, const float fixedTimeStep = 1.f / 60.f);
 
     private:
 
@@ -0,0 +1,95 @@
+#ifndef MALL_ENGINE_PROFILER_HPP_
+#define MALL_ENGINE_PROFILER_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+// MALL_ENABLE_PROFILERが定義されていない場合, 計測用マクロは全て空になる
+#ifdef MALL_ENABLE_PROFILER
+#define MALL_PROFILE_CONCAT_IMPL(a, b) a##b
+#define MALL_PROFILE_CONCAT(a, b) MALL_PROFILE_CONCAT_IMPL(a, b)
+// nameは文字列リテラルであること(ポインタのみ保持する)
+#define MALL_PROFILE_SCOPE(profiler, name) ::mall::Profiler::ScopedTimer MALL_PROFILE_CONCAT(mallProfileScope, __LINE__)((profiler), (name))
+#define MALL_PROFILE_BEGIN_FRAME(profiler, frame) (profiler)->beginFrame(frame)
+#else
+#define MALL_PROFILE_SCOPE(profiler, name) ((void)0)
+#define MALL_PROFILE_BEGIN_FRAME(profiler, frame) ((void)0)
+#endif
+
+namespace mall
+{
+    class Profiler
+    {
+    public:
+        // 保持するフレーム数(リングバッファ)
+        constexpr static std::size_t MaxFrameNum = 128;
+        // 1フレームで記録できる区間数, 溢れた分は捨てる
+        constexpr static std::size_t MaxEventNumPerFrame = 512;
+
+        struct Event
+        {
+            const char* name;
+            std::uint64_t begin;  // 計測開始からの経過時間[ns]
+            std::uint64_t end;    // 計測開始からの経過時間[ns]
+            std::uint32_t threadID;
+        };
+
+        class ScopedTimer
+        {
+        public:
+            ScopedTimer(Profiler& profiler, const char* name);
+            ScopedTimer(const std::unique_ptr<Profiler>& profiler, const char* name);
+
+            ~ScopedTimer();
+
+            ScopedTimer(const ScopedTimer&) = delete;
+            ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+        private:
+            Profiler& mProfiler;
+            const char* mName;
+            std::uint64_t mBegin;
+        };
+
+        Profiler();
+
+        ~Profiler();
+
+        // フレームの区切り, メインスレッドからのみ呼ぶこと
+        void beginFrame(const std::uint32_t frame);
+
+        // 任意のスレッドから呼び出せる(ロックしない)
+        void record(const char* name, const std::uint64_t begin, const std::uint64_t end);
+
+        // 計測開始からの経過時間[ns]
+        std::uint64_t now() const;
+
+        // 直近frameNumフレームでのnameの区間の1フレームあたり平均時間[ms]
+        double getAverageTime(std::string_view name, std::size_t frameNum = MaxFrameNum) const;
+
+        // 保持している全フレームをChromeのtrace_event形式(chrome://tracing, Perfetto)で書き出す
+        bool writeChromeTrace(std::string_view path) const;
+
+    private:
+        struct Frame
+        {
+            std::uint32_t frame;
+            std::atomic<std::uint32_t> eventCount;
+            std::array<Event, MaxEventNumPerFrame> events;
+        };
+
+        static std::uint32_t getThreadID();
+
+        std::unique_ptr<Frame[]> mFrames;
+        // これまでにbeginFrameされた回数
+        std::atomic<std::uint64_t> mFrameCount;
+
+        std::chrono::steady_clock::time_point mOrigin;
+    };
+}  // namespace mall
+
+#endif
@@ -6,7 +6,9 @@
 
 #include <Cutlass/Context.hpp>
 #include <assimp/Importer.hpp>
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 #include "../ComponentData/MaterialData.hpp"
 #include "../ComponentData/MeshData.hpp"
@@ -14,12 +16,16 @@
 #include "../ComponentData/SoundData.hpp"
 #include "../ComponentData/SpriteData.hpp"
 #include "../ComponentData/TextData.hpp"
+#include "../Utility/SkylinePacker.hpp"
+#include "GlyphAtlas.hpp"
+#include "SceneBVH.hpp"
 
 namespace mall
 {
     struct SkeletalMeshData;
     struct MaterialData;
     struct SpriteData;
+    class Graphics;
 
     class ResourceBank
     {
@@ -54,11 +60,44 @@ namespace mall
         
         void destroy(SoundData& sound);
 
+        // TextSystemが毎フレーム全てのTextDataについて呼ぶ, 異なるテキストなら複数のスレッドから同時に呼べる
+        // ownerはmarkしたシステム, TransformStoreと同じくワールドごとに分けて回収する
+        void markText(const TextData& text, const void* owner);
+
+        // ownerが前回のsweepから一度もmarkしなかったテキスト(destroyせずに破棄されたエンティティ)の領域を回収する
+        // 回収した数を返す, markTextと同時には呼ばないこと
+        std::size_t sweepTexts(const void* owner);
 
         void clearCache(std::string_view pathOrName);
 
         void clearCacheAll();
 
+        // 描画スレッドとContextを共有する場合に設定する(Graphics::getContextMutex)
+        void setContextMutex(std::mutex* pMutex);
+
+        // 設定するとclearCache等での破棄をGraphics経由にする(パイプライン実行時は描画スレッドが使い終わってから破棄される)
+        void setGraphics(Graphics* pGraphics);
+
+        // create, destroy, clearCacheのたびに増える(Graphics::getResourceGenerationと同じく, 記録済みコマンドの再利用判定用)
+        std::uint64_t getGeneration() const;
+
+        // destroyでコンポーネントのプロキシを取り除くBVH(Engine::sceneBVH)
+        void setSceneBVH(SceneBVH* pSceneBVH);
+
+        // destroy(SpriteData&)でプロキシを取り除くBVH(Engine::spriteBVH)
+        void setSpriteBVH(SceneBVH* pSpriteBVH);
+
+        // フォントを解放したときにグリフを捨てさせるアトラス(Engine::glyphAtlas)
+        void setGlyphAtlas(GlyphAtlas* pGlyphAtlas);
+
+        // スプライトの画像を詰めるアトラスのページ数
+        std::size_t getAtlasPageCount() const;
+
+        // アトラスのページの一辺(ピクセル), これより大きい画像は単独のテクスチャにする
+        constexpr static std::uint32_t AtlasPageSize = 2048;
+        // 隣の画像が滲まないよう各画像の周りに端の色を延ばす幅
+        constexpr static std::uint32_t AtlasPadding = 1;
+
     private:
         struct VertexBoneData
         {
@@ -75,6 +114,27 @@ namespace mall
         struct Sprite
         {
             std::vector<Cutlass::HTexture> textures;
+            std::vector<glm::uvec2> sizes;
+            std::vector<glm::vec4> uvRects;
+            std::vector<const void*> textureKeys;
+            // アトラスに詰めたフレームなら1(ページはclearCacheAllまで解放しない)
+            std::vector<std::uint8_t> atlased;
+        };
+
+        // RGBA8のピクセルをCPU側にも持ち, 画像を追加したらページ全体を転送し直す
+        struct AtlasPage
+        {
+            Cutlass::HTexture texture;
+            SkylinePacker packer;
+            std::vector<std::uint8_t> pixels;
+            bool dirty;
+        };
+
+        struct AtlasRegion
+        {
+            AtlasPage* pPage;
+            glm::vec4 uvRect;
+            glm::uvec2 size;
         };
 
         struct Model
@@ -113,6 +173,24 @@ namespace mall
             unsigned char* fontBuffer;
         };
 
+        // TextData::Storageの置き場所, 解放されたスロットはStorageごと使い回すのでアドレスは変わらない
+        struct TextSlot
+        {
+            std::unique_ptr<TextData::Storage> storage;
+            // 最後にmarkしたシステム, 一度もmarkされていなければnullptrでsweepの対象にならない
+            const void* owner;
+            bool marked;
+            bool alive;
+        };
+
+        // mpContextMutexが未設定なら何もロックしない
+        std::unique_lock<std::mutex> lockContext();
+
+        // mpGraphicsが設定されていればそちらで破棄する, lockContextしたまま呼ばないこと
+        void destroyBuffer(const Cutlass::HBuffer& handle);
+
+        void destroyTexture(const Cutlass::HTexture& handle);
+
         void processNode(const aiNode* node, Model& model_out);
 
         void processMesh(const aiNode* node, const aiMesh* mesh, Model& model_out);
@@ -121,6 +199,15 @@ namespace mall
 
         void loadBones(const aiNode* node, const aiMesh* mesh, std::vector<VertexBoneData>& vbdata_out, SkeletalMeshData::Skeleton& skeleton_out);
 
+        // 画像を読み込んでアトラスに詰める, 大きすぎる場合や読み込めない場合はfalse
+        bool insertAtlas(std::string_view path, AtlasRegion& region_out);
+
+        // 画像を追加したページを転送する
+        void flushAtlas();
+
+        // 文字列と矩形の領域を空にしてスロットを空きに戻す
+        void releaseTextSlot(std::uint32_t slotID);
+
         std::unordered_map<std::string, Model> mModelCacheMap;
         std::unordered_map<std::string, Model> mSkeletalModelCacheMap;
         std::unordered_map<std::string, Sprite> mSpriteCacheMap;
@@ -129,7 +216,19 @@ namespace mall
 
         std::unordered_map<std::string, Cutlass::HTexture> mTextureCacheMap;
 
+        std::vector<std::unique_ptr<AtlasPage>> mAtlasPages;
+        std::unordered_map<std::string, AtlasRegion> mAtlasRegionMap;
+
+        std::vector<TextSlot> mTextSlots;
+        std::vector<std::uint32_t> mFreeTextSlots;
+
         std::shared_ptr<Cutlass::Context> mpContext;
+        std::mutex* mpContextMutex;
+        Graphics* mpGraphics;
+        SceneBVH* mpSceneBVH;
+        SceneBVH* mpSpriteBVH;
+        GlyphAtlas* mpGlyphAtlas;
+        std::atomic<std::uint64_t> mGeneration;
 
         Assimp::Importer mImporter;
     };
@@ -0,0 +1,145 @@
+#ifndef MALL_ENGINE_SCENEBVH_HPP_
+#define MALL_ENGINE_SCENEBVH_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace mall
+{
+    struct Frustum;
+
+    /**
+     * @brief 描画対象のワールド空間AABBを保持する動的BVH
+     * @detail 視錐台カリング, レイによるピッキング, 範囲検索を各コンポーネントを走査せずに行うためのもの
+     *         移動だけならノードのAABBを下から更新(refit)し, 追加, 削除があったときや木の質(SAHコスト)が落ちたときに作り直す
+     *         外部からは木を作り直しても不変なIDで参照する
+     *         持ち主が毎フレームupdateProxyしてsweepを呼べば, 持ち主ごと消えた(destroyProxyされなかった)プロキシも回収される
+     *         EngineのBVHは全てのワールドで共有するので, sweepはプロキシを作ったもの(owner)ごとに行う
+     */
+    class SceneBVH
+    {
+    public:
+        using ProxyID = std::uint32_t;
+
+        constexpr static ProxyID InvalidID = ~ProxyID(0);
+
+        // 問い合わせで絞り込むためのレイヤー(ビットマスク)
+        constexpr static std::uint32_t LayerMesh         = 1u << 0;
+        constexpr static std::uint32_t LayerSkeletalMesh = 1u << 1;
+        constexpr static std::uint32_t LayerSprite       = 1u << 2;
+        constexpr static std::uint32_t LayerAll          = ~std::uint32_t(0);
+
+        struct AABB
+        {
+            glm::vec3 min;
+            glm::vec3 max;
+        };
+
+        struct RayHit
+        {
+            ProxyID proxy;
+            // AABBに入る位置までの距離(dirの長さ単位)
+            float t;
+        };
+
+        // ローカル空間のAABBをworldで変換し, それを包むAABBを返す
+        static AABB transform(const AABB& local, const glm::mat4& world);
+
+        SceneBVH();
+
+        ~SceneBVH();
+
+        // ownerはsweepで回収する単位(ワールドごとのRenderSystemなど)
+        ProxyID createProxy(const AABB& bounds, const std::uint32_t layer, const std::uint64_t userData = 0, const void* owner = nullptr);
+
+        void destroyProxy(const ProxyID proxy);
+
+        // AABBが変わっていなければ木には何もしない(sweepで回収しない印だけ付ける)
+        void updateProxy(const ProxyID proxy, const AABB& bounds);
+
+        const AABB& getBounds(const ProxyID proxy) const;
+
+        // 呼び出し側がエンティティなどと対応付けるための値
+        void setUserData(const ProxyID proxy, const std::uint64_t userData);
+
+        std::uint64_t getUserData(const ProxyID proxy) const;
+
+        // ownerが作ったlayerMaskのプロキシのうち, 前回のsweepからcreateProxyもupdateProxyもされていないものを破棄し, その数を返す
+        // 自分のワールドの全ての持ち主を毎フレーム走査するSystem(RenderSystem)から呼ぶ, 他のownerのプロキシには触れない
+        std::size_t sweep(const std::uint32_t layerMask, const void* owner = nullptr);
+
+        // 変更を木に反映する, 問い合わせの前に1度呼ぶ
+        void update();
+
+        // 視錐台と交差するプロキシをoutに追加する
+        void queryFrustum(const Frustum& frustum, const std::uint32_t layerMask, std::vector<ProxyID>& out) const;
+
+        // boundsと交差するプロキシをoutに追加する
+        void queryAABB(const AABB& bounds, const std::uint32_t layerMask, std::vector<ProxyID>& out) const;
+
+        // origin + t * dir (0 <= t <= maxT)と交差するAABBのうち最も手前のものを返す
+        bool raycast(const glm::vec3& origin, const glm::vec3& dir, const float maxT, const std::uint32_t layerMask, RayHit& hit) const;
+
+        std::size_t size() const;
+
+    private:
+        constexpr static std::uint32_t InvalidIndex = ~std::uint32_t(0);
+        // 葉に入れるプロキシ数の上限
+        constexpr static std::uint32_t MaxLeafSize = 4;
+        // 木の深さの上限, 走査用のスタックを固定長にするため(超えたら葉に詰める)
+        constexpr static std::uint32_t MaxDepth  = 60;
+        constexpr static std::uint32_t StackSize = MaxDepth + 4;
+        // SAHで分割位置を探すときのビン数
+        constexpr static std::uint32_t BinNum = 16;
+        // refit後のSAHコストが構築時のこの倍率を超えたら作り直す
+        constexpr static float RebuildCostRatio = 1.5f;
+
+        struct Proxy
+        {
+            AABB bounds;
+            std::uint32_t layer;
+            std::uint64_t userData;
+            // createProxyに渡されたもの(sweepの単位)
+            const void* owner;
+            bool alive;
+            // 前回のsweepからcreateProxyかupdateProxyされた
+            bool marked;
+        };
+
+        // countが0なら内部ノードで子はfirstとfirst + 1, そうでなければmLeafProxies[first, first + count)を持つ葉
+        struct Node
+        {
+            AABB bounds;
+            // 子孫のレイヤーの和
+            std::uint32_t layer;
+            std::uint32_t first;
+            std::uint32_t count;
+        };
+
+        // 生きているプロキシから木を作り直す
+        void rebuild();
+
+        void build(const std::uint32_t node, const std::uint32_t begin, const std::uint32_t end, const std::uint32_t depth);
+
+        // 葉から順にAABBを更新し, 更新後のSAHコストを返す
+        float refit();
+
+        void checkProxy(const ProxyID proxy) const;
+
+        std::vector<Proxy> mProxies;
+        std::vector<ProxyID> mFreeIDs;
+
+        // mNodes[0]が根, 子は常に親より後ろにある
+        std::vector<Node> mNodes;
+        std::vector<ProxyID> mLeafProxies;
+
+        std::size_t mSize;
+        float mBuiltCost;
+        bool mStructureChanged;
+        bool mMoved;
+    };
+}  // namespace mall
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef MALL_ENGINE_SPRITEBATCHER_HPP_
+#define MALL_ENGINE_SPRITEBATCHER_HPP_
+
+#include <Cutlass/Cutlass.hpp>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace mall
+{
+    class Graphics;
+
+    /**
+     * @brief 2Dの矩形を1つの頂点バッファに詰め, 同じテクスチャが続く範囲を1回で描画する
+     * @detail 頂点バッファはframeCount個用意してフレームごとに切り替える(GPUが参照中のものには書き込まない)
+     *         インデックスバッファは矩形の並びで固定なので全フレームで共有する
+     *         描画順は追加順のままにする(アルファブレンドのため), 同じテクスチャが連続するほど描画回数が減る
+     */
+    class SpriteBatcher
+    {
+    public:
+        // SpriteData::RenderingInfo::Vertex, TextData::RenderingInfo::Vertexと同じ並び
+        struct Vertex
+        {
+            glm::vec3 pos;
+            glm::vec2 uv;
+            // テクスチャの色に掛ける(テキストの色)
+            glm::vec4 color;
+        };
+
+        SpriteBatcher(Graphics& graphics, const std::uint32_t frameCount);
+
+        ~SpriteBatcher();
+
+        // 前フレームの矩形を捨てて集め直す
+        void clear();
+
+        // 左上, 右上, 左下, 右下の順の矩形を追加する
+        // keyはテクスチャの同一性(SpriteData::textureKeysなど), keyとpipelineが直前と同じなら同じ描画にまとめる
+        // pipelineはrecordに渡すパイプラインの配列の添字
+        void push(const Cutlass::HTexture& texture, const void* key, const Vertex (&vertices)[4], const std::uint32_t pipeline = 0);
+
+        // 描画の並び(テクスチャ, パイプラインと矩形数)のハッシュ, 頂点の位置は含まない
+        std::uint64_t hashBatches(const std::uint64_t seed) const;
+
+        // 次の頂点バッファに移って頂点を転送する
+        // 描画の並びが同じならframeCountフレーム前(同じバッファ)に記録したコマンドを使い回せる
+        void upload();
+
+        // パイプライン, set 0, 頂点, インデックスバッファとテクスチャ(set 1)をbindして描画する
+        // pPipelinesはpushで指定した添字で引く, パイプラインを替えたらset 0も張り直す
+        void record(Cutlass::CommandList& cl, const Cutlass::HGraphicsPipeline* pPipelines, const Cutlass::ShaderResourceSet& bufferSet) const;
+
+        std::size_t getQuadCount() const;
+
+        std::size_t getBatchCount() const;
+
+        // 今使っている頂点バッファの番号[0, getFrameCount())
+        std::size_t getFrameIndex() const;
+
+        std::size_t getFrameCount() const;
+
+    private:
+        struct Batch
+        {
+            Cutlass::HTexture texture;
+            const void* key;
+            std::uint32_t pipeline;
+            std::uint32_t firstQuad;
+            std::uint32_t quadCount;
+        };
+
+        struct Frame
+        {
+            Cutlass::HBuffer vertexBuffer;
+            // 矩形数
+            std::size_t capacity;
+        };
+
+        // 最初に確保する矩形数
+        constexpr static std::size_t InitialCapacity = 256;
+
+        Graphics& mGraphics;
+
+        std::vector<Vertex> mVertices;
+        std::vector<Batch> mBatches;
+
+        std::vector<Frame> mFrames;
+        std::size_t mFrameIndex;
+
+        Cutlass::HBuffer mIndexBuffer;
+        std::size_t mIndexCapacity;
+    };
+}  // namespace mall
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef MALL_ENGINE_SYSTEMSCHEDULER_HPP_
+#define MALL_ENGINE_SYSTEMSCHEDULER_HPP_
+
+#include <functional>
+#include <memory>
+#include <typeindex>
+#include <vector>
+
+#include "JobSystem.hpp"
+
+namespace mall
+{
+    // システムが読み書きする型(コンポーネントやGraphics等のエンジン資源)の宣言
+    class AccessSet
+    {
+    public:
+        template <typename... T>
+        AccessSet& read()
+        {
+            (mReads.emplace_back(typeid(T)), ...);
+            return *this;
+        }
+
+        template <typename... T>
+        AccessSet& write()
+        {
+            (mWrites.emplace_back(typeid(T)), ...);
+            return *this;
+        }
+
+        // 一方が書き込む型を他方が読み書きする場合は同時に実行できない
+        bool conflicts(const AccessSet& other) const;
+
+    private:
+        std::vector<std::type_index> mReads;
+        std::vector<std::type_index> mWrites;
+    };
+
+    // フレーム中に登録されたタスクを, アクセスが衝突しないものどうし並列に実行する
+    // 衝突するタスクは登録順に実行されるため, 逐次実行した場合と結果は変わらない
+    // 描画の準備のようにシミュレーションのステップ数によらず1フレームに1回だけ行う処理はフレームタスクとして別に持つ
+    class SystemScheduler
+    {
+    public:
+        // フレームタスクの実行順, 例えば描画の後に行いたいならeRender + 1とする
+        enum class DefaultFrameTaskOrder
+        {
+            eTextLayout = 128,
+            eRender     = 256,
+        };
+
+        SystemScheduler();
+
+        ~SystemScheduler();
+
+        // メインスレッドから呼ぶこと, taskはdispatchまで実行されない
+        void submit(const AccessSet& access, std::function<void()>&& task);
+
+        // 登録済みのタスクを全て実行し終えるまで待つ
+        void dispatch(JobSystem& jobSystem);
+
+        bool empty() const;
+
+        // 毎フレーム1回, シミュレーション(固定タイムステップ時は0~maxCatchUpStepsステップ)の後にメインスレッドで実行する
+        // SystemのonInitで登録し, onEndでremoveFrameTasksすること
+        void addFrameTask(const void* pOwner, const int order, std::function<void()>&& task);
+
+        // pOwnerが登録したフレームタスクを全て取り除く
+        void removeFrameTasks(const void* pOwner);
+
+        // orderの小さい順(同じなら登録順)に実行する, mall::updateが呼ぶ
+        void runFrameTasks();
+
+    private:
+        struct Node
+        {
+            AccessSet access;
+            std::function<void()> task;
+            std::vector<std::size_t> successors;
+        };
+
+        struct FrameTask
+        {
+            const void* pOwner;
+            int order;
+            std::function<void()> task;
+        };
+
+        void run(JobSystem& jobSystem, JobSystem::Counter& counter, const std::size_t index);
+
+        std::vector<Node> mNodes;
+        // orderで並べてある
+        std::vector<FrameTask> mFrameTasks;
+        // 各タスクの未完了の先行タスク数
+        std::unique_ptr<std::atomic<std::uint32_t>[]> mRemaining;
+        std::size_t mRemainingCapacity;
+    };
+}  // namespace mall
+
+#endif
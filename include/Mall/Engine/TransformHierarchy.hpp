@@ -0,0 +1,82 @@
+#ifndef MALL_ENGINE_TRANSFORMHIERARCHY_HPP_
+#define MALL_ENGINE_TRANSFORMHIERARCHY_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace mall
+{
+    /**
+     * @brief Transformの親子関係を保持し, ワールド行列を伝播する
+     * @detail ノードは深さ順に連続した配列へ並べておき(親は必ず子より前), 先頭から1回走査するだけで全ノードを計算する
+     *         ローカル行列も親も変わっていないノードは計算を省く
+     *         外部からは並べ替えても不変なIDで参照する
+     */
+    class TransformHierarchy
+    {
+    public:
+        using NodeID = std::uint32_t;
+
+        constexpr static NodeID InvalidID = ~NodeID(0);
+
+        TransformHierarchy();
+
+        ~TransformHierarchy();
+
+        // parentがInvalidIDならルート
+        NodeID create(const NodeID parent = InvalidID);
+
+        // 子はルートになる
+        void destroy(const NodeID node);
+
+        // 自身の子孫を親にはできない
+        void setParent(const NodeID node, const NodeID parent);
+
+        NodeID getParent(const NodeID node) const;
+
+        // 親から見たローカル行列
+        void setLocal(const NodeID node, const glm::mat4& local);
+
+        const glm::mat4& getLocal(const NodeID node) const;
+
+        // 変更のあったノードのワールド行列を更新する, 構造が変わっていればその前に並べ直す
+        void propagate();
+
+        // 最後のpropagateの結果
+        const glm::mat4& getWorld(const NodeID node) const;
+
+        // 最後のpropagateでワールド行列が更新されたか
+        bool isChanged(const NodeID node) const;
+
+        std::size_t size() const;
+
+    private:
+        constexpr static std::uint32_t InvalidIndex = ~std::uint32_t(0);
+
+        // 深さ順に並べ直し, 破棄されたノードを詰める
+        void rebuild();
+
+        std::size_t indexOf(const NodeID node) const;
+
+        // ID単位
+        std::vector<NodeID> mParentIDs;
+        // ID -> 詰めた配列上の位置, 未使用のIDにはInvalidIndex
+        std::vector<std::uint32_t> mIndices;
+        std::vector<NodeID> mFreeIDs;
+
+        // 深さ順に詰めた配列, 破棄済みの要素はrebuildまでmIDsがInvalidIDのまま残る
+        std::vector<NodeID> mIDs;
+        std::vector<std::uint32_t> mParents;
+        std::vector<glm::mat4> mLocals;
+        std::vector<glm::mat4> mWorlds;
+        std::vector<std::uint8_t> mDirty;
+        std::vector<std::uint8_t> mChanged;
+
+        std::size_t mSize;
+        bool mStructureChanged;
+    };
+}  // namespace mall
+
+#endif
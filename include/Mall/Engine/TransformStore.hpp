@@ -0,0 +1,125 @@
+#ifndef MALL_ENGINE_TRANSFORMSTORE_HPP_
+#define MALL_ENGINE_TRANSFORMSTORE_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace mall
+{
+    /**
+     * @brief 移動するエンティティのTransformをstructure of arrays形式で保持する
+     * @detail 要素は常に[0, size())に詰めて並べ, SIMDでまとめて積分できるようにする
+     *         外部からは要素の位置が変わっても不変なIDで参照する
+     */
+    class TransformStore
+    {
+    public:
+        using ID = std::uint32_t;
+
+        constexpr static ID InvalidID = ~ID(0);
+
+        TransformStore();
+
+        ~TransformStore();
+
+        ID create(const glm::vec3& pos, const glm::vec3& vel, const glm::vec3& acc, const glm::vec3& scale, const glm::quat& rot);
+
+        void destroy(const ID id);
+
+        // 所有者(TransformData)が残っていることを示す, 異なるIDなら複数スレッドから同時に呼び出せる
+        // ownerはmarkしたもの(TransformSystem)の識別, ストアは全てのワールドで共有するのでワールドごとに分けて回収する
+        void mark(const ID id, const void* owner);
+
+        // ownerがmarkしたもののうち, 前回のsweep以降にmarkもcreateもされなかったものを破棄し, 破棄した数を返す
+        // TransformSystemが自分のワールドの全てのTransformDataをmarkしてから呼ぶので, エンティティごと破棄されたものの領域が回収される
+        // 他のownerのもの(今フレーム更新されないワールドのものなど)と, まだ1度もmarkされていないものには触れない
+        std::size_t sweep(const void* owner);
+
+        std::size_t size() const;
+
+        glm::vec3 getPos(const ID id) const;
+        glm::vec3 getVel(const ID id) const;
+        glm::vec3 getAcc(const ID id) const;
+        glm::vec3 getScale(const ID id) const;
+        glm::quat getRot(const ID id) const;
+
+        void setPos(const ID id, const glm::vec3& pos);
+        void setVel(const ID id, const glm::vec3& vel);
+        void setAcc(const ID id, const glm::vec3& acc);
+        void setScale(const ID id, const glm::vec3& scale);
+        void setRot(const ID id, const glm::quat& rot);
+
+        // 半陰的Euler法(vel += acc * dt, pos += vel * dt)で[begin, end)を積分する
+        // 範囲が重ならなければ複数スレッドから同時に呼び出せる
+        void integrate(const float deltaTime, const std::size_t begin, const std::size_t end);
+
+        void integrate(const float deltaTime);
+
+        // [begin, end)のワールド行列(translate * rotate * scale)を合成する
+        // 範囲が重ならなければ複数スレッドから同時に呼び出せる
+        void composeWorld(const std::size_t begin, const std::size_t end);
+
+        void composeWorld();
+
+        // 最後にcomposeWorldした時点の値
+        const glm::mat4& getWorld(const ID id) const;
+
+        // [0, size())に詰めたワールド行列の配列, 転送用
+        const glm::mat4* getWorldData() const;
+
+    private:
+        // x, y, z成分ごとの配列
+        struct Vec3Array
+        {
+            void push(const glm::vec3& v);
+            void pop();
+            void set(const std::size_t index, const glm::vec3& v);
+            glm::vec3 get(const std::size_t index) const;
+            void move(const std::size_t from, const std::size_t to);
+
+            std::vector<float> x;
+            std::vector<float> y;
+            std::vector<float> z;
+        };
+
+        // x, y, z, w成分ごとの配列
+        struct QuatArray
+        {
+            void push(const glm::quat& q);
+            void pop();
+            void set(const std::size_t index, const glm::quat& q);
+            glm::quat get(const std::size_t index) const;
+            void move(const std::size_t from, const std::size_t to);
+
+            std::vector<float> x;
+            std::vector<float> y;
+            std::vector<float> z;
+            std::vector<float> w;
+        };
+
+        std::size_t indexOf(const ID id) const;
+
+        Vec3Array mPos;
+        Vec3Array mVel;
+        Vec3Array mAcc;
+        Vec3Array mScale;
+        QuatArray mRot;
+        std::vector<glm::mat4> mWorlds;
+
+        // ID -> 詰めた配列上の位置, 未使用のIDにはInvalidID
+        std::vector<std::uint32_t> mIndices;
+        // 配列上の位置 -> ID
+        std::vector<ID> mIDs;
+        std::vector<ID> mFreeIDs;
+        // IDごとの印(mark, sweep)
+        std::vector<std::uint8_t> mMarks;
+        // IDごとに最後にmarkしたもの, 1度もmarkされていなければnullptr
+        std::vector<const void*> mOwners;
+    };
+}  // namespace mall
+
+#endif
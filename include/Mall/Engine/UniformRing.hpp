@@ -0,0 +1,69 @@
+#ifndef MALL_ENGINE_UNIFORMRING_HPP_
+#define MALL_ENGINE_UNIFORMRING_HPP_
+
+#include <Cutlass/Cutlass.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace mall
+{
+    class Graphics;
+
+    /**
+     * @brief 1フレーム分の定数をまとめて書き込む一様バッファの線形アロケータ
+     * @detail blockSizeバイトのバッファをフレームごとに先頭から順に切り出して使い, flushで使った分だけブロック単位で転送する
+     *         ブロックの組はframeCount(同時に処理中になり得るフレーム数)個用意して順番に使うので, GPUが参照中のものには書き込まない
+     *         エンティティごとに一様バッファを持つ必要が無くなり, 転送回数もブロック数まで減る
+     */
+    class UniformRing
+    {
+    public:
+        struct Allocation
+        {
+            Cutlass::HBuffer buffer;
+            std::size_t offset;  // buffer先頭からのバイト数
+            void* pData;         // flushまでに書き込むこと
+        };
+
+        // blockSizeは16の倍数
+        UniformRing(Graphics& graphics, const std::size_t blockSize, const std::uint32_t frameCount);
+
+        ~UniformRing();
+
+        // フレームの最初に呼ぶ, 次の組に移り先頭から使い直す
+        // 同じ順序, 同じサイズで確保すればframeCountフレーム前(同じ組)と同じバッファ, オフセットが返るので
+        // 組ごとに記録しておいたコマンドを使い回せる
+        void beginFrame();
+
+        // sizeバイト(blockSize以下)をalignmentの倍数の位置に確保する, 今のブロックに入らなければ次のブロックを使う
+        Allocation allocate(const std::size_t size, const std::size_t alignment = 16);
+
+        // 今フレームで使ったブロックを転送する
+        void flush();
+
+        std::size_t getBlockSize() const;
+
+        // 今使っている組の番号[0, getFrameCount())
+        std::size_t getFrameIndex() const;
+
+        std::size_t getFrameCount() const;
+
+    private:
+        struct Block
+        {
+            Cutlass::HBuffer buffer;
+            std::vector<std::uint8_t> data;
+            std::size_t used;
+        };
+
+        Graphics& mGraphics;
+        const std::size_t mBlockSize;
+
+        std::vector<std::vector<Block>> mFrames;
+        std::size_t mFrameIndex;
+        // mFrames[mFrameIndex]のうち今フレームで使ったブロック数
+        std::size_t mBlockCount;
+    };
+}  // namespace mall
+
+#endif
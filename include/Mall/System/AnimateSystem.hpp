@@ -22,31 +22,39 @@ namespace mall
 
         virtual void onUpdate()
         {
-            const double& deltaTime = this->common().deltaTime;
-
-            auto&& lmdUpdateSkeleton = [&](SkeletalMeshData& skeletalMesh)
-            {
-                auto& skeleton = skeletalMesh.skeleton.get();
-                auto& scene = skeleton.scene.get();
-                if (skeletalMesh.animationIndex >= scene.mNumAnimations)
+            // SkeletalMeshDataのみ触るので, AudioSystemと並列に実行される
+            this->common().scheduler->submit(
+                AccessSet().write<SkeletalMeshData>(),
+                [this]()
                 {
-                    assert(!"invalid animation index!");
-                    return;
-                }
+                    MALL_PROFILE_SCOPE(this->common().profiler, "AnimateSystem::onUpdate");
 
-                float updateTime = scene.mAnimations[skeletalMesh.animationIndex]->mTicksPerSecond;
-                if (updateTime == 0)
-                {
-                    assert(!"zero update time!");
-                    updateTime = 25.f;  //?
-                }
+                    const double& deltaTime = this->common().deltaTime;
+
+                    auto&& lmdUpdateSkeleton = [&](SkeletalMeshData& skeletalMesh)
+                    {
+                        auto& skeleton = skeletalMesh.skeleton.get();
+                        auto& scene = skeleton.scene.get();
+                        if (skeletalMesh.animationIndex >= scene.mNumAnimations)
+                        {
+                            assert(!"invalid animation index!");
+                            return;
+                        }
+
+                        float updateTime = scene.mAnimations[skeletalMesh.animationIndex]->mTicksPerSecond;
+                        if (updateTime == 0)
+                        {
+                            assert(!"zero update time!");
+                            updateTime = 25.f;  //?
+                        }
 
-                skeleton.traverseNode(fmod(mNowSecond * updateTime, scene.mAnimations[skeletalMesh.animationIndex]->mDuration), skeletalMesh.animationIndex, scene.mRootNode, glm::mat4(1.f), skeletalMesh.defaultAxis);
-            };
+                        skeleton.traverseNode(fmod(mNowSecond * updateTime, scene.mAnimations[skeletalMesh.animationIndex]->mDuration), skeletalMesh.animationIndex, scene.mRootNode, glm::mat4(1.f), skeletalMesh.defaultAxis);
+                    };
 
-            this->template forEach<SkeletalMeshData>(lmdUpdateSkeleton);
+                    this->template forEach<SkeletalMeshData>(lmdUpdateSkeleton);
 
-            mNowSecond += deltaTime;
+                    mNowSecond += deltaTime;
+                });
         }
 
         virtual void onEnd()
@@ -21,13 +21,21 @@ namespace mall
 
         virtual void onUpdate()
         {
-            this->template forEach<mall::SoundData>(
-                [&](mall::SoundData& sound)
+            // SoundDataのみ触るので, AnimateSystemと並列に実行される
+            this->common().scheduler->submit(
+                AccessSet().write<SoundData>(),
+                [this]()
                 {
-                    if (sound.playFlag)
-                    {
-                        sound.playingDuration += this->common().deltaTime;
-                    }
+                    MALL_PROFILE_SCOPE(this->common().profiler, "AudioSystem::onUpdate");
+
+                    this->template forEach<mall::SoundData>(
+                        [&](mall::SoundData& sound)
+                        {
+                            if (sound.playFlag)
+                            {
+                                sound.playingDuration += this->common().deltaTime;
+                            }
+                        });
                 });
         }
 
@@ -8,6 +8,7 @@
 #include "AudioSystem.hpp"
 #include "PhysicsSystem.hpp"
 #include "RenderSystem.hpp"
+#include "SchedulerSystem.hpp"
 #include "TextSystem.hpp"
 #include "TransformSystem.hpp"
 
@@ -24,6 +25,7 @@ namespace mall
             eAnimateSystem   = std::numeric_limits<int>::max() - (1 << 6),
             eAudioSystem     = std::numeric_limits<int>::max() - (1 << 6),
             eTextSystem      = std::numeric_limits<int>::max() - (1 << 6),
+            eSchedulerSystem = std::numeric_limits<int>::max() - (1 << 6) + 1,  // 同じ順序のAnimate, Audioを並列実行する
             eTransformSystem = std::numeric_limits<int>::max() - (1 << 5),
             ePhysicsSystem   = std::numeric_limits<int>::max() - (1 << 4),
             eRenderSystem    = std::numeric_limits<int>::max() - (1 << 3),
@@ -34,6 +36,7 @@ namespace mall
             this->template addSystem<mall::AnimateSystem<Key, Common>>(static_cast<int>(DefaultExecOrder::eAnimateSystem));
             this->template addSystem<mall::AudioSystem<Key, Common>>(static_cast<int>(DefaultExecOrder::eAudioSystem));
             this->template addSystem<mall::TextSystem<Key, Common>>(static_cast<int>(DefaultExecOrder::eTextSystem));
+            this->template addSystem<mall::SchedulerSystem<Key, Common>>(static_cast<int>(DefaultExecOrder::eSchedulerSystem));
             this->template addSystem<mall::TransformSystem<Key, Common>>(static_cast<int>(DefaultExecOrder::eTransformSystem));
             this->template addSystem<mall::PhysicsSystem<Key, Common>>(static_cast<int>(DefaultExecOrder::ePhysicsSystem));
             this->template addSystem<mall::RenderSystem<Key, Common>>(static_cast<int>(DefaultExecOrder::eRenderSystem));
@@ -42,6 +45,8 @@ namespace mall
 
         virtual void onUpdate()
         {
+            MALL_PROFILE_SCOPE(this->common().profiler, "EngineBasicSystem::onUpdate");
+
             if (this->common().input->getKey(Cutlass::Key::Escape))
                 this->endAll();
         }
@@ -7,6 +7,7 @@
 
 #include "../ComponentData/RigidBodyData.hpp"
 #include "../Engine.hpp"
+#include "../Utility/ParallelForEach.hpp"
 
 namespace mall
 {
@@ -22,43 +23,43 @@ namespace mall
 
         virtual void onUpdate()
         {
-            {
-                std::function<void(RigidBodyData&, TransformData&)>&& lmdApplyTransform = [&](RigidBodyData& rigidBody, TransformData& transform)
-                {
-                    if (!rigidBody.isStatic)
-                        return;
-                    auto& btTrans = rigidBody.rigidBody.get().getWorldTransform();
-                    btTrans.setOrigin(btVector3(transform.pos.x, transform.pos.y, transform.pos.z));
-                    btTrans.setRotation(btQuaternion(transform.rot.x, transform.rot.y, transform.rot.z, transform.rot.w));
-                };
+            MALL_PROFILE_SCOPE(this->common().profiler, "PhysicsSystem::onUpdate");
+
+            auto& jobSystem = *this->common().jobSystem;
 
-                this->template forEach<RigidBodyData, TransformData>(lmdApplyTransform);
+            {
+                this->template forEach<RigidBodyData, TransformData>(mApplyTransform.collect());
+                mApplyTransform.run(jobSystem,
+                                    [](RigidBodyData& rigidBody, TransformData& transform)
+                                    {
+                                        if (!rigidBody.isStatic)
+                                            return;
+                                        auto& btTrans  = rigidBody.rigidBody.get().getWorldTransform();
+                                        const auto pos = transform.getPos();
+                                        const auto rot = transform.getRot();
+                                        btTrans.setOrigin(btVector3(pos.x, pos.y, pos.z));
+                                        btTrans.setRotation(btQuaternion(rot.x, rot.y, rot.z, rot.w));
+                                    });
             }
 
+            // 並列に実行されるため, 行列の一時領域はジョブごとに持つ
+            auto&& lmdUpdateWorldMatrix = [](RigidBodyData& rigidBody, MeshData& mesh)
             {
-                std::function<void(RigidBodyData&, MeshData&)>&& lmdUpdateWorldMatrix = [&](RigidBodyData& rigidBody, MeshData& mesh)
-                {
-                    static float mem[16];
-                    if (rigidBody.isStatic)
-                        return;
-                    rigidBody.rigidBody.get().getWorldTransform().getOpenGLMatrix(mem);
-                    mesh.world = glm::make_mat4(mem);
-                };
+                float mem[16];
+                if (rigidBody.isStatic)
+                    return;
+                rigidBody.rigidBody.get().getWorldTransform().getOpenGLMatrix(mem);
+                mesh.world = glm::make_mat4(mem);
+            };
 
-                this->template forEach<RigidBodyData, MeshData>(lmdUpdateWorldMatrix);
+            {
+                this->template forEach<RigidBodyData, MeshData>(mUpdateMeshWorld.collect());
+                mUpdateMeshWorld.run(jobSystem, lmdUpdateWorldMatrix);
             }
 
             {
-                std::function<void(RigidBodyData&, SkeletalMeshData&)>&& lmdUpdateWorldMatrix = [&](RigidBodyData& rigidBody, MeshData& mesh)
-                {
-                    static float mem[16];
-                    if (rigidBody.isStatic)
-                        return;
-                    rigidBody.rigidBody.get().getWorldTransform().getOpenGLMatrix(mem);
-                    mesh.world = glm::make_mat4(mem);
-                };
-
-                this->template forEach<RigidBodyData, SkeletalMeshData>(lmdUpdateWorldMatrix);
+                this->template forEach<RigidBodyData, SkeletalMeshData>(mUpdateSkeletalMeshWorld.collect());
+                mUpdateSkeletalMeshWorld.run(jobSystem, lmdUpdateWorldMatrix);
             }
         }
 
@@ -66,6 +67,11 @@ namespace mall
         {
 
         }
+
+    protected:
+        ParallelForEach<RigidBodyData, TransformData> mApplyTransform;
+        ParallelForEach<RigidBodyData, MeshData> mUpdateMeshWorld;
+        ParallelForEach<RigidBodyData, SkeletalMeshData> mUpdateSkeletalMeshWorld;
     };
 }  // namespace mall
 
@@ -11,15 +11,31 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <tuple>
+
 #include "../ComponentData/CameraData.hpp"
 #include "../ComponentData/LightData.hpp"
 #include "../ComponentData/MaterialData.hpp"
 #include "../ComponentData/MeshData.hpp"
 #include "../ComponentData/RigidBodyData.hpp"
 #include "../ComponentData/SkeletalMeshData.hpp"
+#include "../ComponentData/SpriteData.hpp"
 #include "../ComponentData/TransformData.hpp"
 #include "../Engine.hpp"
 #include "../Engine/Graphics.hpp"
+#include "../Engine/SceneBVH.hpp"
+#include "../Engine/SpriteBatcher.hpp"
+#include "../Engine/UniformRing.hpp"
+#include "../Utility/Frustum.hpp"
+#include "../Utility/Hash.hpp"
+#include "../Utility/RadixSort.hpp"
+#include "../Utility/TransformMath.hpp"
 
 namespace mall
 {
@@ -61,6 +77,11 @@ namespace mall
             mLightingPass = graphics->getRenderPass(Graphics::DefaultRenderPass::eLighting);
             mSpritePass = graphics->getRenderPass(Graphics::DefaultRenderPass::eSprite);
 
+            // 有効なカメラが無い間の値
+            mSceneView        = glm::mat4(1.f);
+            mSceneProj        = glm::mat4(1.f);
+            mCameraPos        = glm::vec3(0.f);
+            mDrawJobItemCount = 0;
 
             {
                 Cutlass::GraphicsPipelineInfo gpi(
@@ -73,6 +94,22 @@ namespace mall
                 mGeometryPipeline = graphics->getGraphicsPipeline(gpi);
             }
 
+            // インスタンシング版のシェーダが無ければ従来通りエンティティごとに描画する
+            mInstancing = std::filesystem::exists(InstancedVertexShaderPath) && std::filesystem::exists(InstancedFragmentShaderPath);
+            if (mInstancing)
+            {
+                Cutlass::GraphicsPipelineInfo gpi(
+                    Cutlass::Shader(InstancedVertexShaderPath),
+                    Cutlass::Shader(InstancedFragmentShaderPath),
+                    mGeometryPass,
+                    Cutlass::DepthStencilState::eDepth,
+                    Cutlass::RasterizerState(Cutlass::PolygonMode::eFill, Cutlass::CullMode::eBack, Cutlass::FrontFace::eCounterClockwise));
+
+                mInstancedGeometryPipeline = graphics->getGraphicsPipeline(gpi);
+            }
+            else
+                std::cerr << "instanced GBuffer shader was not found, instancing is disabled\n";
+
             {
                 Cutlass::GraphicsPipelineInfo gpi(
                     Cutlass::Shader("resources/shaders/deferred/Lighting_vert.spv"),
@@ -98,6 +135,25 @@ namespace mall
                 mSpritePipeline = graphics->getGraphicsPipeline(gpi);
             }
 
+            // 距離場のシェーダが無ければ距離場のテキストも通常のグリフで描画する
+            mSDFText = std::filesystem::exists(SDFTextFragmentShaderPath);
+            if (mSDFText)
+            {
+                Cutlass::GraphicsPipelineInfo gpi(
+                    Cutlass::Shader("resources/shaders/sprite/Sprite_vert.spv"),
+                    Cutlass::Shader(SDFTextFragmentShaderPath),
+                    mSpritePass,
+                    Cutlass::DepthStencilState::eNone,
+                    Cutlass::RasterizerState(Cutlass::PolygonMode::eFill, Cutlass::CullMode::eNone, Cutlass::FrontFace::eClockwise),
+                    Cutlass::Topology::eTriangleList,
+                    Cutlass::ColorBlend::eAlphaBlend);
+
+                mSDFTextPipeline = graphics->getGraphicsPipeline(gpi);
+            }
+            else
+                std::cerr << "SDF sprite shader was not found, SDF text is disabled\n";
+            this->common().glyphAtlas->setSDFEnabled(mSDFText);
+
             {
                 Cutlass::BufferInfo bi;
 
@@ -143,6 +199,14 @@ namespace mall
 
                 bi.setUniformBuffer<SkeletalMeshData::RenderingInfo::BoneCBParam>();
                 mDummyBoneCB = graphics->createBuffer(bi);
+
+                // SceneCBParamはバインドの単位なので1ブロックに1つずつ置く
+                static_assert(sizeof(MeshData::RenderingInfo::SceneCBParam) == sizeof(SkeletalMeshData::RenderingInfo::SceneCBParam));
+                const std::uint32_t frameCount = graphics->getFrameCount();
+                mSceneRing                     = std::make_unique<UniformRing>(*graphics, sizeof(MeshData::RenderingInfo::SceneCBParam), frameCount);
+                mBoneRing                      = std::make_unique<UniformRing>(*graphics, sizeof(SkeletalMeshData::RenderingInfo::BoneCBParam), frameCount);
+                mInstanceRing                  = std::make_unique<UniformRing>(*graphics, sizeof(MeshData::RenderingInfo::InstanceCBParam), frameCount);
+                mGeometryStreamHashes.assign(mSceneRing->getFrameCount(), 0);
                 {
                     SkeletalMeshData::RenderingInfo::BoneCBParam param;
                     for (std::size_t i = 0; i < SkeletalMeshData::RenderingInfo::MaxBoneNum; ++i)
@@ -151,13 +215,8 @@ namespace mall
                 }
 
                 {
-                    std::array<uint32_t, 6> indices =
-                        {{0, 2, 1, 1, 2, 3}};
-
-                    Cutlass::BufferInfo bi;
-                    bi.setIndexBuffer<uint32_t>(6);
-                    mSpriteIB = graphics->createBuffer(bi);
-                    graphics->writeBuffer(6 * sizeof(uint32_t), indices.data(), mSpriteIB);
+                    mSpriteBatcher = std::make_unique<SpriteBatcher>(*graphics, frameCount);
+                    mSpriteStreamHashes.assign(mSpriteBatcher->getFrameCount(), 0);
 
                     std::uint32_t width, height;
                     graphics->getWindowSize(width, height);
@@ -202,33 +261,98 @@ namespace mall
                 cl.end();
                 graphics->writeCommand(Graphics::DefaultRenderPass::eLighting, cl);
             }
+
+            // 固定タイムステップ時もシミュレーションのステップ数によらず1フレームに1回だけ描画する
+            this->common().scheduler->addFrameTask(this, static_cast<int>(SystemScheduler::DefaultFrameTaskOrder::eRender), [this]() { render(); });
         }
 
         virtual void onUpdate()
         {
+            // 描画はフレームタスク(render)で行う
+        }
+
+        virtual void onEnd()
+        {
+            this->common().scheduler->removeFrameTasks(this);
+
             std::unique_ptr<Graphics>& graphics = this->common().graphics;
+            graphics->destroyBuffer(mLightCB);
+            graphics->destroyBuffer(mShadowCB);
+            graphics->destroyBuffer(mCameraCB);
+            graphics->destroyBuffer(mDummyBoneCB);
+            mSceneRing.reset();
+            mBoneRing.reset();
+            mInstanceRing.reset();
+            mSpriteBatcher.reset();
+
+            // this->template forEach<MeshData>(
+            //     [&](MeshData& mesh)
+            //     {
+            //         graphics->destroyBuffer(mesh.renderingInfo.sceneCB);
+            //     });
+
+            // this->template forEach<SkeletalMeshData>(
+            //     [&](SkeletalMeshData& skeletalMesh)
+            //     {
+            //         graphics->destroyBuffer(skeletalMesh.renderingInfo.sceneCB);
+            //         graphics->destroyBuffer(skeletalMesh.renderingInfo.boneCB);
+            //     });
+
+            // this->template forEach<SpriteData>(
+            //     [&](SpriteData& sprite)
+            //     {
+            //         graphics->destroyBuffer(sprite.renderingInfo.spriteVB);
+            //     });
+
+            // this->template forEach<TextData>(
+            //     [&](TextData& text)
+            //     {
+            //         graphics->destroyBuffer(text.renderingInfo.spriteVB);
+            //     });
+
+        }
+
+    protected:
+        void render()
+        {
+            MALL_PROFILE_SCOPE(this->common().profiler, "RenderSystem::render");
+
+            std::unique_ptr<Graphics>& graphics = this->common().graphics;
+
+            // 固定タイムステップ時は前のステップとの間を補間した位置に描く
+            mInterpolationAlpha = static_cast<float>(this->common().interpolationAlpha);
+            mInterpolate        = this->common().fixedTimeStep.enable && mInterpolationAlpha < 1.f;
+
+            // 参照先のバッファ, テクスチャが作り直されていれば記録済みのコマンドは使えない
+            const std::uint64_t resourceHash = hashCombine(hashCombine(HashSeed, graphics->getResourceGeneration()), this->common().resourceBank->getGeneration());
 
             static MeshData::RenderingInfo::SceneCBParam meshSceneCBParam;
-            static SkeletalMeshData::RenderingInfo::SceneCBParam skeletalSceneCBParam;
-            static SkeletalMeshData::RenderingInfo::BoneCBParam boneCBParam;
             static CameraData::RenderingInfo::CameraCBParam cameraCBParam;
             static LightData::RenderingInfo::LightCBParam lightCBParam[LightData::RenderingInfo::MaxLightNum];
             // static LightData::RenderingInfo::ShadowCBParam shadowCBParam;
 
+            // 有効なカメラが無ければカリングしない
+            mCulling = false;
+
             {
                 std::function<void(CameraData&, TransformData&)> f =
                     [&](CameraData& camera, TransformData& transform)
                 {
                     if (camera.enable)
                     {
-                        cameraCBParam.cameraPos = transform.pos;
-                        auto view               = glm::lookAtRH(transform.pos, camera.lookPos, camera.up);
+                        cameraCBParam.cameraPos = transform.getPos();
+                        auto view               = glm::lookAtRH(transform.getPos(), camera.lookPos, camera.up);
                         auto&& proj             = glm::perspective(camera.fovY, camera.aspect, camera.near, camera.far);
                         view[1][1] *= -1.f;
                         meshSceneCBParam.view     = view;
                         meshSceneCBParam.proj     = proj;
-                        skeletalSceneCBParam.view = view;
-                        skeletalSceneCBParam.proj = proj;
+                        mSceneView                = view;
+                        mSceneProj                = proj;
+                        mCameraPos                = transform.getPos();
+
+                        // シェーダと同じ行列から取り出す
+                        mFrustum.setup(proj * view);
+                        mCulling = true;
                     }
                 };
 
@@ -253,7 +377,7 @@ namespace mall
                             break;
                         case LightData::LightType::ePoint:
                             lightCBParam[lightCount].lightType  = static_cast<std::uint32_t>(LightData::LightType::ePoint);
-                            lightCBParam[lightCount].lightPos   = transform.pos;
+                            lightCBParam[lightCount].lightPos   = transform.getPos();
                             lightCBParam[lightCount].lightRange = light.range;
                             break;
                     }
@@ -266,289 +390,595 @@ namespace mall
 
             graphics->writeBuffer(sizeof(LightData::RenderingInfo::LightCBParam) * LightData::RenderingInfo::MaxLightNum, &lightCBParam, mLightCB);
 
-            Cutlass::CommandList cl;
-            bool debug = false;
-            //cl.begin(mGeometryPass, {1.f, 0}, {0.2f, 0.2f, 0.2f, 0});
-            cl.clear();
-            cl.begin(mGeometryPass);
+            std::unique_ptr<SceneBVH>& sceneBVH  = this->common().sceneBVH;
+            std::unique_ptr<SceneBVH>& spriteBVH = this->common().spriteBVH;
 
-            {  // mesh
-                std::function<void(MeshData&, MaterialData&)> f =
-                    [&](MeshData& mesh, MaterialData& material)
+            {  // BVH
+                // ワールド行列の書き込みは全てこのSystemより前に終わっているので, ここでワールド空間のAABBを反映する
+                auto&& lmdBindPoseBounds = [](const MeshData& mesh)
                 {
-                    meshSceneCBParam.world         = mesh.world * mesh.defaultAxis;
-                    meshSceneCBParam.lighting      = 1;
-                    meshSceneCBParam.receiveShadow = 0;
-                    meshSceneCBParam.useBone       = 0;
-
-                    graphics->writeBuffer(sizeof(MeshData::RenderingInfo::SceneCBParam), &meshSceneCBParam, mesh.renderingInfo.sceneCB);
-
-                    Cutlass::ShaderResourceSet bufferSet, textureSet;
+                    SceneBVH::AABB local{ mesh.meshes[0].aabbMin, mesh.meshes[0].aabbMax };
+                    for (std::size_t i = 1; i < mesh.meshes.size(); ++i)
+                    {
+                        local.min = glm::min(local.min, mesh.meshes[i].aabbMin);
+                        local.max = glm::max(local.max, mesh.meshes[i].aabbMax);
+                    }
 
-                    bufferSet.bind(0, mesh.renderingInfo.sceneCB);
-                    bufferSet.bind(1, mDummyBoneCB);
-                    assert(material.textures.size() > 0 || !"material texture is empty!");
-                    textureSet.bind(0, material.textures.begin()->handle);
+                    return local;
+                };
 
-                    cl.bind(mGeometryPipeline);
-                    cl.bind(0, bufferSet);
-                    for (std::size_t i = 0; i < mesh.meshes.size(); ++i)
+                auto&& lmdSync = [&](MeshData& mesh, const std::uint32_t layer, const SceneBVH::AABB& local)
+                {
+                    const auto bounds = SceneBVH::transform(local, getRenderWorld(mesh) * mesh.defaultAxis);
+                    if (mesh.bvhProxy == SceneBVH::InvalidID)
+                        mesh.bvhProxy = sceneBVH->createProxy(bounds, layer, mesh.bvhUserData, this);
+                    else
                     {
-                        auto& m = mesh.meshes[i];
-                        textureSet.bind(0, material.textures[i].handle);
-                        cl.bind(1, textureSet);
-                        cl.bind(m.VB, m.IB);
-                        cl.renderIndexed(m.indices.size());
-                        debug = true;
+                        sceneBVH->updateProxy(mesh.bvhProxy, bounds);
+                        sceneBVH->setUserData(mesh.bvhProxy, mesh.bvhUserData);
                     }
                 };
 
-                this->template forEach<MeshData, MaterialData>(f);
+                this->template forEach<MeshData>(
+                    [&](MeshData& mesh)
+                    {
+                        if (mesh.meshes.size() > 0)
+                            lmdSync(mesh, SceneBVH::LayerMesh, lmdBindPoseBounds(mesh));
+                    });
+
+                this->template forEach<SkeletalMeshData>(
+                    [&](SkeletalMeshData& mesh)
+                    {
+                        if (mesh.meshes.size() == 0)
+                            return;
+
+                        // バインドポーズの境界では動いた手足がはみ出して消えるので, ボーンごとの頂点の範囲を今の姿勢で動かした和を使う
+                        // 頂点はそれを動かすボーンで変換した点の重み付き平均なので, この和に収まる
+                        SceneBVH::AABB local{ glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max()) };
+                        if (mesh.skeleton.isCreated())
+                            for (const auto& bone : mesh.skeleton.get().bones)
+                            {
+                                if (bone.aabbMin.x > bone.aabbMax.x)
+                                    continue;
+
+                                const auto posed = SceneBVH::transform(SceneBVH::AABB{ bone.aabbMin, bone.aabbMax }, bone.transform);
+                                local.min        = glm::min(local.min, posed.min);
+                                local.max        = glm::max(local.max, posed.max);
+                            }
+
+                        // ボーンで動かす頂点が無ければバインドポーズのまま
+                        lmdSync(mesh, SceneBVH::LayerSkeletalMesh, local.min.x <= local.max.x ? local : lmdBindPoseBounds(mesh));
+                    });
+
+                // 上で触れなかったプロキシは持ち主がエンティティごと消えている(他のワールドのプロキシはそのワールドのRenderSystemが回収する)
+                sceneBVH->sweep(SceneBVH::LayerMesh | SceneBVH::LayerSkeletalMesh, this);
+                sceneBVH->update();
+
+                // 前フレームの結果を消してから視錐台内のプロキシに印を付ける
+                for (const auto proxy : mVisibleProxies)
+                    mProxyVisible[proxy] = 0;
+                mVisibleProxies.clear();
+
+                if (mCulling)
+                    sceneBVH->queryFrustum(mFrustum, SceneBVH::LayerMesh | SceneBVH::LayerSkeletalMesh, mVisibleProxies);
+
+                for (const auto proxy : mVisibleProxies)
+                {
+                    if (proxy >= mProxyVisible.size())
+                        mProxyVisible.resize(proxy + 1, 0);
+                    mProxyVisible[proxy] = 1;
+                }
             }
 
-            {  // skeletal mesh
-                std::function<void(SkeletalMeshData&, MaterialData&)> f =
-                    [&](SkeletalMeshData& mesh, MaterialData& material)
+            bool debug = false;
+
+            // 視錐台の外のメッシュは定数の書き込みも描画も行わない
+            auto&& lmdVisible = [&](const glm::mat4& world, const MeshData::Mesh& m)
+            {
+                return !mCulling || mFrustum.intersects(world, m.boundingSphere);
+            };
+
+            // BVHに登録済みならエンティティ単位の判定は済んでいる
+            auto&& lmdAnyVisible = [&](MeshData& mesh)
+            {
+                if (!mCulling)
+                    return true;
+
+                if (mesh.bvhProxy != SceneBVH::InvalidID)
+                    return mesh.bvhProxy < mProxyVisible.size() && mProxyVisible[mesh.bvhProxy] != 0;
+
+                const glm::mat4 world = getRenderWorld(mesh) * mesh.defaultAxis;
+                for (std::size_t i = 0; i < mesh.meshes.size(); ++i)
+                    if (lmdVisible(world, mesh.meshes[i]))
+                        return true;
+
+                return false;
+            };
+
+            // 描画はいったん全て集め, キーで並べてから状態が変わったときだけbindする
+            mDrawItems.clear();
+            mDrawKeys.clear();
+            mDrawJobs.clear();
+            mDrawJobItemCount = 0;
+
+            // 描画するエンティティを集めるだけで, 定数の確保は構成を比べてから行う
+            auto&& lmdCollect = [&](MeshData& mesh, MaterialData& material, SkeletalMeshData* pSkeletal)
+            {
+                if (!lmdAnyVisible(mesh))
+                    return;
+
+                assert(material.textures.size() > 0 || !"material texture is empty!");
+
+                DrawJob job{};
+                job.pMesh     = &mesh;
+                job.pMaterial = &material;
+                job.pSkeletal = pSkeletal;
+                job.firstItem = mDrawJobItemCount;
+
+                mDrawJobs.emplace_back(job);
+                mDrawJobItemCount += mesh.meshes.size();
+            };
+
+            auto&& lmdPush = [&](const DrawItem& item, const glm::mat4& world)
+            {
+                mDrawKeys.emplace_back(makeDrawKey(GeometryPassKey, item.pipeline, item.pTexture, item.pMesh, glm::vec3(world[3]), mCameraPos));
+                mDrawItems.emplace_back(item);
+            };
+
+            mMeshInstances.clear();
+
+            {  // mesh
+                if (!mInstancing)
+                    this->template forEach<MeshData, MaterialData>([&](MeshData& mesh, MaterialData& material) { lmdCollect(mesh, material, nullptr); });
+                else
                 {
-                    skeletalSceneCBParam.world         = mesh.world * mesh.defaultAxis;
-                    skeletalSceneCBParam.lighting      = 1;
-                    skeletalSceneCBParam.receiveShadow = 0;
-                    skeletalSceneCBParam.useBone       = 1;
+                    // ResourceBankは同じファイルから作ったメッシュ, マテリアルで配列を共有するので, そのアドレスでまとめる
+                    this->template forEach<MeshData, MaterialData>(
+                        [&](MeshData& mesh, MaterialData& material)
+                        {
+                            // インスタンス単位で判定する(サブメッシュごとに分けると描画が分かれるため)
+                            if (lmdAnyVisible(mesh))
+                                mMeshInstances.push_back({ mesh.meshes.data(), material.textures.data(), &mesh, &material });
+                        });
+
+                    std::stable_sort(mMeshInstances.begin(), mMeshInstances.end(),
+                                     [](const MeshInstance& a, const MeshInstance& b)
+                                     {
+                                         return std::tie(a.pMeshes, a.pTextures) < std::tie(b.pMeshes, b.pTextures);
+                                     });
+                }
+            }
 
-                    for (std::size_t i = 0; i < SkeletalMeshData::RenderingInfo::MaxBoneNum; ++i)
-                    {
-                        if (i >= mesh.skeleton.get().bones.size())
-                            boneCBParam.boneMat[i] = glm::mat4(1.f);
-                        else
-                            boneCBParam.boneMat[i] = mesh.skeleton.get().bones[i].transform;
-                    }
+            {  // skeletal mesh
+                this->template forEach<SkeletalMeshData, MaterialData>([&](SkeletalMeshData& mesh, MaterialData& material) { lmdCollect(mesh, material, &mesh); });
+            }
 
-                    graphics->writeBuffer(sizeof(SkeletalMeshData::RenderingInfo::SceneCBParam), &skeletalSceneCBParam, mesh.renderingInfo.sceneCB);
-                    graphics->writeBuffer(sizeof(SkeletalMeshData::RenderingInfo::BoneCBParam), &boneCBParam, mesh.renderingInfo.boneCB);
+            // 定数は毎フレーム次の組に書き込む(GPUが参照中かもしれない前フレームの組は書き換えない)
+            // 構成が同じなら確保の結果はframeCountフレーム前と同じになり, その組で記録したコマンドを使い回せる
+            mSceneRing->beginFrame();
+            mBoneRing->beginFrame();
+            mInstanceRing->beginFrame();
 
-                    Cutlass::ShaderResourceSet bufferSet, textureSet;
+            for (auto& job : mDrawJobs)
+            {
+                job.sceneCB = mSceneRing->allocate(sizeof(MeshData::RenderingInfo::SceneCBParam));
+                if (job.pSkeletal)
+                    job.boneCB = mBoneRing->allocate(sizeof(SkeletalMeshData::RenderingInfo::BoneCBParam));
+            }
+
+            if (!mMeshInstances.empty())
+            {  // instanced mesh
+                meshSceneCBParam.world         = glm::mat4(1.f);
+                meshSceneCBParam.lighting      = 1;
+                meshSceneCBParam.receiveShadow = 0;
+                meshSceneCBParam.useBone       = 0;
+
+                auto&& sceneCB = mSceneRing->allocate(sizeof(MeshData::RenderingInfo::SceneCBParam));
+                std::memcpy(sceneCB.pData, &meshSceneCBParam, sizeof(MeshData::RenderingInfo::SceneCBParam));
 
-                    bufferSet.bind(0, mesh.renderingInfo.sceneCB);
-                    bufferSet.bind(1, mesh.renderingInfo.boneCB);
-                    assert(material.textures.size() > 0 || !"material texture is empty!");
+                constexpr std::size_t MaxInstanceNum = MeshData::RenderingInfo::InstanceCBParam::MaxInstanceNum;
+
+                for (std::size_t begin = 0, end = 0; begin < mMeshInstances.size(); begin = end)
+                {
+                    for (end = begin + 1; end < mMeshInstances.size(); ++end)
+                        if (mMeshInstances[end].pMeshes != mMeshInstances[begin].pMeshes || mMeshInstances[end].pTextures != mMeshInstances[begin].pTextures)
+                            break;
 
-                    cl.bind(mGeometryPipeline);
-                    cl.bind(0, bufferSet);
-                    for (std::size_t i = 0; i < mesh.meshes.size(); ++i)
+                    // 1つのInstanceCBに入る数ずつ描画する
+                    for (std::size_t chunk = begin; chunk < end; chunk += MaxInstanceNum)
                     {
-                        auto& m = mesh.meshes[i];
-                        cl.bind(m.VB, m.IB);
-                        textureSet.bind(0, material.textures[i].handle);
-                        cl.bind(1, textureSet);
-                        cl.renderIndexed(m.indices.size());
-                        debug = true;
+                        const std::size_t num = std::min(MaxInstanceNum, end - chunk);
+
+                        // 複数のグループで同じブロックを共有し, 位置はfirstInstanceで指定する
+                        auto&& instanceCB = mInstanceRing->allocate(sizeof(glm::mat4) * num, sizeof(glm::mat4));
+                        auto pWorlds      = static_cast<glm::mat4*>(instanceCB.pData);
+                        for (std::size_t i = 0; i < num; ++i)
+                        {
+                            const auto& mesh = *mMeshInstances[chunk + i].pMesh;
+                            pWorlds[i]       = getRenderWorld(mesh) * mesh.defaultAxis;
+                        }
+                        const auto firstInstance = static_cast<std::uint32_t>(instanceCB.offset / sizeof(glm::mat4));
+
+                        auto& mesh     = *mMeshInstances[chunk].pMesh;
+                        auto& material = *mMeshInstances[chunk].pMaterial;
+                        assert(material.textures.size() > 0 || !"material texture is empty!");
+
+                        // ブロックはチャンク間で共有されるので, set 0の同一性はブロックの先頭で見る
+                        const void* pSet0 = static_cast<std::uint8_t*>(instanceCB.pData) - instanceCB.offset;
+                        for (std::size_t i = 0; i < mesh.meshes.size(); ++i)
+                            lmdPush({ InstancedPipelineKey, sceneCB.buffer, instanceCB.buffer, pSet0, &material.textures[i], &mesh.meshes[i], static_cast<std::uint32_t>(num), firstInstance }, pWorlds[0]);
                     }
-                };
+                }
+            }
 
-                this->template forEach<SkeletalMeshData, MaterialData>(f);
+            {  // 集めたエンティティの定数と描画をワーカーで組み立てる
+                const std::size_t base = mDrawItems.size();
+                mDrawItems.resize(base + mDrawJobItemCount);
+                mDrawKeys.resize(base + mDrawJobItemCount);
+
+                this->common().jobSystem->parallelFor(mDrawJobs.size(), DrawJobGrainSize,
+                                                      [&](const std::size_t begin, const std::size_t end)
+                                                      {
+                                                          for (std::size_t i = begin; i < end; ++i)
+                                                              buildDraws(mDrawJobs[i], base, lmdVisible);
+                                                      });
             }
 
-            cl.end();
-            // for (auto& cmd : cl.getInternalCommandData())
-            // {
-            //     std::cerr << static_cast<int>(cmd.first) << "\n";
-            // }
-            //std::cerr << "A UB : " << cl.getUniformBufferCount() << ", CT : " << cl.getCombinedTextureCount() << "\n";
-            //if (debug)
-                graphics->writeCommand(Graphics::DefaultRenderPass::eGeometry, cl);
+            // 描画コマンドより前に転送されていればよい
+            mSceneRing->flush();
+            mBoneRing->flush();
+            mInstanceRing->flush();
 
-            {  // sprite
+            radixSort(mDrawKeys, mDrawItems, mDrawKeysTmp, mDrawItemsTmp);
 
-                glm::vec3 lu(0), ld(0), ru(0), rd(0);
-                Cutlass::ShaderResourceSet bufferSet, textureSet;
-                bufferSet.bind(0, mSpriteCB);
+            // 視錐台の外だったサブメッシュは末尾に集まっている
+            while (!mDrawKeys.empty() && mDrawKeys.back() == CulledDrawKey)
+            {
+                mDrawKeys.pop_back();
+                mDrawItems.pop_back();
+            }
+
+            // 並べた後の描画列がこの組で前回記録したものと同じならコマンドを記録し直さない(定数の中身は書き込み済み)
+            // 描画列は定数の位置(pSet0)を含み組ごとに異なるので, 同じ組で前回記録したものと比べる
+            const std::size_t ringFrame      = mSceneRing->getFrameIndex();
+            std::uint64_t geometryStreamHash = resourceHash;
+            for (const auto& item : mDrawItems)
+            {
+                geometryStreamHash = hashCombine(geometryStreamHash, static_cast<std::uint64_t>(item.pipeline));
+                geometryStreamHash = hashCombine(geometryStreamHash, item.pSet0);
+                geometryStreamHash = hashCombine(geometryStreamHash, item.pTexture);
+                geometryStreamHash = hashCombine(geometryStreamHash, item.pMesh);
+                geometryStreamHash = hashCombine(geometryStreamHash, static_cast<std::uint64_t>(item.instanceCount) << 32 | item.firstInstance);
+            }
 
-                cl.clear();
-                cl.begin(mSpritePass, {1.f, 0}, {0.2f, 0.2f, 0.2f, 0});
+            // 組ごとにGraphicsに別のコマンドとして持たせ, 組の描画列が変わったときだけ転送する
+            if (geometryStreamHash != mGeometryStreamHashes[ringFrame])
+            {
+                mGeometryStreamHashes[ringFrame] = geometryStreamHash;
+
+                Cutlass::CommandList geometryCL;
+                //geometryCL.begin(mGeometryPass, {1.f, 0}, {0.2f, 0.2f, 0.2f, 0});
+                geometryCL.begin(mGeometryPass);
                 {
-                    std::function<void(SpriteData&, TransformData&)> f =
-                        [&](SpriteData& sprite, TransformData& transform)
-                    {
-                        {  // 頂点更新
-                            lu = ld = ru = rd = glm::vec3(0);
-                            const auto& scale = transform.scale;
-                            const auto& rot   = transform.rot;
-                            const auto& pos   = transform.pos;
-                            glm::uvec2 size;
-                            std::uint32_t depth;
-                            graphics->getTextureSize(sprite.textures[sprite.index], size.x, size.y, depth);
-                            assert(depth == 1);
-
-                            if (sprite.centerFlag)
-                            {
-                                rd.x = ru.x = 1.f * scale.x * size.x / 2.f;
-                                ld.y = rd.y = 1.f * scale.y * size.y / 2.f;
-                                lu.x = ld.x = -1.f * scale.x * size.x / 2.f;
-                                lu.y = ru.y = -1.f * scale.y * size.y / 2.f;
-                                lu          = rot * lu;
-                            }
-                            else
-                            {
-                                rd.x = ru.x = size.x * scale.x;
-                                rd.y = ld.y = size.y * scale.y;
-                            }
+                    const Cutlass::HGraphicsPipeline pipelines[] = { mGeometryPipeline, mInstancedGeometryPipeline };
 
-                            ld = rot * ld;
-                            ru = rot * ru;
-                            rd = rot * rd;
-                            lu += pos;
-                            ld += pos;
-                            ru += pos;
-                            rd += pos;
-                            lu.z = std::min(std::max(0.f, pos.z), 1.f);
-                            ld.z = std::min(std::max(0.f, pos.z), 1.f);
-                            ru.z = std::min(std::max(0.f, pos.z), 1.f);
-                            rd.z = std::min(std::max(0.f, pos.z), 1.f);
-
-                            // std::cerr << "sprite pos : " << glm::to_string(lu) << "\n";
-                            // std::cerr << "sprite pos : " << glm::to_string(ld) << "\n";
-                            // std::cerr << "sprite pos : " << glm::to_string(ru) << "\n";
-                            // std::cerr << "sprite pos : " << glm::to_string(rd) << "\n";
-
-                            //ここでスプライトの頂点位置を更新する
-                            std::array<SpriteData::RenderingInfo::Vertex, 4> vertices =
-                                {{
-                                    {lu, glm::vec2(0, 0)},
-                                    {ru, glm::vec2(1.f, 0)},
-                                    {ld, glm::vec2(0, 1.f)},
-                                    {rd, glm::vec2(1.f, 1.f)},
-                                }};
-
-                            //頂点バッファ構築
-                            graphics->writeBuffer(4 * sizeof(SpriteData::RenderingInfo::Vertex), vertices.data(), sprite.renderingInfo.spriteVB);
+                    // 直前と同じ状態ならbindしない
+                    std::uint32_t boundPipeline            = ~0u;
+                    const void* pBoundSet0                 = nullptr;
+                    const MaterialData::Texture* pBoundTex = nullptr;
+                    const MeshData::Mesh* pBoundMesh       = nullptr;
+
+                    for (const auto& item : mDrawItems)
+                    {
+                        if (item.pipeline != boundPipeline)
+                        {
+                            geometryCL.bind(pipelines[item.pipeline]);
+                            boundPipeline = item.pipeline;
+                            // パイプラインを替えたらリソースは張り直す
+                            pBoundSet0 = nullptr;
+                            pBoundTex  = nullptr;
                         }
 
-                        textureSet.bind(0, sprite.textures[sprite.index]);
-                        sprite.index = (1 + sprite.index) % sprite.textures.size();
+                        if (item.pSet0 != pBoundSet0)
+                        {
+                            Cutlass::ShaderResourceSet bufferSet;
+                            bufferSet.bind(0, item.cb0);
+                            bufferSet.bind(1, item.cb1);
+                            geometryCL.bind(0, bufferSet);
+                            pBoundSet0 = item.pSet0;
+                        }
 
-                        cl.bind(mSpritePipeline);
-                        cl.bind(sprite.renderingInfo.spriteVB, mSpriteIB);
-                        cl.bind(0, bufferSet);
-                        cl.bind(1, textureSet);
+                        if (item.pTexture != pBoundTex)
+                        {
+                            Cutlass::ShaderResourceSet textureSet;
+                            textureSet.bind(0, item.pTexture->handle);
+                            geometryCL.bind(1, textureSet);
+                            pBoundTex = item.pTexture;
+                        }
 
-                        cl.renderIndexed(6);
-                    };
+                        if (item.pMesh != pBoundMesh)
+                        {
+                            geometryCL.bind(item.pMesh->VB, item.pMesh->IB);
+                            pBoundMesh = item.pMesh;
+                        }
 
-                    this->template forEach<mall::SpriteData, mall::TransformData>(f);
+                        geometryCL.renderIndexed(item.pMesh->indices.size(), item.instanceCount, 0, 0, item.firstInstance);
+                        debug = true;
+                    }
                 }
+                geometryCL.end();
+                // for (auto& cmd : geometryCL.getInternalCommandData())
+                // {
+                //     std::cerr << static_cast<int>(cmd.first) << "\n";
+                // }
+                //std::cerr << "A UB : " << geometryCL.getUniformBufferCount() << ", CT : " << geometryCL.getCombinedTextureCount() << "\n";
+                graphics->writeFrameCommand(Graphics::DefaultRenderPass::eGeometry, geometryCL, static_cast<std::uint32_t>(ringFrame));
+            }
+            else
+                graphics->useFrameCommand(Graphics::DefaultRenderPass::eGeometry, static_cast<std::uint32_t>(ringFrame));
+
+            {  // sprite
+                // TextSystemがワーカーで詰めたグリフのページを転送する(Graphicsはメインスレッドでのみ触る)
+                this->common().glyphAtlas->flush();
 
+                // 矩形の4隅(左上, 右上, 左下, 右下)をスクリーン空間で求める
+                auto&& lmdQuad = [](const TransformData& transform, const glm::uvec2& size, const glm::vec4& uvRect, const bool centerFlag, SpriteBatcher::Vertex (&vertices)[4])
                 {
-                    std::function<void(TextData&, TransformData&)> f =
-                        [&](TextData& text, TransformData& transform)
+                    glm::vec3 lu(0), ld(0), ru(0), rd(0);
+                    const auto scale = transform.getScale();
+                    const auto rot   = transform.getRot();
+                    const auto pos   = transform.getPos();
+
+                    if (centerFlag)
                     {
-                        {  // 頂点更新
-                            lu = ld = ru = rd = glm::vec3(0);
-                            const auto& scale = transform.scale;
-                            const auto& rot   = transform.rot;
-                            const auto& pos   = transform.pos;
-                            glm::uvec2 size;
-                            std::uint32_t depth;
-                            graphics->getTextureSize(text.texture, size.x, size.y, depth);
-                            assert(depth == 1);
-
-                            if (text.centerFlag)
-                            {
-                                rd.x = ru.x = 1.f * scale.x * size.x / 2.f;
-                                ld.y = rd.y = 1.f * scale.y * size.y / 2.f;
-                                lu.x = ld.x = -1.f * scale.x * size.x / 2.f;
-                                lu.y = ru.y = -1.f * scale.y * size.y / 2.f;
-                                lu          = rot * lu;
-                            }
+                        rd.x = ru.x = 1.f * scale.x * size.x / 2.f;
+                        ld.y = rd.y = 1.f * scale.y * size.y / 2.f;
+                        lu.x = ld.x = -1.f * scale.x * size.x / 2.f;
+                        lu.y = ru.y = -1.f * scale.y * size.y / 2.f;
+                        lu          = rot * lu;
+                    }
+                    else
+                    {
+                        rd.x = ru.x = size.x * scale.x;
+                        rd.y = ld.y = size.y * scale.y;
+                    }
+
+                    ld = rot * ld;
+                    ru = rot * ru;
+                    rd = rot * rd;
+                    lu += pos;
+                    ld += pos;
+                    ru += pos;
+                    rd += pos;
+                    lu.z = ld.z = ru.z = rd.z = std::min(std::max(0.f, pos.z), 1.f);
+
+                    // スプライトはテクスチャの色のまま描く
+                    vertices[0] = { lu, glm::vec2(uvRect.x, uvRect.y), glm::vec4(1.f) };
+                    vertices[1] = { ru, glm::vec2(uvRect.z, uvRect.y), glm::vec4(1.f) };
+                    vertices[2] = { ld, glm::vec2(uvRect.x, uvRect.w), glm::vec4(1.f) };
+                    vertices[3] = { rd, glm::vec2(uvRect.z, uvRect.w), glm::vec4(1.f) };
+                };
+
+                // 全ての矩形を1つの頂点バッファに詰め, 同じテクスチャが続く範囲をまとめて描画する
+                mSpriteBatcher->clear();
+
+                this->template forEach<SpriteData, TransformData>(
+                    [&](SpriteData& sprite, TransformData& transform)
+                    {
+                        SpriteBatcher::Vertex vertices[4];
+                        lmdQuad(transform, sprite.sizes[sprite.index], sprite.uvRects[sprite.index], sprite.centerFlag, vertices);
+
+                        {  // スクリーン空間の範囲を範囲検索用にBVHへ反映する
+                            const SceneBVH::AABB bounds{ glm::min(glm::min(vertices[0].pos, vertices[1].pos), glm::min(vertices[2].pos, vertices[3].pos)),
+                                                         glm::max(glm::max(vertices[0].pos, vertices[1].pos), glm::max(vertices[2].pos, vertices[3].pos)) };
+                            if (sprite.bvhProxy == SceneBVH::InvalidID)
+                                sprite.bvhProxy = spriteBVH->createProxy(bounds, SceneBVH::LayerSprite, sprite.bvhUserData, this);
                             else
                             {
-                                rd.x = ru.x = size.x * scale.x;
-                                rd.y = ld.y = size.y * scale.y;
+                                spriteBVH->updateProxy(sprite.bvhProxy, bounds);
+                                spriteBVH->setUserData(sprite.bvhProxy, sprite.bvhUserData);
                             }
+                        }
 
-                            ld = rot * ld;
-                            ru = rot * ru;
-                            rd = rot * rd;
-                            lu += pos;
-                            ld += pos;
-                            ru += pos;
-                            rd += pos;
-                            lu.z = std::min(std::max(0.f, pos.z), 1.f);
-                            ld.z = std::min(std::max(0.f, pos.z), 1.f);
-                            ru.z = std::min(std::max(0.f, pos.z), 1.f);
-                            rd.z = std::min(std::max(0.f, pos.z), 1.f);
-
-                            // std::cerr << "sprite pos : " << glm::to_string(lu) << "\n";
-                            // std::cerr << "sprite pos : " << glm::to_string(ld) << "\n";
-                            // std::cerr << "sprite pos : " << glm::to_string(ru) << "\n";
-                            // std::cerr << "sprite pos : " << glm::to_string(rd) << "\n";
-
-                            std::array<TextData::RenderingInfo::Vertex, 4> vertices =
-                                {{
-                                    {lu, glm::vec2(0, 0)},
-                                    {ru, glm::vec2(1.f, 0)},
-                                    {ld, glm::vec2(0, 1.f)},
-                                    {rd, glm::vec2(1.f, 1.f)},
-                                }};
-
-                            //頂点バッファ構築
-                            graphics->writeBuffer(4 * sizeof(TextData::RenderingInfo::Vertex), vertices.data(), text.renderingInfo.spriteVB);
+                        mSpriteBatcher->push(sprite.textures[sprite.index], sprite.textureKeys[sprite.index], vertices);
+                        sprite.index = (1 + sprite.index) % sprite.textures.size();
+                    });
+
+                // 次のフレームで他のSystemから問い合わせる際にスプライトの移動も反映されているようにする
+                spriteBVH->sweep(SceneBVH::LayerSprite, this);
+                spriteBVH->update();
+
+                this->template forEach<TextData, TransformData>(
+                    [&](TextData& text, TransformData& transform)
+                    {
+                        const auto& quads = text.storage.get().quads;
+                        if (quads.empty())
+                            return;
+
+                        // width * heightの枠の4隅を求め, TextSystemが並べた文字の矩形をその中に写す
+                        SpriteBatcher::Vertex box[4];
+                        lmdQuad(transform, glm::uvec2(text.width, text.height), glm::vec4(0.f, 0.f, 1.f, 1.f), text.centerFlag, box);
+
+                        const glm::vec3 axisX = (box[1].pos - box[0].pos) / std::max(1.f, static_cast<float>(text.width));
+                        const glm::vec3 axisY = (box[2].pos - box[0].pos) / std::max(1.f, static_cast<float>(text.height));
+
+                        for (const auto& quad : quads)
+                        {
+                            const glm::vec3 lu = box[0].pos + axisX * quad.min.x + axisY * quad.min.y;
+                            const glm::vec3 dx = axisX * (quad.max.x - quad.min.x);
+                            const glm::vec3 dy = axisY * (quad.max.y - quad.min.y);
+
+                            // アトラスのグリフは白なので, 文字の色は頂点色で付ける
+                            const SpriteBatcher::Vertex vertices[4] = {
+                                { lu, glm::vec2(quad.uvRect.x, quad.uvRect.y), text.color },
+                                { lu + dx, glm::vec2(quad.uvRect.z, quad.uvRect.y), text.color },
+                                { lu + dy, glm::vec2(quad.uvRect.x, quad.uvRect.w), text.color },
+                                { lu + dx + dy, glm::vec2(quad.uvRect.z, quad.uvRect.w), text.color },
+                            };
+
+                            // 同じページの文字は1回の描画にまとまる
+                            mSpriteBatcher->push(*quad.pTexture, quad.pTexture, vertices, quad.sdf ? SDFTextPipelineKey : SpritePipelineKey);
                         }
+                    });
 
-                        textureSet.bind(0, text.texture);
+                // 頂点は毎フレーム次の頂点バッファに書き込む(GPUが参照中かもしれない前フレームのものは書き換えない)
+                mSpriteBatcher->upload();
+                const std::size_t spriteFrame = mSpriteBatcher->getFrameIndex();
 
-                        cl.bind(mSpritePipeline);
-                        cl.bind(text.renderingInfo.spriteVB, mSpriteIB);
-                        cl.bind(0, bufferSet);
-                        cl.bind(1, textureSet);
+                // 頂点バッファごとにGraphicsに別のコマンドとして持たせ, 描画の並びがそのバッファで前回記録したものと変わったときだけ転送する
+                // 転送でバッファを作り直した場合も記録し直す
+                const std::uint64_t batchHash        = mSpriteBatcher->hashBatches(HashSeed);
+                const std::uint64_t spriteStreamHash = hashCombine(hashCombine(batchHash, graphics->getResourceGeneration()), this->common().resourceBank->getGeneration());
 
-                        cl.renderIndexed(6);
-                    };
+                if (spriteStreamHash != mSpriteStreamHashes[spriteFrame])
+                {
+                    Cutlass::ShaderResourceSet bufferSet;
+                    bufferSet.bind(0, mSpriteCB);
 
-                    this->template forEach<TextData, TransformData>(f);
-                }
+                    const Cutlass::HGraphicsPipeline pipelines[] = { mSpritePipeline, mSDFTextPipeline };
 
-                cl.end();
-                graphics->writeCommand(Graphics::DefaultRenderPass::eSprite, cl);
+                    Cutlass::CommandList spriteCL;
+                    spriteCL.begin(mSpritePass, {1.f, 0}, {0.2f, 0.2f, 0.2f, 0});
+                    mSpriteBatcher->record(spriteCL, pipelines, bufferSet);
+                    spriteCL.end();
+
+                    graphics->writeFrameCommand(Graphics::DefaultRenderPass::eSprite, spriteCL, static_cast<std::uint32_t>(spriteFrame));
+                    mSpriteStreamHashes[spriteFrame] = spriteStreamHash;
+                }
+                else
+                    graphics->useFrameCommand(Graphics::DefaultRenderPass::eSprite, static_cast<std::uint32_t>(spriteFrame));
             }
         }
 
-        virtual void onEnd()
+        constexpr static const char* InstancedVertexShaderPath   = "resources/shaders/deferred/GBufferInstanced_vert.spv";
+        constexpr static const char* InstancedFragmentShaderPath = "resources/shaders/deferred/GBufferInstanced_frag.spv";
+        constexpr static const char* SDFTextFragmentShaderPath   = "resources/shaders/sprite/SpriteSDF_frag.spv";
+
+        // SpriteBatcherに渡すパイプラインの添字
+        constexpr static std::uint32_t SpritePipelineKey  = 0;
+        constexpr static std::uint32_t SDFTextPipelineKey = 1;
+
+        // 描画順のキー, 上位から パス(2bit) | パイプライン(4bit) | テクスチャ(16bit) | メッシュ(16bit) | カメラからの距離(26bit)
+        constexpr static std::uint64_t GeometryPassKey      = 0;
+        constexpr static std::uint32_t DefaultPipelineKey   = 0;
+        constexpr static std::uint32_t InstancedPipelineKey = 1;
+        constexpr static std::uint64_t DepthKeyMask         = (1ull << 26) - 1;
+        // 距離は1/16単位で量子化する
+        constexpr static float DepthKeyScale = 16.f;
+
+        // テクスチャ, メッシュはアドレスを16bitに縮めて使う
+        // 衝突しても並びが粗くなるだけで, bindを省くかどうかは実際の値で判定する
+        static std::uint64_t makeDrawKey(const std::uint64_t pass, const std::uint64_t pipeline, const void* pTexture, const void* pMesh, const glm::vec3& pos, const glm::vec3& cameraPos)
         {
-            std::unique_ptr<Graphics>& graphics = this->common().graphics;
-            graphics->destroyBuffer(mLightCB);
-            graphics->destroyBuffer(mShadowCB);
-            graphics->destroyBuffer(mCameraCB);
-            graphics->destroyBuffer(mDummyBoneCB);
-            graphics->destroyBuffer(mSpriteIB);
+            const auto lmdHash16 = [](const void* p)
+            {
+                auto v = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(p));
+                v ^= v >> 33;
+                v *= 0xff51afd7ed558ccdull;
+                v ^= v >> 33;
+                return v & 0xFFFF;
+            };
+
+            // 同じ状態の中では手前から描く(早期深度テストで後ろを捨てられるように)
+            const glm::vec3 d    = pos - cameraPos;
+            const float distance = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+            const auto depth     = static_cast<std::uint64_t>(std::min(static_cast<float>(DepthKeyMask), distance * DepthKeyScale));
+
+            return (pass & 0x3) << 62 | (pipeline & 0xF) << 58 | lmdHash16(pTexture) << 42 | lmdHash16(pMesh) << 26 | depth;
+        }
 
-            // this->template forEach<MeshData>(
-            //     [&](MeshData& mesh)
-            //     {
-            //         graphics->destroyBuffer(mesh.renderingInfo.sceneCB);
-            //     });
+        // 描画に使うワールド行列, 補間が無効かprevWorldがまだ無ければworldそのもの
+        glm::mat4 getRenderWorld(const MeshData& mesh) const
+        {
+            if (!mInterpolate || mesh.prevWorldSteps < 2)
+                return mesh.world;
 
-            // this->template forEach<SkeletalMeshData>(
-            //     [&](SkeletalMeshData& skeletalMesh)
-            //     {
-            //         graphics->destroyBuffer(skeletalMesh.renderingInfo.sceneCB);
-            //         graphics->destroyBuffer(skeletalMesh.renderingInfo.boneCB);
-            //     });
+            return interpolateTRS(mesh.prevWorld, mesh.world, mInterpolationAlpha);
+        }
 
-            // this->template forEach<SpriteData>(
-            //     [&](SpriteData& sprite)
-            //     {
-            //         graphics->destroyBuffer(sprite.renderingInfo.spriteVB);
-            //     });
+        // 並べ替えてから発行する描画1回分
+        struct DrawItem
+        {
+            std::uint32_t pipeline;
+            // set 0
+            Cutlass::HBuffer cb0;
+            Cutlass::HBuffer cb1;
+            // set 0の同一性の判定用(定数の割り当てごとに異なる)
+            const void* pSet0;
+            // set 1
+            const MaterialData::Texture* pTexture;
+            const MeshData::Mesh* pMesh;
+            std::uint32_t instanceCount;
+            std::uint32_t firstInstance;
+        };
 
-            // this->template forEach<TextData>(
-            //     [&](TextData& text)
-            //     {
-            //         graphics->destroyBuffer(text.renderingInfo.spriteVB);
-            //     });
+        // サブメッシュが視錐台の外だった描画のキー(並べると末尾に来る)
+        constexpr static std::uint64_t CulledDrawKey = ~std::uint64_t(0);
+        // 1ジョブあたりのエンティティ数
+        constexpr static std::size_t DrawJobGrainSize = 256;
+
+        // 描画を組み立てるエンティティ1つ分, 定数の確保と書き込み先の割り当てはメインスレッドで済ませておく
+        struct DrawJob
+        {
+            MeshData* pMesh;
+            MaterialData* pMaterial;
+            // スケルタルメッシュでなければnullptr
+            SkeletalMeshData* pSkeletal;
+            UniformRing::Allocation sceneCB;
+            UniformRing::Allocation boneCB;
+            // mDrawItems上の位置(ワーカー実行前に詰めた描画の後ろからの相対位置)
+            std::size_t firstItem;
+        };
+
+        // jobのサブメッシュをmDrawItems[base + job.firstItem, ...)に書き込む, 他のjobとは書き込み先が重ならない
+        template <typename VisibleFunc>
+        void buildDraws(const DrawJob& job, const std::size_t base, VisibleFunc&& lmdVisible)
+        {
+            const MeshData& mesh = *job.pMesh;
+
+            // view, projはカメラの処理で書き込み済み
+            MeshData::RenderingInfo::SceneCBParam param;
+            param.world         = getRenderWorld(mesh) * mesh.defaultAxis;
+            param.view          = mSceneView;
+            param.proj          = mSceneProj;
+            param.lighting      = 1;
+            param.receiveShadow = 0;
+            param.useBone       = job.pSkeletal ? 1 : 0;
+            std::memcpy(job.sceneCB.pData, &param, sizeof(MeshData::RenderingInfo::SceneCBParam));
+
+            if (job.pSkeletal)
+            {
+                const auto& bones = job.pSkeletal->skeleton.get().bones;
+                auto pBoneCB      = static_cast<SkeletalMeshData::RenderingInfo::BoneCBParam*>(job.boneCB.pData);
+                for (std::size_t i = 0; i < SkeletalMeshData::RenderingInfo::MaxBoneNum; ++i)
+                    pBoneCB->boneMat[i] = i < bones.size() ? bones[i].transform : glm::mat4(1.f);
+            }
+
+            for (std::size_t i = 0; i < mesh.meshes.size(); ++i)
+            {
+                const std::size_t slot = base + job.firstItem + i;
+                const auto& m          = mesh.meshes[i];
+
+                // スケルタルメッシュの境界はバインドポーズのものなので, サブメッシュごとには落とさない
+                if (!job.pSkeletal && !lmdVisible(param.world, m))
+                {
+                    mDrawKeys[slot] = CulledDrawKey;
+                    continue;
+                }
 
+                mDrawItems[slot] = { DefaultPipelineKey, job.sceneCB.buffer, job.pSkeletal ? job.boneCB.buffer : mDummyBoneCB, job.sceneCB.pData, &job.pMaterial->textures[i], &m, 1, 0 };
+                mDrawKeys[slot]  = makeDrawKey(GeometryPassKey, DefaultPipelineKey, &job.pMaterial->textures[i], &m, glm::vec3(param.world[3]), mCameraPos);
+            }
         }
 
-    protected:
+        struct MeshInstance
+        {
+            const MeshData::Mesh* pMeshes;
+            const MaterialData::Texture* pTextures;
+            MeshData* pMesh;
+            MaterialData* pMaterial;
+        };
+
         Cutlass::HRenderPass mGeometryPass;
         Cutlass::HRenderPass mLightingPass;
         Cutlass::HRenderPass mSpritePass;
@@ -561,8 +991,50 @@ namespace mall
         Cutlass::HBuffer mShadowCB;
         Cutlass::HBuffer mDummyBoneCB;
         Cutlass::HBuffer mCameraCB;
-        Cutlass::HBuffer mSpriteIB;
         Cutlass::HBuffer mSpriteCB;
+
+        bool mInstancing;
+        Cutlass::HGraphicsPipeline mInstancedGeometryPipeline;
+
+        bool mSDFText;
+        Cutlass::HGraphicsPipeline mSDFTextPipeline;
+        std::vector<MeshInstance> mMeshInstances;
+
+        std::vector<DrawJob> mDrawJobs;
+        std::size_t mDrawJobItemCount;
+        // ワーカーから参照するカメラの状態
+        glm::mat4 mSceneView;
+        glm::mat4 mSceneProj;
+        glm::vec3 mCameraPos;
+
+        std::vector<DrawItem> mDrawItems;
+        std::vector<std::uint64_t> mDrawKeys;
+        std::vector<DrawItem> mDrawItemsTmp;
+        std::vector<std::uint64_t> mDrawKeysTmp;
+
+        Frustum mFrustum;
+        bool mCulling;
+
+        // このフレームの描画補間(Engine::interpolationAlpha)
+        bool mInterpolate;
+        float mInterpolationAlpha;
+
+        // Engine::sceneBVHで視錐台と交差したプロキシ, mProxyVisibleはプロキシIDで引く
+        std::vector<SceneBVH::ProxyID> mVisibleProxies;
+        std::vector<std::uint8_t> mProxyVisible;
+
+        // 描画ごとの定数, エンティティごとにバッファを持たずフレームごとに切り出す
+        std::unique_ptr<UniformRing> mSceneRing;
+        std::unique_ptr<UniformRing> mBoneRing;
+        std::unique_ptr<UniformRing> mInstanceRing;
+
+        // UniformRingの組ごとにGraphicsに書き込んだ描画列のハッシュ(一致すれば書き込み済みのコマンドを使い回す)
+        std::vector<std::uint64_t> mGeometryStreamHashes;
+
+        // スプライトとテキストの矩形をまとめて描画する
+        std::unique_ptr<SpriteBatcher> mSpriteBatcher;
+        // SpriteBatcherの頂点バッファごとにGraphicsに書き込んだ描画の並びのハッシュ
+        std::vector<std::uint64_t> mSpriteStreamHashes;
     };
 }  // namespace mall
 
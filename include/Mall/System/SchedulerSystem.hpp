@@ -0,0 +1,36 @@
+#ifndef MALL_SYSTEM_SCHEDULERSYSTEM_HPP_
+#define MALL_SYSTEM_SCHEDULERSYSTEM_HPP_
+
+#include <MVECS/ISystem.hpp>
+
+#include "../Engine.hpp"
+
+namespace mall
+{
+    // これより前の実行順のシステムがSystemSchedulerに登録したタスクをまとめて並列実行する
+    template <typename Key, typename Common, typename = std::is_base_of<Engine, Common>>
+    class SchedulerSystem : public mvecs::ISystem<Key, Common>
+    {
+        SYSTEM(SchedulerSystem, Key, Common)
+
+    public:
+        virtual void onInit()
+        {
+
+        }
+
+        virtual void onUpdate()
+        {
+            MALL_PROFILE_SCOPE(this->common().profiler, "SchedulerSystem::onUpdate");
+
+            this->common().scheduler->dispatch(*this->common().jobSystem);
+        }
+
+        virtual void onEnd()
+        {
+
+        }
+    };
+}  // namespace mall
+
+#endif
@@ -2,10 +2,14 @@
 #define MALL_SYSTEM_TRANSFORMSYSTEM_HPP_
 
 #include <MVECS/ISystem.hpp>
+#include <algorithm>
 #include <chrono>
 
+#include "../ComponentData/HierarchyData.hpp"
 #include "../ComponentData/TransformData.hpp"
 #include "../Engine.hpp"
+#include "../Utility/ParallelForEach.hpp"
+#include "../Utility/TransformMath.hpp"
 
 namespace mall
 {
@@ -21,33 +25,136 @@ namespace mall
 
         virtual void onUpdate()
         {
-            {
-                const float& deltaTime = this->common().deltaTime;
+            MALL_PROFILE_SCOPE(this->common().profiler, "TransformSystem::onUpdate");
+
+            auto& jobSystem = *this->common().jobSystem;
 
-                auto&& lmdUpdateTransform = [&](TransformData& transform)
+            if (this->common().fixedTimeStep.enable)
+            {  // このステップで書き換える前のワールド行列を描画の補間用に残す(作られて最初のステップのworldはまだ無効)
+                auto&& lmdRecord = [](MeshData& mesh)
                 {
-                    transform.pos += deltaTime* transform.vel += deltaTime * transform.acc;
+                    if (mesh.prevWorldSteps > 0)
+                        mesh.prevWorld = mesh.world;
+                    mesh.prevWorldSteps = static_cast<std::uint8_t>(std::min(mesh.prevWorldSteps + 1, 2));
                 };
 
-                this->template forEach<TransformData>(lmdUpdateTransform);
+                this->template forEach<MeshData>(mRecordMeshPrevWorld.collect());
+                mRecordMeshPrevWorld.run(jobSystem, lmdRecord, WorldMatrixGrainSize);
+
+                this->template forEach<SkeletalMeshData>(mRecordSkeletalMeshPrevWorld.collect());
+                mRecordSkeletalMeshPrevWorld.run(jobSystem, lmdRecord, WorldMatrixGrainSize);
             }
 
             {
-                std::function<void(TransformData&, MeshData&)>&& lmdUpdateWorldMatrix = [&](TransformData& transform, MeshData& mesh)
+                const float deltaTime = this->common().deltaTime;
+
+                auto& store = *this->common().transformStore;
+
+                this->template forEach<TransformData>(mIntegrate.collect());
+                mIntegrate.run(jobSystem,
+                               [this, deltaTime](TransformData& transform)
+                               {
+                                   // ストアに置いたものは所有者が残っていることを伝え(このワールドのものとして), メンバを書き換えた分をストアに書き込む
+                                   if (transform.isStored())
+                                   {
+                                       transform.getStore()->mark(transform.getStoreID(), this);
+                                       transform.pushToStore();
+                                   }
+                                   else
+                                       transform.integrate(deltaTime);
+
+                                   transform.updateDirty();
+                               });
+
+                // TransformStoreに置かれたものはSIMDでまとめて積分し, ワールド行列も連続した配列に合成しておく
+                jobSystem.parallelFor(store.size(), StoreGrainSize,
+                                      [&store, deltaTime](const std::size_t begin, const std::size_t end)
+                                      {
+                                          store.integrate(deltaTime, begin, end);
+                                          store.composeWorld(begin, end);
+                                      });
+
+                // このワールドで見つからなかったもの(エンティティごと破棄されたもの)の領域を解放する
+                // ストアは全てのワールドで共有するので, 他のワールドのものには触れない
+                store.sweep(this);
+
+                // 積分した値をメンバに読み戻す(メンバを直接読み書きするSystemのため)
+                if (store.size() > 0)
                 {
-                    mesh.world = glm::translate(glm::mat4(1.f), transform.pos) * glm::toMat4(transform.rot) * glm::scale(transform.scale);
-                };
+                    this->template forEach<TransformData>(mPullFromStore.collect());
+                    mPullFromStore.run(jobSystem,
+                                       [](TransformData& transform)
+                                       {
+                                           transform.pullFromStore();
+                                       });
+                }
+            }
 
-                this->template forEach<TransformData, MeshData>(lmdUpdateWorldMatrix);
+            // 値が変わっていないもの(静的なジオメトリの大半)は前回の行列をそのまま使う
+            auto&& lmdWorld = [](const TransformData& transform)
+            {
+                return transform.getWorld();
+            };
+
+            {
+                this->template forEach<TransformData, MeshData>(mUpdateMeshWorld.collect());
+                mUpdateMeshWorld.run(
+                    jobSystem,
+                    [&lmdWorld](TransformData& transform, MeshData& mesh)
+                    {
+                        if (transform.isDirty())
+                            mesh.world = lmdWorld(transform);
+                    },
+                    WorldMatrixGrainSize);
+            }
+
+            {
+                this->template forEach<TransformData, SkeletalMeshData>(mUpdateSkeletalMeshWorld.collect());
+                mUpdateSkeletalMeshWorld.run(
+                    jobSystem,
+                    [&lmdWorld](TransformData& transform, SkeletalMeshData& mesh)
+                    {
+                        if (transform.isDirty())
+                            mesh.world = lmdWorld(transform);
+                    },
+                    WorldMatrixGrainSize);
             }
 
+            // 親子関係を持つものはTransformDataをローカルな値として伝播し, 上で書き込んだworldを上書きする
             {
-                std::function<void(TransformData&, SkeletalMeshData&)>&& lmdUpdateWorldMatrix = [&](TransformData& transform, SkeletalMeshData& mesh)
+                auto& hierarchy = *this->common().transformHierarchy;
+
+                this->template forEach<TransformData, HierarchyData>(
+                    [&hierarchy, &lmdWorld](TransformData& transform, HierarchyData& node)
+                    {
+                        if (transform.isDirty())
+                            hierarchy.setLocal(node.node, lmdWorld(transform));
+                    });
+
                 {
-                    mesh.world = glm::translate(glm::mat4(1.f), transform.pos) * glm::toMat4(transform.rot) * glm::scale(transform.scale);
-                };
+                    MALL_PROFILE_SCOPE(this->common().profiler, "TransformHierarchy::propagate");
+                    hierarchy.propagate();
+                }
+
+                this->template forEach<HierarchyData, MeshData>(mUpdateHierarchyMeshWorld.collect());
+                mUpdateHierarchyMeshWorld.run(
+                    jobSystem,
+                    [&hierarchy](HierarchyData& node, MeshData& mesh)
+                    {
+                        if (hierarchy.isChanged(node.node))
+                            mesh.world = hierarchy.getWorld(node.node);
+                    },
+                    WorldMatrixGrainSize);
 
-                this->template forEach<TransformData, SkeletalMeshData>(lmdUpdateWorldMatrix);
+                this->template forEach<HierarchyData, SkeletalMeshData>(mUpdateHierarchySkeletalMeshWorld.collect());
+                mUpdateHierarchySkeletalMeshWorld.run(
+                    jobSystem,
+                    [&hierarchy](HierarchyData& node, SkeletalMeshData& mesh)
+                    {
+                        if (hierarchy.isChanged(node.node))
+                            mesh.world = hierarchy.getWorld(node.node);
+                    },
+                    WorldMatrixGrainSize);
             }
         }
 
@@ -55,6 +162,21 @@ namespace mall
         {
 
         }
+
+    protected:
+        // 行列の合成は積分より重いので細かく分ける
+        constexpr static std::size_t WorldMatrixGrainSize = 256;
+        // AVXの幅(8要素)の倍数にして端数をスカラで処理する範囲を減らす
+        constexpr static std::size_t StoreGrainSize = 4096;
+
+        ParallelForEach<MeshData> mRecordMeshPrevWorld;
+        ParallelForEach<SkeletalMeshData> mRecordSkeletalMeshPrevWorld;
+        ParallelForEach<TransformData> mIntegrate;
+        ParallelForEach<TransformData> mPullFromStore;
+        ParallelForEach<TransformData, MeshData> mUpdateMeshWorld;
+        ParallelForEach<TransformData, SkeletalMeshData> mUpdateSkeletalMeshWorld;
+        ParallelForEach<HierarchyData, MeshData> mUpdateHierarchyMeshWorld;
+        ParallelForEach<HierarchyData, SkeletalMeshData> mUpdateHierarchySkeletalMeshWorld;
     };
 }  // namespace mall
 
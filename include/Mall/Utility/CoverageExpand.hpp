@@ -0,0 +1,90 @@
+#ifndef MALL_UTILITY_COVERAGEEXPAND_HPP_
+#define MALL_UTILITY_COVERAGEEXPAND_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace mall
+{
+    /**
+     * @brief 8bitの被覆率(stbttのビットマップ)をRGBA8に展開する(スカラー版)
+     * @detail rgbはcolorのまま, アルファは被覆率 * colorのアルファ / 255(四捨五入)にする
+     *         colorはr | g << 8 | b << 16 | a << 24(GlyphAtlas::packColor), リトルエンディアンでRGBAの並びになる
+     */
+    inline void expandCoverageScalar(const std::uint8_t* pCoverage, const std::size_t count, const std::uint32_t color, std::uint8_t* pOut)
+    {
+        const std::uint32_t rgb   = color & 0x00ffffffu;
+        const std::uint32_t alpha = color >> 24;
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            // x / 255 = (x + (x >> 8)) >> 8 (xに128を足しておくと四捨五入になる)
+            const std::uint32_t t     = pCoverage[i] * alpha + 128;
+            const std::uint32_t pixel = rgb | ((t + (t >> 8)) >> 8) << 24;
+            std::memcpy(pOut + i * 4, &pixel, sizeof(pixel));
+        }
+    }
+
+    /**
+     * @brief expandCoverageScalarと同じ結果をSIMDで求める
+     * @detail 被覆率を16bitに広げてアルファを掛け, 32bitに広げて上位8bitに置いてからrgbと合わせる
+     *         16個ずつAVX2(無ければSSE2)で処理し, 端数はスカラー版で処理する
+     */
+    inline void expandCoverage(const std::uint8_t* pCoverage, const std::size_t count, const std::uint32_t color, std::uint8_t* pOut)
+    {
+        std::size_t i = 0;
+
+#if defined(__AVX2__)
+        {
+            const __m256i rgb   = _mm256_set1_epi32(static_cast<int>(color & 0x00ffffffu));
+            const __m256i alpha = _mm256_set1_epi16(static_cast<short>(color >> 24));
+            const __m256i bias  = _mm256_set1_epi16(128);
+
+            for (; i + 16 <= count; i += 16)
+            {
+                __m256i t = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pCoverage + i)));
+                t         = _mm256_add_epi16(_mm256_mullo_epi16(t, alpha), bias);
+                t         = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+
+                const __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(t));
+                const __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(t, 1));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pOut + i * 4), _mm256_or_si256(_mm256_slli_epi32(lo, 24), rgb));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pOut + i * 4 + 32), _mm256_or_si256(_mm256_slli_epi32(hi, 24), rgb));
+            }
+        }
+#endif
+#if defined(__SSE2__)
+        {
+            const __m128i zero  = _mm_setzero_si128();
+            const __m128i rgb   = _mm_set1_epi32(static_cast<int>(color & 0x00ffffffu));
+            const __m128i alpha = _mm_set1_epi16(static_cast<short>(color >> 24));
+            const __m128i bias  = _mm_set1_epi16(128);
+
+            for (; i + 16 <= count; i += 16)
+            {
+                const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pCoverage + i));
+
+                __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(c, zero), alpha), bias);
+                __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(c, zero), alpha), bias);
+                lo         = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+                hi         = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+                auto* pDst = reinterpret_cast<__m128i*>(pOut + i * 4);
+                _mm_storeu_si128(pDst + 0, _mm_or_si128(_mm_slli_epi32(_mm_unpacklo_epi16(lo, zero), 24), rgb));
+                _mm_storeu_si128(pDst + 1, _mm_or_si128(_mm_slli_epi32(_mm_unpackhi_epi16(lo, zero), 24), rgb));
+                _mm_storeu_si128(pDst + 2, _mm_or_si128(_mm_slli_epi32(_mm_unpacklo_epi16(hi, zero), 24), rgb));
+                _mm_storeu_si128(pDst + 3, _mm_or_si128(_mm_slli_epi32(_mm_unpackhi_epi16(hi, zero), 24), rgb));
+            }
+        }
+#endif
+
+        expandCoverageScalar(pCoverage + i, count - i, color, pOut + i * 4);
+    }
+}  // namespace mall
+
+#endif
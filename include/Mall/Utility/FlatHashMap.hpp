@@ -0,0 +1,145 @@
+#ifndef MALL_UTILITY_FLATHASHMAP_HPP_
+#define MALL_UTILITY_FLATHASHMAP_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "Hash.hpp"
+
+namespace mall
+{
+    // 整数のキー向けの既定のハッシュ
+    template <typename Key>
+    struct FlatHash
+    {
+        std::size_t operator()(const Key& key) const
+        {
+            return static_cast<std::size_t>(hashCombine(HashSeed, static_cast<std::uint64_t>(key)));
+        }
+    };
+
+    /**
+     * @brief オープンアドレス法(線形探査)のハッシュテーブル
+     * @detail キーと値を連続した配列に持つので, 小さな値を大量に引く用途(フォントのメトリクスなど)でstd::unordered_mapより速い
+     *         容量は2の冪で, 使用率が7/8を超えると2倍にする
+     *         個別の削除はできない(clearで全て消す)
+     * @warning 追加で配列を作り直すので, findで得たポインタは次のemplaceまでしか使えない
+     */
+    template <typename Key, typename Value, typename Hash = FlatHash<Key>>
+    class FlatHashMap
+    {
+        static_assert(std::is_trivially_copyable_v<Key>, "key of FlatHashMap must be trivially copyable!");
+
+    public:
+        FlatHashMap()
+            : mSize(0)
+        {
+        }
+
+        // 無ければnullptr
+        const Value* find(const Key& key) const
+        {
+            if (mSlots.empty())
+                return nullptr;
+
+            const std::size_t mask = mSlots.size() - 1;
+            for (std::size_t i = Hash()(key) & mask;; i = (i + 1) & mask)
+            {
+                const auto& slot = mSlots[i];
+                if (!slot.used)
+                    return nullptr;
+                if (slot.key == key)
+                    return &slot.value;
+            }
+        }
+
+        // 既にあれば上書きせずにその値を返す
+        Value& emplace(const Key& key, const Value& value)
+        {
+            if ((mSize + 1) * 8 > mSlots.size() * 7)
+                rehash(mSlots.empty() ? InitialCapacity : mSlots.size() * 2);
+
+            const std::size_t mask = mSlots.size() - 1;
+            for (std::size_t i = Hash()(key) & mask;; i = (i + 1) & mask)
+            {
+                auto& slot = mSlots[i];
+                if (!slot.used)
+                {
+                    slot.key   = key;
+                    slot.value = value;
+                    slot.used  = true;
+                    ++mSize;
+                    return slot.value;
+                }
+
+                if (slot.key == key)
+                    return slot.value;
+            }
+        }
+
+        // capacity個入れても作り直さないようにする
+        void reserve(const std::size_t capacity)
+        {
+            std::size_t slotNum = InitialCapacity;
+            while (capacity * 8 > slotNum * 7)
+                slotNum *= 2;
+
+            if (slotNum > mSlots.size())
+                rehash(slotNum);
+        }
+
+        void clear()
+        {
+            mSlots.clear();
+            mSize = 0;
+        }
+
+        std::size_t size() const
+        {
+            return mSize;
+        }
+
+        bool empty() const
+        {
+            return mSize == 0;
+        }
+
+    private:
+        constexpr static std::size_t InitialCapacity = 16;
+
+        struct Slot
+        {
+            Key key;
+            Value value;
+            bool used;
+        };
+
+        void rehash(const std::size_t slotNum)
+        {
+            assert((slotNum & (slotNum - 1)) == 0 || !"slot count must be power of two!");
+
+            std::vector<Slot> old(slotNum, Slot{ Key(), Value(), false });
+            old.swap(mSlots);
+
+            const std::size_t mask = mSlots.size() - 1;
+            for (const auto& slot : old)
+            {
+                if (!slot.used)
+                    continue;
+
+                std::size_t i = Hash()(slot.key) & mask;
+                while (mSlots[i].used)
+                    i = (i + 1) & mask;
+                mSlots[i] = slot;
+            }
+        }
+
+        std::vector<Slot> mSlots;
+        std::size_t mSize;
+    };
+}  // namespace mall
+
+#endif
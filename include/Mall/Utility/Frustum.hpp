@@ -0,0 +1,162 @@
+#ifndef MALL_UTILITY_FRUSTUM_HPP_
+#define MALL_UTILITY_FRUSTUM_HPP_
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace mall
+{
+    /**
+     * @brief 視錐台の6平面, 球やAABBとの交差判定に使う
+     * @detail 平面は成分ごとの配列(SoA)で持ち, 4平面ずつSSEで判定する
+     *         残りの2枠は常に内側と判定される平面で埋める
+     */
+    struct Frustum
+    {
+        // 射影 * ビュー行列から平面を取り出す(内側が正, 法線は正規化)
+        // 深度範囲が[0, 1]の場合もnear面が手前に広がるだけで, 見えるものを落とすことは無い
+        void setup(const glm::mat4& viewProj)
+        {
+            const glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+            const glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+            const glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+            const glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+            const glm::vec4 planes[PlaneNum] = {
+                row3 + row0,  // left
+                row3 - row0,  // right
+                row3 + row1,  // bottom
+                row3 - row1,  // top
+                row3 + row2,  // near
+                row3 - row2,  // far
+            };
+
+            for (std::size_t i = 0; i < PaddedPlaneNum; ++i)
+            {
+                if (i >= PlaneNum)
+                {
+                    x[i] = y[i] = z[i] = 0.f;
+                    w[i]               = FLT_MAX;
+                    continue;
+                }
+
+                const float length = std::sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+                const float inv    = length > 0.f ? 1.f / length : 0.f;
+                x[i]               = planes[i].x * inv;
+                y[i]               = planes[i].y * inv;
+                z[i]               = planes[i].z * inv;
+                w[i]               = planes[i].w * inv;
+            }
+        }
+
+        // 球が少しでも内側にあればtrue
+        bool intersects(const glm::vec3& center, const float radius) const
+        {
+#if defined(__SSE2__)
+            const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+            const __m128 nr = _mm_set1_ps(-radius);
+
+            __m128 outside = _mm_setzero_ps();
+            for (std::size_t i = 0; i < PaddedPlaneNum; i += 4)
+            {
+                __m128 d = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(x + i), cx), _mm_loadu_ps(w + i));
+                d        = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(y + i), cy));
+                d        = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(z + i), cz));
+                outside  = _mm_or_ps(outside, _mm_cmplt_ps(d, nr));
+            }
+
+            return _mm_movemask_ps(outside) == 0;
+#else
+            for (std::size_t i = 0; i < PlaneNum; ++i)
+                if (x[i] * center.x + y[i] * center.y + z[i] * center.z + w[i] < -radius)
+                    return false;
+
+            return true;
+#endif
+        }
+
+        enum class Result
+        {
+            eOutside,
+            eIntersect,
+            eInside,
+        };
+
+        // AABBの判定, 完全に内側ならeInsideを返す(階層的な判定で子の判定を省くため)
+        Result classify(const glm::vec3& min, const glm::vec3& max) const
+        {
+#if defined(__SSE2__)
+            const __m128 minX = _mm_set1_ps(min.x), minY = _mm_set1_ps(min.y), minZ = _mm_set1_ps(min.z);
+            const __m128 maxX = _mm_set1_ps(max.x), maxY = _mm_set1_ps(max.y), maxZ = _mm_set1_ps(max.z);
+            const __m128 zero = _mm_setzero_ps();
+
+            __m128 outside = zero, intersect = zero;
+            for (std::size_t i = 0; i < PaddedPlaneNum; i += 4)
+            {
+                const __m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i), pz = _mm_loadu_ps(z + i), pw = _mm_loadu_ps(w + i);
+
+                // 各軸で法線方向に最も遠い頂点(p)と最も近い頂点(n)の距離
+                const __m128 ax = _mm_mul_ps(px, minX), bx = _mm_mul_ps(px, maxX);
+                const __m128 ay = _mm_mul_ps(py, minY), by = _mm_mul_ps(py, maxY);
+                const __m128 az = _mm_mul_ps(pz, minZ), bz = _mm_mul_ps(pz, maxZ);
+
+                const __m128 dp = _mm_add_ps(_mm_add_ps(_mm_max_ps(ax, bx), _mm_max_ps(ay, by)), _mm_add_ps(_mm_max_ps(az, bz), pw));
+                const __m128 dn = _mm_add_ps(_mm_add_ps(_mm_min_ps(ax, bx), _mm_min_ps(ay, by)), _mm_add_ps(_mm_min_ps(az, bz), pw));
+
+                outside   = _mm_or_ps(outside, _mm_cmplt_ps(dp, zero));
+                intersect = _mm_or_ps(intersect, _mm_cmplt_ps(dn, zero));
+            }
+
+            if (_mm_movemask_ps(outside))
+                return Result::eOutside;
+
+            return _mm_movemask_ps(intersect) ? Result::eIntersect : Result::eInside;
+#else
+            bool intersect = false;
+            for (std::size_t i = 0; i < PlaneNum; ++i)
+            {
+                const float ax = x[i] * min.x, bx = x[i] * max.x;
+                const float ay = y[i] * min.y, by = y[i] * max.y;
+                const float az = z[i] * min.z, bz = z[i] * max.z;
+
+                if (std::max(ax, bx) + std::max(ay, by) + std::max(az, bz) + w[i] < 0.f)
+                    return Result::eOutside;
+                if (std::min(ax, bx) + std::min(ay, by) + std::min(az, bz) + w[i] < 0.f)
+                    intersect = true;
+            }
+
+            return intersect ? Result::eIntersect : Result::eInside;
+#endif
+        }
+
+        // ローカル空間の球(xyz : 中心, w : 半径)をworldで変換して判定する
+        bool intersects(const glm::mat4& world, const glm::vec4& sphere) const
+        {
+            const glm::vec3 center = glm::vec3(world * glm::vec4(glm::vec3(sphere), 1.f));
+
+            // 非一様な拡大でも包むよう最大の軸の拡大率を使う
+            const float scale2 = std::max({ glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+                                            glm::dot(glm::vec3(world[1]), glm::vec3(world[1])),
+                                            glm::dot(glm::vec3(world[2]), glm::vec3(world[2])) });
+
+            return intersects(center, sphere.w * std::sqrt(scale2));
+        }
+
+        constexpr static std::size_t PlaneNum       = 6;
+        constexpr static std::size_t PaddedPlaneNum = 8;
+
+        float x[PaddedPlaneNum];
+        float y[PaddedPlaneNum];
+        float z[PaddedPlaneNum];
+        float w[PaddedPlaneNum];
+    };
+}  // namespace mall
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef MALL_UTILITY_HASH_HPP_
+#define MALL_UTILITY_HASH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mall
+{
+    // ハッシュの初期値(FNV-1aのoffset basis)
+    constexpr std::uint64_t HashSeed = 0xcbf29ce484222325ull;
+
+    /**
+     * @brief seedにvalueを混ぜる, 順序にも依存する
+     * @detail 一致判定の高速化用で, 暗号学的な強度は無い
+     */
+    inline std::uint64_t hashCombine(const std::uint64_t seed, std::uint64_t value)
+    {
+        // splitmix64の最終段で値を散らしてから混ぜる
+        value += 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        value ^= value >> 31;
+
+        return (seed ^ value) * 0x100000001b3ull;
+    }
+
+    inline std::uint64_t hashCombine(const std::uint64_t seed, const void* pointer)
+    {
+        return hashCombine(seed, static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(pointer)));
+    }
+
+    // FNV-1a
+    inline std::uint64_t hashBytes(const void* pData, const std::size_t size, std::uint64_t seed = HashSeed)
+    {
+        const auto* p = static_cast<const std::uint8_t*>(pData);
+        for (std::size_t i = 0; i < size; ++i)
+            seed = (seed ^ p[i]) * 0x100000001b3ull;
+
+        return seed;
+    }
+}  // namespace mall
+
+#endif
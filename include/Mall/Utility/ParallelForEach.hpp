@@ -0,0 +1,54 @@
+#ifndef MALL_UTILITY_PARALLELFOREACH_HPP_
+#define MALL_UTILITY_PARALLELFOREACH_HPP_
+
+#include <tuple>
+#include <vector>
+
+#include "../Engine/JobSystem.hpp"
+
+namespace mall
+{
+    /**
+     * @brief forEachで集めたコンポーネントの組を, JobSystem上で分割して並列に処理する
+     * @detail 使用例
+     *   this->template forEach<TransformData>(mTransforms.collect());
+     *   mTransforms.run(*this->common().jobSystem, [&](TransformData& transform) { ... });
+     * @warning funcは要素ごとに独立であること(他の要素やグローバルな状態に書き込まない)
+     */
+    template <typename... Args>
+    class ParallelForEach
+    {
+    public:
+        // 1ジョブあたりの既定の要素数
+        constexpr static std::size_t DefaultGrainSize = 1024;
+
+        // 前回の結果を捨て, forEachに渡す収集用の関数を返す
+        auto collect()
+        {
+            mRefs.clear();
+            return [this](Args&... args) { mRefs.emplace_back(&args...); };
+        }
+
+        template <typename Func>
+        void run(JobSystem& jobSystem, Func&& func, const std::size_t grain = DefaultGrainSize)
+        {
+            jobSystem.parallelFor(mRefs.size(), grain,
+                                  [&](const std::size_t begin, const std::size_t end)
+                                  {
+                                      for (std::size_t i = begin; i < end; ++i)
+                                          std::apply([&](Args*... args) { func(*args...); }, mRefs[i]);
+                                  });
+        }
+
+        std::size_t size() const
+        {
+            return mRefs.size();
+        }
+
+    private:
+        // フレーム間で使い回して再確保を避ける
+        std::vector<std::tuple<Args*...>> mRefs;
+    };
+}  // namespace mall
+
+#endif
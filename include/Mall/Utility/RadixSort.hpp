@@ -0,0 +1,61 @@
+#ifndef MALL_UTILITY_RADIXSORT_HPP_
+#define MALL_UTILITY_RADIXSORT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace mall
+{
+    /**
+     * @brief 64bitのキーとそれに対応する値を, キーの昇順に並べる(安定)
+     * @detail 下位から8bitずつ計数ソートする(LSD), 全要素で同じ値の桁は並べ替えずに飛ばす
+     *         keysTmp, valuesTmpは作業領域で, 呼び出し間で使い回せば確保が起きない
+     */
+    template <typename Value>
+    inline void radixSort(std::vector<std::uint64_t>& keys, std::vector<Value>& values, std::vector<std::uint64_t>& keysTmp, std::vector<Value>& valuesTmp)
+    {
+        const std::size_t count = keys.size();
+        if (count <= 1)
+            return;
+
+        keysTmp.resize(count);
+        valuesTmp.resize(count);
+
+        // 全ての桁の度数を1回の走査で数える
+        std::size_t histograms[8][256] = {};
+        for (const std::uint64_t key : keys)
+            for (std::size_t digit = 0; digit < 8; ++digit)
+                ++histograms[digit][(key >> (digit * 8)) & 0xFF];
+
+        for (std::size_t digit = 0; digit < 8; ++digit)
+        {
+            std::size_t* histogram = histograms[digit];
+            const std::size_t shift = digit * 8;
+
+            if (histogram[(keys[0] >> shift) & 0xFF] == count)
+                continue;
+
+            std::size_t offset = 0;
+            for (std::size_t b = 0; b < 256; ++b)
+            {
+                const std::size_t n = histogram[b];
+                histogram[b]        = offset;
+                offset += n;
+            }
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const std::size_t to = histogram[(keys[i] >> shift) & 0xFF]++;
+                keysTmp[to]          = keys[i];
+                valuesTmp[to]        = std::move(values[i]);
+            }
+
+            keys.swap(keysTmp);
+            values.swap(valuesTmp);
+        }
+    }
+}  // namespace mall
+
+#endif
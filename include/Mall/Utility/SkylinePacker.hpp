@@ -0,0 +1,166 @@
+#ifndef MALL_UTILITY_SKYLINEPACKER_HPP_
+#define MALL_UTILITY_SKYLINEPACKER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace mall
+{
+    /**
+     * @brief 矩形を1枚の領域に詰めていく(スカイライン法, bottom-left)
+     * @detail 詰めた矩形の上端を折れ線(スカイライン)で持ち, 置いた後の上端が最も低くなる位置に置く
+     *         追加は1個ずつ行えるが, 個別に取り除くことはできない(resetで全て空ける)
+     */
+    class SkylinePacker
+    {
+    public:
+        SkylinePacker(const std::uint32_t width = 0, const std::uint32_t height = 0)
+        {
+            reset(width, height);
+        }
+
+        void reset(const std::uint32_t width, const std::uint32_t height)
+        {
+            mWidth    = width;
+            mHeight   = height;
+            mUsedArea = 0;
+            mSkyline.clear();
+            mSkyline.push_back({ 0, 0, width });
+        }
+
+        // width * heightの矩形を置く位置を返す, 入らなければfalse
+        bool insert(const std::uint32_t width, const std::uint32_t height, std::uint32_t& x, std::uint32_t& y)
+        {
+            if (width == 0 || height == 0 || width > mWidth || height > mHeight)
+                return false;
+
+            std::size_t best        = InvalidIndex;
+            std::uint32_t bestTop   = std::numeric_limits<std::uint32_t>::max();
+            std::uint32_t bestWidth = std::numeric_limits<std::uint32_t>::max();
+            std::uint32_t bestY     = 0;
+
+            for (std::size_t i = 0; i < mSkyline.size(); ++i)
+            {
+                std::uint32_t fitY = 0;
+                if (!fit(i, width, height, fitY))
+                    continue;
+
+                // 上端が低い位置, 同じなら狭い段を優先する(隙間を残しにくい)
+                const std::uint32_t top = fitY + height;
+                if (top < bestTop || (top == bestTop && mSkyline[i].width < bestWidth))
+                {
+                    best      = i;
+                    bestTop   = top;
+                    bestWidth = mSkyline[i].width;
+                    bestY     = fitY;
+                }
+            }
+
+            if (best == InvalidIndex)
+                return false;
+
+            x = mSkyline[best].x;
+            y = bestY;
+            place(best, width, height, bestY);
+            mUsedArea += static_cast<std::uint64_t>(width) * height;
+
+            return true;
+        }
+
+        // 使用済みの面積の割合
+        float getOccupancy() const
+        {
+            const auto area = static_cast<std::uint64_t>(mWidth) * mHeight;
+            return area > 0 ? static_cast<float>(mUsedArea) / area : 0.f;
+        }
+
+        std::uint32_t getWidth() const
+        {
+            return mWidth;
+        }
+
+        std::uint32_t getHeight() const
+        {
+            return mHeight;
+        }
+
+    private:
+        constexpr static std::size_t InvalidIndex = ~std::size_t(0);
+
+        // [x, x + width)の上端がy
+        struct Segment
+        {
+            std::uint32_t x;
+            std::uint32_t y;
+            std::uint32_t width;
+        };
+
+        // mSkyline[index]の左端に置いたときの下端を求める
+        bool fit(const std::size_t index, const std::uint32_t width, const std::uint32_t height, std::uint32_t& y) const
+        {
+            const std::uint32_t x = mSkyline[index].x;
+            if (x + width > mWidth)
+                return false;
+
+            y                    = 0;
+            std::uint32_t remain = width;
+            for (std::size_t i = index; remain > 0; ++i)
+            {
+                if (mSkyline[i].y > y)
+                    y = mSkyline[i].y;
+                if (y + height > mHeight)
+                    return false;
+
+                remain = mSkyline[i].width >= remain ? 0 : remain - mSkyline[i].width;
+            }
+
+            return true;
+        }
+
+        void place(const std::size_t index, const std::uint32_t width, const std::uint32_t height, const std::uint32_t y)
+        {
+            const Segment segment{ mSkyline[index].x, y + height, width };
+            mSkyline.insert(mSkyline.begin() + index, segment);
+
+            // 新しい段に隠れた分を後ろから削る
+            const std::uint32_t right = segment.x + segment.width;
+            for (std::size_t i = index + 1; i < mSkyline.size();)
+            {
+                if (mSkyline[i].x >= right)
+                    break;
+
+                const std::uint32_t end = mSkyline[i].x + mSkyline[i].width;
+                if (end <= right)
+                {
+                    mSkyline.erase(mSkyline.begin() + i);
+                    continue;
+                }
+
+                mSkyline[i].width = end - right;
+                mSkyline[i].x     = right;
+                break;
+            }
+
+            // 同じ高さで隣り合う段をまとめる
+            for (std::size_t i = 0; i + 1 < mSkyline.size();)
+            {
+                if (mSkyline[i].y == mSkyline[i + 1].y)
+                {
+                    mSkyline[i].width += mSkyline[i + 1].width;
+                    mSkyline.erase(mSkyline.begin() + i + 1);
+                }
+                else
+                    ++i;
+            }
+        }
+
+        std::uint32_t mWidth;
+        std::uint32_t mHeight;
+        std::uint64_t mUsedArea;
+        std::vector<Segment> mSkyline;
+    };
+}  // namespace mall
+
+#endif
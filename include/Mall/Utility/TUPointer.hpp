@@ -34,8 +34,19 @@ namespace mall
             return mAddress;
         }
 
+        // 指す先を解放したら呼ぶ(解放済みのものを使うとget, dataのassertで止まる)
+        void reset()
+        {
+            mAddress = nullptr;
+        }
+
+        bool isCreated() const
+        {
+            return mAddress != nullptr;
+        }
+
     private:
-        T* mAddress;
+        T* mAddress = nullptr;
     };
 }  // namespace mall
 
@@ -0,0 +1,131 @@
+#ifndef MALL_UTILITY_TRANSFORMMATH_HPP_
+#define MALL_UTILITY_TRANSFORMMATH_HPP_
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace mall
+{
+    /**
+     * @brief translate(pos) * toMat4(rot) * scale(scale)を行列積を使わずに直接組み立てる
+     * @detail 回転行列の各列に拡大率を掛け, 4列目に平行移動を置くだけでよい
+     */
+    inline glm::mat4 composeTRS(const glm::vec3& pos, const glm::quat& rot, const glm::vec3& scale)
+    {
+        const float xx = rot.x * rot.x, yy = rot.y * rot.y, zz = rot.z * rot.z;
+        const float xy = rot.x * rot.y, xz = rot.x * rot.z, yz = rot.y * rot.z;
+        const float wx = rot.w * rot.x, wy = rot.w * rot.y, wz = rot.w * rot.z;
+
+        glm::mat4 m;
+        m[0] = glm::vec4((1.f - 2.f * (yy + zz)) * scale.x, 2.f * (xy + wz) * scale.x, 2.f * (xz - wy) * scale.x, 0.f);
+        m[1] = glm::vec4(2.f * (xy - wz) * scale.y, (1.f - 2.f * (xx + zz)) * scale.y, 2.f * (yz + wx) * scale.y, 0.f);
+        m[2] = glm::vec4(2.f * (xz + wy) * scale.z, 2.f * (yz - wx) * scale.z, (1.f - 2.f * (xx + yy)) * scale.z, 0.f);
+        m[3] = glm::vec4(pos, 1.f);
+
+        return m;
+    }
+
+    /**
+     * @brief 平行移動, 回転, 拡大だけからなるワールド行列aからbへの途中をtで補間する(固定タイムステップの描画補間用)
+     * @detail 行列の成分をそのまま線形補間すると回転の途中で縮むので, 分解して回転は球面線形補間する
+     */
+    inline glm::mat4 interpolateTRS(const glm::mat4& a, const glm::mat4& b, const float t)
+    {
+        const glm::vec3 scaleA(glm::length(glm::vec3(a[0])), glm::length(glm::vec3(a[1])), glm::length(glm::vec3(a[2])));
+        const glm::vec3 scaleB(glm::length(glm::vec3(b[0])), glm::length(glm::vec3(b[1])), glm::length(glm::vec3(b[2])));
+
+        // 拡大が0の軸は回転を取り出せないので補間しない
+        if (scaleA.x * scaleA.y * scaleA.z == 0.f || scaleB.x * scaleB.y * scaleB.z == 0.f)
+            return t < 0.5f ? a : b;
+
+        const glm::quat rotA = glm::quat_cast(glm::mat3(glm::vec3(a[0]) / scaleA.x, glm::vec3(a[1]) / scaleA.y, glm::vec3(a[2]) / scaleA.z));
+        const glm::quat rotB = glm::quat_cast(glm::mat3(glm::vec3(b[0]) / scaleB.x, glm::vec3(b[1]) / scaleB.y, glm::vec3(b[2]) / scaleB.z));
+
+        return composeTRS(glm::mix(glm::vec3(a[3]), glm::vec3(b[3]), t), glm::slerp(rotA, rotB, t), glm::mix(scaleA, scaleB, t));
+    }
+
+    /**
+     * @brief 成分ごとの配列(SoA)からcount個のワールド行列を連続した配列に合成する
+     * @detail SSEでは4個ずつ各要素を同時に計算し, 転置して行列ごとに書き出す
+     */
+    inline void composeTRS(const float* px, const float* py, const float* pz,
+                           const float* rx, const float* ry, const float* rz, const float* rw,
+                           const float* sx, const float* sy, const float* sz,
+                           const std::size_t count, glm::mat4* pOut)
+    {
+        std::size_t i = 0;
+
+#if defined(__SSE2__)
+        static_assert(sizeof(glm::mat4) == sizeof(float) * 16, "glm::mat4 must be tightly packed");
+
+        const __m128 one  = _mm_set1_ps(1.f);
+        const __m128 two  = _mm_set1_ps(2.f);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 x = _mm_loadu_ps(rx + i), y = _mm_loadu_ps(ry + i), z = _mm_loadu_ps(rz + i), w = _mm_loadu_ps(rw + i);
+
+            const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+            const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+            const __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+            const __m128 scaleX = _mm_loadu_ps(sx + i), scaleY = _mm_loadu_ps(sy + i), scaleZ = _mm_loadu_ps(sz + i);
+
+            // cRは第c列のR成分(4行列分)
+            __m128 c0x = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX);
+            __m128 c0y = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX);
+            __m128 c0z = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX);
+            __m128 c0w = zero;
+
+            __m128 c1x = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY);
+            __m128 c1y = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY);
+            __m128 c1z = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY);
+            __m128 c1w = zero;
+
+            __m128 c2x = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ);
+            __m128 c2y = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ);
+            __m128 c2z = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ);
+            __m128 c2w = zero;
+
+            __m128 c3x = _mm_loadu_ps(px + i);
+            __m128 c3y = _mm_loadu_ps(py + i);
+            __m128 c3z = _mm_loadu_ps(pz + i);
+            __m128 c3w = one;
+
+            // 転置するとk番目のレジスタがk番目の行列の列になる
+            _MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+            _MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+            _MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+            _MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+
+            const __m128 cols[4][4] = {
+                { c0x, c1x, c2x, c3x },
+                { c0y, c1y, c2y, c3y },
+                { c0z, c1z, c2z, c3z },
+                { c0w, c1w, c2w, c3w },
+            };
+
+            for (std::size_t k = 0; k < 4; ++k)
+            {
+                float* pDst = &pOut[i + k][0][0];
+                _mm_storeu_ps(pDst + 0, cols[k][0]);
+                _mm_storeu_ps(pDst + 4, cols[k][1]);
+                _mm_storeu_ps(pDst + 8, cols[k][2]);
+                _mm_storeu_ps(pDst + 12, cols[k][3]);
+            }
+        }
+#endif
+
+        for (; i < count; ++i)
+            pOut[i] = composeTRS(glm::vec3(px[i], py[i], pz[i]), glm::quat(rw[i], rx[i], ry[i], rz[i]), glm::vec3(sx[i], sy[i], sz[i]));
+    }
+}  // namespace mall
+
+#endif
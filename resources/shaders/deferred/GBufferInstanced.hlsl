@@ -0,0 +1,83 @@
+// attention : (bx, spacey) == set y, binding x (regardless of register type)
+// GBuffer.hlslのインスタンシング版(スキニング無し), world行列はInstanceCBからSV_InstanceIDで引く
+// InstanceCBは複数の描画で共有し, 各描画の先頭はfirstInstanceで指定する
+// そのためSV_InstanceIDがfirstInstanceを含むよう, -fvk-support-nonzero-base-instanceは付けずにコンパイルすること
+// dxc -spirv -T vs_6_0 -E VSMain GBufferInstanced.hlsl -Fo GBufferInstanced_vert.spv
+// dxc -spirv -T ps_6_0 -E PSMain GBufferInstanced.hlsl -Fo GBufferInstanced_frag.spv
+
+static const int MaxInstanceNum = 256;
+
+// レイアウトはGBuffer.hlslのModelCBと同じ(worldは使わない)
+cbuffer ModelCB : register(b0, space0)
+{
+    float4x4 world;
+    float4x4 view;
+    float4x4 proj;
+    float receiveShadow;
+    float lighting;
+    uint useBone;
+    uint paddingModelCB;
+};
+
+cbuffer InstanceCB : register(b1, space0)
+{
+    float4x4 instanceWorld[MaxInstanceNum];
+}
+
+// combined image sampler(set : 1, binding : 0)
+Texture2D<float4> tex : register(t0, space1);
+SamplerState testSampler : register(s0, space1);
+
+struct VSInput
+{
+    float3 pos : POSITION;
+    float3 normal : NORMAL;
+    float2 uv0 : TEXCOORD0;
+    float4 joint0;
+    float4 weight0;
+};
+
+struct VSOutput
+{
+    float4 pos : SV_Position;
+    float3 normal : Normal;
+    float2 uv0 : Texcoord0;
+    float4 worldPos;
+};
+
+struct PSOut
+{
+    float4 albedo : SV_Target0;
+    float4 normal : SV_Target1;
+    float4 worldPos : SV_Target2;
+    float4 metalic : SV_Target3;
+    float4 roughness : SV_Target4;
+};
+
+VSOutput VSMain(VSInput input, uint instanceID : SV_InstanceID)
+{
+    VSOutput output;
+
+    float4x4 instance = instanceWorld[instanceID];
+    float4 pos        = float4(input.pos.xyz, 1.f);
+    float4 normal     = float4(input.normal, 1.f);
+
+    output.pos      = mul(mul(mul(proj, view), instance), pos);
+    output.normal   = mul(instance, normal).xyz;
+    output.uv0      = input.uv0;
+    output.worldPos = mul(instance, pos);
+
+    return output;
+}
+
+PSOut PSMain(VSOutput input)
+{
+    PSOut psOut;
+    psOut.albedo    = tex.Sample(testSampler, input.uv0);
+    psOut.normal    = float4((input.normal / 2.f + 0.5f), lighting);
+    psOut.worldPos  = float4(input.worldPos.xyz, receiveShadow);
+    psOut.metalic   = float4(0, 0, 0, 0);
+    psOut.roughness = float4(0, 0, 0, 0);
+
+    return psOut;
+}
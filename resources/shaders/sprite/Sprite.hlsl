@@ -14,12 +14,14 @@ struct VSInput
 {
 	float3 pos : Position;
 	float2 uv0 : TexCoord0;
+	float4 color : Color0;
 };
 
 struct VSOutput
 {
 	float4 pos : SV_Position;
 	float2 uv0 : Texcoord0;
+	float4 color : Color0;
 };
 
 VSOutput VSMain(VSInput input)
@@ -28,6 +30,7 @@ VSOutput VSMain(VSInput input)
 
 	output.pos = mul(proj, float4(input.pos, 1.f));
 	output.uv0 = input.uv0;
+	output.color = input.color;
 
 	return output;
 }
@@ -35,5 +38,6 @@ VSOutput VSMain(VSInput input)
 float4 PSMain(VSOutput input) : SV_Target0
 {
 	//return float4(1.f, 0, 0, 1.f);
-	return tex.Sample(testSampler, input.uv0);
+	// テキストのグリフは白なので頂点色がそのまま文字の色になる(スプライトは白)
+	return tex.Sample(testSampler, input.uv0) * input.color;
 }
\ No newline at end of file
@@ -0,0 +1,53 @@
+//attention : (bx, spacey) == set y, binding x (regardless of register type)
+// Sprite.hlslの距離場テキスト版, アルファにはGlyphAtlasが焼いた輪郭からの距離(0.5が輪郭)が入っている
+// 頂点シェーダはSprite_vert.spvをそのまま使うのでフラグメントシェーダだけコンパイルすればよい
+// dxc -spirv -T ps_6_0 -E PSMain SpriteSDF.hlsl -Fo SpriteSDF_frag.spv
+
+cbuffer ModelCB : register(b0, space0)
+{
+	float4x4 proj;
+};
+
+//combined image sampler(set : 1, binding : 0)
+Texture2D<float4> tex : register(t0, space1);
+SamplerState testSampler : register(s0, space1);
+
+struct VSInput
+{
+	float3 pos : Position;
+	float2 uv0 : TexCoord0;
+	float4 color : Color0;
+};
+
+struct VSOutput
+{
+	float4 pos : SV_Position;
+	float2 uv0 : Texcoord0;
+	float4 color : Color0;
+};
+
+VSOutput VSMain(VSInput input)
+{
+	VSOutput output = (VSOutput)0;
+
+	output.pos = mul(proj, float4(input.pos, 1.f));
+	output.uv0 = input.uv0;
+	output.color = input.color;
+
+	return output;
+}
+
+float4 PSMain(VSOutput input) : SV_Target0
+{
+	float4 texel = tex.Sample(testSampler, input.uv0);
+
+	// 画面上で1ピクセル進んだときの距離の変化量を縁の幅にする(拡大しても縮小しても縁は約1ピクセル)
+	float width = max(fwidth(texel.a), 1e-4f);
+	float alpha = smoothstep(0.5f - width, 0.5f + width, texel.a);
+
+	// 輪郭から離れた部分は書き込まない
+	clip(alpha - 1.f / 255.f);
+
+	// グリフは白なので色は頂点色から取る
+	return float4(input.color.rgb, alpha * input.color.a);
+}
@@ -0,0 +1,25 @@
+#include "../../include/Mall/ComponentData/HierarchyData.hpp"
+
+namespace mall
+{
+    void HierarchyData::setup(TransformHierarchy& hierarchy, const TransformHierarchy::NodeID parent)
+    {
+        pHierarchy = &hierarchy;
+        node       = hierarchy.create(parent);
+    }
+
+    void HierarchyData::setParent(const TransformHierarchy::NodeID parent)
+    {
+        pHierarchy->setParent(node, parent);
+    }
+
+    void HierarchyData::release()
+    {
+        if (!pHierarchy)
+            return;
+
+        pHierarchy->destroy(node);
+        pHierarchy = nullptr;
+        node       = TransformHierarchy::InvalidID;
+    }
+}  // namespace mall
@@ -1,16 +1,248 @@
 #include "../../include/Mall/ComponentData/TextData.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+
+#include "../../include/Mall/Utility/CoverageExpand.hpp"
+#include "../../include/Mall/Utility/Hash.hpp"
+
 namespace mall
 {
     void TextData::setText(std::wstring_view wstr, std::uint32_t width_, std::uint32_t height_, glm::vec4 color_, bool centerFlag_)
     {
-        static std::wstring ws;
-        ws = wstr;
-        width = width_;
-        height = height_;
-        color = color_;
+        assert(storage.isCreated() || !"text was not created by ResourceBank!");
+
+        auto& st = storage.get();
+        if (st.text != wstr)
+        {
+            st.text = wstr;
+            ++st.version;
+        }
+
+        width      = width_;
+        height     = height_;
+        color      = color_;
         centerFlag = centerFlag_;
-        
-        string.create(ws.data(), ws.size());
     }
-}
\ No newline at end of file
+
+    std::wstring_view TextData::getText() const
+    {
+        assert(storage.isCreated() || !"text was not created by ResourceBank!");
+
+        return storage.get().text;
+    }
+
+    void TextData::rasterize(RGBA* pOut)
+    {
+        assert(pOut);
+
+        const std::wstring_view string = getText();
+
+        /* create a bitmap */
+        const uint32_t bitmap_w = width;  /* Width of bitmap */
+        const uint32_t bitmap_h = height; /* Height of bitmap */
+        unsigned char* bitmap   = (unsigned char*)calloc(bitmap_w * bitmap_h, sizeof(unsigned char));
+
+        /* "STB"unicode encoding of */
+        // char word[20] = "test image";
+        // std::string str = "test string";
+
+        /* Calculate font scaling */
+        float pixels = pixelHeight;                                             /* Font size (font size) */
+        float scale  = stbtt_ScaleForPixelHeight(fontInfo.data(), pixels); /* scale = pixels / (ascent - descent) */
+
+        /**
+         * Get the measurement in the vertical direction
+         * ascent: The height of the font from the baseline to the top;
+         * descent: The height from baseline to bottom is usually negative;
+         * lineGap: The distance between two fonts;
+         * The line spacing is: ascent - descent + lineGap.
+         */
+        int ascent  = 0;
+        int descent = 0;
+        int lineGap = 0;
+        stbtt_GetFontVMetrics(fontInfo.data(), &ascent, &descent, &lineGap);
+
+        /* Adjust word height according to zoom */
+        ascent  = roundf(ascent * scale);
+        descent = roundf(descent * scale);
+
+        int x = 0; /*x of bitmap*/
+
+        /* Cyclic loading of each character in word */
+        // for (int i = 0; i < strlen(word); ++i)
+        auto&& len = string.size();
+        for (std::size_t i = 0; i < len; ++i)
+        {
+            /**
+             * Get the measurement in the horizontal direction
+             * advanceWidth: Word width;
+             * leftSideBearing: Left side position;
+             */
+            int advanceWidth    = 0;
+            int leftSideBearing = 0;
+            stbtt_GetCodepointHMetrics(fontInfo.data(), string[i], &advanceWidth, &leftSideBearing);
+
+            /* Gets the border of a character */
+            int c_x1, c_y1, c_x2, c_y2;
+            stbtt_GetCodepointBitmapBox(fontInfo.data(), string[i], scale, scale, &c_x1, &c_y1, &c_x2, &c_y2);
+
+            /* Calculate the y of the bitmap (different characters have different heights) */
+            int y = ascent + c_y1;
+
+            /* Render character */
+            int byteOffset = x + roundf(leftSideBearing * scale) + (y * bitmap_w);
+            stbtt_MakeCodepointBitmap(fontInfo.data(), bitmap + byteOffset, c_x2 - c_x1, c_y2 - c_y1, bitmap_w, scale, scale, string[i]);
+
+            /* Adjust x */
+            x += roundf(advanceWidth * scale);
+
+            /* kerning */
+            if (i < len - 1)
+            {
+                int kern;
+                kern = stbtt_GetCodepointKernAdvance(fontInfo.data(), string[i], string[i + 1]);
+                x += roundf(kern * scale);
+            }
+        }
+
+        // 被覆率をアルファにして展開する(閾値で切らないので縁が滑らかになる)
+        static_assert(sizeof(RGBA) == 4, "RGBA must be tightly packed!");
+        expandCoverage(bitmap, static_cast<std::size_t>(bitmap_w) * bitmap_h, GlyphAtlas::packColor(color), reinterpret_cast<std::uint8_t*>(pOut));
+
+        free(bitmap);
+    }
+
+    void TextData::layout(GlyphAtlas& glyphAtlas)
+    {
+        auto& quads = storage.get().quads;
+        quads.clear();
+
+        const stbtt_fontinfo& font = fontInfo.get();
+        const float scale          = stbtt_ScaleForPixelHeight(&font, pixelHeight);
+
+        // rasterizeと同じくascentの位置を1行目のベースラインとする
+        int ascent = 0, descent = 0, lineGap = 0;
+        glyphAtlas.getVMetrics(font, ascent, descent, lineGap);
+        const float lineHeight = std::round((ascent - descent + lineGap) * scale);
+
+        const std::wstring_view string = getText();
+
+        // 折り返すときは直前の空白の後ろ(breakQuad番目の矩形, ペン位置breakX)から次の行に送る
+        constexpr std::size_t NoBreak = ~std::size_t(0);
+        std::size_t breakQuad         = NoBreak;
+        float breakX                  = 0;
+
+        float x        = 0;
+        float y        = std::round(ascent * scale);
+        const auto len = string.size();
+        for (std::size_t i = 0; i < len; ++i)
+        {
+            const auto codepoint = static_cast<std::uint32_t>(string[i]);
+
+            if (codepoint == L'\n')
+            {
+                x = 0;
+                y += lineHeight;
+                breakQuad = NoBreak;
+                continue;
+            }
+
+            const auto metrics = glyphAtlas.getHMetrics(font, codepoint);
+            const auto& glyph  = glyphAtlas.get(font, pixelHeight, codepoint, sdfFlag);
+            if (glyph.pTexture)
+            {
+                // 距離場のグリフはSDFPixelHeightで作られているので大きさを合わせる
+                const float glyphScale = glyph.sdf ? pixelHeight / GlyphAtlas::SDFPixelHeight : 1.f;
+                const glm::vec2 offset = glm::vec2(glyph.offset) * glyphScale;
+                const glm::vec2 size   = glm::vec2(glyph.size) * glyphScale;
+
+                // 枠の右端を超える文字は次の行に送る(行頭の文字は送っても入らないのでそのまま)
+                if (wrapFlag && x + offset.x + size.x > width && x > 0)
+                {
+                    if (breakQuad != NoBreak)
+                    {  // 空白より後ろの語ごと送る
+                        for (std::size_t q = breakQuad; q < quads.size(); ++q)
+                        {
+                            quads[q].min += glm::vec2(-breakX, lineHeight);
+                            quads[q].max += glm::vec2(-breakX, lineHeight);
+                        }
+                        x -= breakX;
+                    }
+                    else  // 1語が枠より長ければこの文字から送る
+                        x = 0;
+
+                    y += lineHeight;
+                    breakQuad = NoBreak;
+                }
+
+                Quad quad;
+                quad.min      = glm::vec2(x, y) + offset;
+                quad.max      = quad.min + size;
+                quad.uvRect   = glyph.uvRect;
+                quad.pTexture = glyph.pTexture;
+                quad.sdf      = glyph.sdf;
+                quads.emplace_back(quad);
+            }
+
+            x += std::round(metrics.advanceWidth * scale);
+
+            if (i < len - 1)
+                x += std::round(glyphAtlas.getKernAdvance(font, codepoint, static_cast<std::uint32_t>(string[i + 1])) * scale);
+
+            // 空白(描くものが無い文字)の後ろで折り返せる
+            if (!glyph.pTexture)
+            {
+                breakQuad = quads.size();
+                breakX    = x;
+            }
+        }
+
+        // 枠からはみ出た分はuvごと切り詰める
+        const glm::vec2 box(static_cast<float>(width), static_cast<float>(height));
+        std::size_t count = 0;
+        for (auto quad : quads)
+        {
+            const glm::vec2 clippedMin = glm::max(quad.min, glm::vec2(0.f));
+            const glm::vec2 clippedMax = glm::min(quad.max, box);
+            if (clippedMin.x >= clippedMax.x || clippedMin.y >= clippedMax.y)
+                continue;
+
+            const glm::vec2 uvMin(quad.uvRect.x, quad.uvRect.y);
+            const glm::vec2 uvScale = (glm::vec2(quad.uvRect.z, quad.uvRect.w) - uvMin) / (quad.max - quad.min);
+            const glm::vec2 u0      = uvMin + (clippedMin - quad.min) * uvScale;
+            const glm::vec2 u1      = uvMin + (clippedMax - quad.min) * uvScale;
+
+            quad.min    = clippedMin;
+            quad.max    = clippedMax;
+            quad.uvRect = glm::vec4(u0.x, u0.y, u1.x, u1.y);
+
+            quads[count++] = quad;
+        }
+
+        quads.resize(count);
+    }
+
+    bool TextData::updateLayout(GlyphAtlas& glyphAtlas)
+    {
+        auto& st = storage.get();
+
+        std::uint64_t key = hashCombine(HashSeed, static_cast<std::uint64_t>(st.version));
+        key               = hashCombine(key, fontInfo.data());
+        key               = hashCombine(key, static_cast<std::uint64_t>(width) << 32 | height);
+        key               = hashBytes(&pixelHeight, sizeof(pixelHeight), key);
+        key               = hashCombine(key, static_cast<std::uint64_t>(sdfFlag) << 1 | wrapFlag);
+        // グリフを捨てたらページ上の位置が無効になる
+        key = hashCombine(key, glyphAtlas.getGeneration());
+
+        if (key == st.layoutKey)
+            return false;
+
+        layout(glyphAtlas);
+        st.layoutKey = key;
+
+        return true;
+    }
+}  // namespace mall
@@ -9,6 +9,92 @@ namespace mall
         acc   = acceleration;
         scale = scalePerAxis;
         rot   = rotationQuat;
+
+        pStore  = nullptr;
+        storeID = TransformStore::InvalidID;
+
+        composed.valid = false;
+        dirty          = true;
+    }
+
+    void TransformData::setup(TransformStore& store, glm::vec3 position, glm::vec3 velocity, glm::vec3 acceleration, glm::vec3 scalePerAxis, glm::quat rotationQuat)
+    {
+        // メンバはストアの値の写しとして持つ
+        pos   = position;
+        vel   = velocity;
+        acc   = acceleration;
+        scale = scalePerAxis;
+        rot   = rotationQuat;
+
+        pStore  = &store;
+        storeID = store.create(position, velocity, acceleration, scalePerAxis, rotationQuat);
+        synced  = Synced{ pos, vel, acc, scale, rot };
+
+        composed.valid = false;
+        dirty          = true;
+    }
+
+    void TransformData::release()
+    {
+        if (!pStore)
+            return;
+
+        // メンバは最後に読み戻した値(とその後に書き換えた分)なので, 以降はそのままメンバに値を持つ
+        pStore->destroy(storeID);
+        pStore  = nullptr;
+        storeID = TransformStore::InvalidID;
+
+        composed.valid = false;
+    }
+
+    void TransformData::pushToStore()
+    {
+        if (!pStore)
+            return;
+
+        if (pos != synced.pos)
+            pStore->setPos(storeID, pos);
+        if (vel != synced.vel)
+            pStore->setVel(storeID, vel);
+        if (acc != synced.acc)
+            pStore->setAcc(storeID, acc);
+        if (scale != synced.scale)
+            pStore->setScale(storeID, scale);
+        if (rot != synced.rot)
+            pStore->setRot(storeID, rot);
+    }
+
+    void TransformData::pullFromStore()
+    {
+        if (!pStore)
+            return;
+
+        pos    = pStore->getPos(storeID);
+        vel    = pStore->getVel(storeID);
+        acc    = pStore->getAcc(storeID);
+        scale  = pStore->getScale(storeID);
+        rot    = pStore->getRot(storeID);
+        synced = Synced{ pos, vel, acc, scale, rot };
+    }
+
+    void TransformData::integrate(const float deltaTime)
+    {
+        if (pStore || (vel == glm::vec3(0.f) && acc == glm::vec3(0.f)))
+            return;
+
+        vel += acc * deltaTime;
+        pos += vel * deltaTime;
+    }
+
+    bool TransformData::updateDirty()
+    {
+        if (pStore)
+            return dirty = true;
+
+        dirty = !composed.valid || pos != composed.pos || rot != composed.rot || scale != composed.scale;
+        if (dirty)
+            composed = Composed{ pos, rot, scale, true };
+
+        return dirty;
     }
-    
-}  // namespace mall
\ No newline at end of file
+}  // namespace mall
@@ -6,10 +6,13 @@
 
 namespace mall
 {
-    Audio::Audio()
+    Audio::Audio(const bool headless)
     {
         // Pa_Initialize();
-        mSoloud.init();
+        if (headless)
+            mSoloud.init(SoLoud::Soloud::CLIP_ROUNDOFF, SoLoud::Soloud::NULLDRIVER);
+        else
+            mSoloud.init();
     }
 
     Audio::~Audio()
@@ -0,0 +1,141 @@
+#include "../../include/Mall/Engine/FrameLimiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+namespace mall
+{
+    FrameLimiter::FrameLimiter()
+        : mTargetFPS(0)
+        , mIdleFPS(0)
+        , mIdleSeconds(5.)
+        , mNextDeadline(Clock::now())
+        , mLastActivity(Clock::now())
+        , mLastFrameEnd(Clock::now())
+        , mSpinMargin(std::chrono::microseconds(1000))
+        , mFrameTimes()
+        , mFrameCount(0)
+    {
+    }
+
+    FrameLimiter::~FrameLimiter()
+    {
+        std::cerr << "Frame limiter shut down\n";
+    }
+
+    void FrameLimiter::setTargetFPS(const double fps)
+    {
+        mTargetFPS    = fps;
+        mNextDeadline = Clock::now();
+    }
+
+    void FrameLimiter::setIdleFPS(const double idleFPS, const double idleSeconds)
+    {
+        mIdleFPS      = idleFPS;
+        mIdleSeconds  = idleSeconds;
+        mLastActivity = Clock::now();
+    }
+
+    void FrameLimiter::notifyActivity()
+    {
+        mLastActivity = Clock::now();
+    }
+
+    void FrameLimiter::wait()
+    {
+        const double fps = getCurrentTargetFPS();
+
+        if (fps > 0)
+        {
+            const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1. / fps));
+
+            mNextDeadline += period;
+
+            // 1フレーム以上遅れている場合は取り戻そうとせず基準を合わせ直す
+            const auto now = Clock::now();
+            if (now > mNextDeadline + period)
+                mNextDeadline = now;
+            else
+                sleepUntil(mNextDeadline);
+        }
+        else
+            mNextDeadline = Clock::now();
+
+        const auto frameEnd = Clock::now();
+        mFrameTimes[mFrameCount % SampleNum] = std::chrono::duration<double, std::milli>(frameEnd - mLastFrameEnd).count();
+        mLastFrameEnd = frameEnd;
+        ++mFrameCount;
+    }
+
+    bool FrameLimiter::isIdle() const
+    {
+        if (mIdleFPS <= 0)
+            return false;
+
+        return std::chrono::duration<double>(Clock::now() - mLastActivity).count() >= mIdleSeconds;
+    }
+
+    double FrameLimiter::getCurrentTargetFPS() const
+    {
+        if (isIdle())
+            return mTargetFPS > 0 ? std::min(mTargetFPS, mIdleFPS) : mIdleFPS;
+
+        return mTargetFPS;
+    }
+
+    FrameLimiter::Stats FrameLimiter::getStats() const
+    {
+        Stats stats{};
+
+        // 初回のフレームは起動からの時間なので含めない
+        const std::size_t num = static_cast<std::size_t>(std::min<std::uint64_t>(mFrameCount > 0 ? mFrameCount - 1 : 0, SampleNum));
+        stats.sampleNum       = static_cast<std::uint32_t>(num);
+        if (num == 0)
+            return stats;
+
+        stats.min = mFrameTimes[(mFrameCount - 1) % SampleNum];
+        stats.max = stats.min;
+
+        double sum = 0;
+        for (std::size_t i = 1; i <= num; ++i)
+        {
+            const double t = mFrameTimes[(mFrameCount - i) % SampleNum];
+            sum += t;
+            stats.min = std::min(stats.min, t);
+            stats.max = std::max(stats.max, t);
+        }
+        stats.average = sum / num;
+
+        double var = 0;
+        for (std::size_t i = 1; i <= num; ++i)
+        {
+            const double d = mFrameTimes[(mFrameCount - i) % SampleNum] - stats.average;
+            var += d * d;
+        }
+        stats.stddev = std::sqrt(var / num);
+
+        return stats;
+    }
+
+    void FrameLimiter::sleepUntil(const Clock::time_point& deadline)
+    {
+        // OSのsleepは粒度が粗いので, 寝過ごし量を見積もってその分手前で起きる
+        const auto wakeUp = deadline - mSpinMargin;
+        if (Clock::now() < wakeUp)
+        {
+            std::this_thread::sleep_until(wakeUp);
+
+            const auto overshoot = Clock::now() - wakeUp;
+            // 大きい方にはすぐ追従し, 小さい方にはゆっくり戻す
+            if (overshoot > mSpinMargin)
+                mSpinMargin = std::min<Clock::duration>(overshoot, std::chrono::milliseconds(MaxSpinMarginMS));
+            else
+                mSpinMargin -= (mSpinMargin - overshoot) / 16;
+        }
+
+        while (Clock::now() < deadline)
+            std::this_thread::yield();
+    }
+}  // namespace mall
@@ -0,0 +1,308 @@
+#include "../../include/Mall/Engine/GlyphAtlas.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "../../include/Mall/Engine/Graphics.hpp"
+#include "../../include/Mall/Utility/CoverageExpand.hpp"
+#include "../../include/Mall/Utility/Hash.hpp"
+
+namespace mall
+{
+    std::size_t GlyphAtlas::KeyHash::operator()(const Key& key) const
+    {
+        std::uint32_t pixelHeight = 0;
+        std::memcpy(&pixelHeight, &key.pixelHeight, sizeof(pixelHeight));
+
+        std::uint64_t hash = hashCombine(HashSeed, key.pFont);
+        hash               = hashCombine(hash, static_cast<std::uint64_t>(pixelHeight) << 32 | key.codepoint);
+        hash               = hashCombine(hash, static_cast<std::uint64_t>(key.sdf));
+
+        return static_cast<std::size_t>(hash);
+    }
+
+    std::uint32_t GlyphAtlas::packColor(const glm::vec4& color)
+    {
+        const auto lmdByte = [](const float v)
+        { return static_cast<std::uint32_t>(std::lround(std::min(std::max(v, 0.f), 1.f) * 255.f)); };
+
+        return lmdByte(color.r) | lmdByte(color.g) << 8 | lmdByte(color.b) << 16 | lmdByte(color.a) << 24;
+    }
+
+    GlyphAtlas::GlyphAtlas(Graphics& graphics)
+        : mGraphics(graphics)
+        , mGeneration(0)
+        , mSDFEnabled(true)
+    {
+    }
+
+    GlyphAtlas::~GlyphAtlas()
+    {
+        clear();
+
+        std::cerr << "Glyph atlas shut down\n";
+    }
+
+    const GlyphAtlas::Glyph& GlyphAtlas::get(const stbtt_fontinfo& font, const float pixelHeight, const std::uint32_t codepoint, const bool sdf_)
+    {
+        // 距離場は大きさによらず1つにする
+        const bool sdf = sdf_ && mSDFEnabled;
+        const Key key{ &font, sdf ? SDFPixelHeight : pixelHeight, codepoint, sdf };
+        {
+            std::shared_lock<std::shared_mutex> lock(mMutex);
+            auto&& iter = mGlyphs.find(key);
+            if (iter != mGlyphs.end())
+                return iter->second;
+        }
+
+        // 作るのは1スレッドずつ(mCoverageとページを共有するため), 待つ間に他のスレッドが作っていればそれを返す
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        {
+            auto&& iter = mGlyphs.find(key);
+            if (iter != mGlyphs.end())
+                return iter->second;
+        }
+
+        Glyph glyph{ nullptr, glm::vec4(0.f), glm::ivec2(0), glm::uvec2(0), sdf };
+
+        const float scale = stbtt_ScaleForPixelHeight(&font, key.pixelHeight);
+        int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+        if (sdf)
+        {
+            // 輪郭の周りSDFSpread分を含んだ大きさで返る
+            int width = 0, height = 0;
+            unsigned char* pSDF = stbtt_GetCodepointSDF(&font, scale, static_cast<int>(codepoint), SDFSpread, SDFOnEdge, static_cast<float>(SDFOnEdge) / SDFSpread, &width, &height, &x0, &y0);
+            if (pSDF)
+            {
+                mCoverage.assign(pSDF, pSDF + static_cast<std::size_t>(width) * height);
+                stbtt_FreeSDF(pSDF, nullptr);
+                x1 = x0 + width;
+                y1 = y0 + height;
+            }
+        }
+        else
+            stbtt_GetCodepointBitmapBox(&font, static_cast<int>(codepoint), scale, scale, &x0, &y0, &x1, &y1);
+
+        const auto w = static_cast<std::uint32_t>(std::max(x1 - x0, 0));
+        const auto h = static_cast<std::uint32_t>(std::max(y1 - y0, 0));
+        glyph.offset = glm::ivec2(x0, y0);
+        glyph.size   = glm::uvec2(w, h);
+
+        // 空白など描くものが無い文字は送りだけ使う
+        if (w == 0 || h == 0)
+            return mGlyphs.emplace(key, glyph).first->second;
+
+        if (w + Padding * 2 > PageSize || h + Padding * 2 > PageSize)
+        {
+            std::cerr << "glyph is too large for atlas page!\ncodepoint : " << codepoint << ", pixel height : " << pixelHeight << "\n";
+            assert(!"glyph is too large for atlas page!");
+            glyph.size = glm::uvec2(0);
+            return mGlyphs.emplace(key, glyph).first->second;
+        }
+
+        if (!sdf)
+        {
+            mCoverage.assign(static_cast<std::size_t>(w) * h, 0);
+            stbtt_MakeCodepointBitmap(&font, mCoverage.data(), static_cast<int>(w), static_cast<int>(h), static_cast<int>(w), scale, scale, static_cast<int>(codepoint));
+        }
+
+        std::uint32_t x = 0, y = 0;
+        Page& page = allocate(w + Padding * 2, h + Padding * 2, sdf, x, y);
+
+        // 白の被覆率をアルファにして縁を滑らかにする, 距離場は距離がそのままアルファに入る(縁はシェーダで作る)
+        // 色はどちらも頂点色としてシェーダで掛ける
+        // 周りのPadding分は透明のまま残す(ページは0で初期化してある)
+        {
+            const std::size_t pitch = static_cast<std::size_t>(PageSize) * 4;
+            for (std::uint32_t dy = 0; dy < h; ++dy)
+            {
+                std::uint8_t* pDst       = page.pixels.data() + (y + Padding + dy) * pitch + static_cast<std::size_t>(x + Padding) * 4;
+                const std::uint8_t* pSrc = mCoverage.data() + static_cast<std::size_t>(dy) * w;
+                expandCoverage(pSrc, w, WhiteColor, pDst);
+            }
+        }
+
+        page.dirty = true;
+
+        const float inv = 1.f / PageSize;
+        glyph.pTexture  = &page.texture;
+        glyph.uvRect    = glm::vec4((x + Padding) * inv, (y + Padding) * inv, (x + Padding + w) * inv, (y + Padding + h) * inv);
+
+        return mGlyphs.emplace(key, glyph).first->second;
+    }
+
+    void GlyphAtlas::getVMetrics(const stbtt_fontinfo& font, int& ascent, int& descent, int& lineGap)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(mMutex);
+            auto&& iter = mFonts.find(&font);
+            if (iter != mFonts.end())
+            {
+                ascent  = iter->second->ascent;
+                descent = iter->second->descent;
+                lineGap = iter->second->lineGap;
+                return;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        const auto& cache = getFontCache(font);
+        ascent            = cache.ascent;
+        descent           = cache.descent;
+        lineGap           = cache.lineGap;
+    }
+
+    GlyphAtlas::HMetrics GlyphAtlas::getHMetrics(const stbtt_fontinfo& font, const std::uint32_t codepoint)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(mMutex);
+            auto&& iter = mFonts.find(&font);
+            if (iter != mFonts.end())
+                if (const auto* pMetrics = iter->second->hMetrics.find(codepoint))
+                    return *pMetrics;
+        }
+
+        HMetrics metrics{ 0, 0 };
+        stbtt_GetCodepointHMetrics(&font, static_cast<int>(codepoint), &metrics.advanceWidth, &metrics.leftSideBearing);
+
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        return getFontCache(font).hMetrics.emplace(codepoint, metrics);
+    }
+
+    int GlyphAtlas::getKernAdvance(const stbtt_fontinfo& font, const std::uint32_t left, const std::uint32_t right)
+    {
+        const std::uint64_t pair = static_cast<std::uint64_t>(left) << 32 | right;
+        {
+            std::shared_lock<std::shared_mutex> lock(mMutex);
+            auto&& iter = mFonts.find(&font);
+            if (iter != mFonts.end())
+                if (const auto* pKern = iter->second->kerning.find(pair))
+                    return *pKern;
+        }
+
+        // カーニングの無い組(ほとんど)も0として覚える
+        const int kern = stbtt_GetCodepointKernAdvance(&font, static_cast<int>(left), static_cast<int>(right));
+
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        return getFontCache(font).kerning.emplace(pair, kern);
+    }
+
+    void GlyphAtlas::flush()
+    {
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+
+        for (auto& page : mPages)
+        {
+            if (!page->dirty)
+                continue;
+
+            // ページのテクスチャはここで作る(getはワーカーから呼ばれるのでGraphicsを触らない)
+            if (!page->created)
+            {
+                Cutlass::TextureInfo ti;
+                ti.setSRTex2D(PageSize, PageSize, true);
+                page->texture = mGraphics.createTexture(ti);
+                page->created = true;
+            }
+
+            mGraphics.writeTexture(page->pixels.size(), page->pixels.data(), page->texture);
+            page->dirty = false;
+        }
+    }
+
+    void GlyphAtlas::forget(const stbtt_fontinfo& font)
+    {
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        ++mGeneration;
+
+        for (auto iter = mGlyphs.begin(); iter != mGlyphs.end();)
+        {
+            if (iter->first.pFont == &font)
+                iter = mGlyphs.erase(iter);
+            else
+                ++iter;
+        }
+
+        mFonts.erase(&font);
+    }
+
+    void GlyphAtlas::clear()
+    {
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        ++mGeneration;
+
+        for (auto& page : mPages)
+            if (page->created)
+                mGraphics.destroyTexture(page->texture);
+
+        mPages.clear();
+        mGlyphs.clear();
+        mFonts.clear();
+    }
+
+    std::size_t GlyphAtlas::size() const
+    {
+        return mGlyphs.size();
+    }
+
+    std::size_t GlyphAtlas::getPageCount() const
+    {
+        return mPages.size();
+    }
+
+    std::uint64_t GlyphAtlas::getGeneration() const
+    {
+        return mGeneration;
+    }
+
+    void GlyphAtlas::setSDFEnabled(const bool enable)
+    {
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        if (mSDFEnabled == enable)
+            return;
+
+        mSDFEnabled = enable;
+        ++mGeneration;
+    }
+
+    bool GlyphAtlas::isSDFEnabled() const
+    {
+        return mSDFEnabled;
+    }
+
+    GlyphAtlas::FontCache& GlyphAtlas::getFontCache(const stbtt_fontinfo& font)
+    {
+        auto&& iter = mFonts.find(&font);
+        if (iter != mFonts.end())
+            return *iter->second;
+
+        auto cache = std::make_unique<FontCache>();
+        stbtt_GetFontVMetrics(&font, &cache->ascent, &cache->descent, &cache->lineGap);
+
+        return *mFonts.emplace(&font, std::move(cache)).first->second;
+    }
+
+    GlyphAtlas::Page& GlyphAtlas::allocate(const std::uint32_t width, const std::uint32_t height, const bool sdf, std::uint32_t& x, std::uint32_t& y)
+    {
+        for (auto& page : mPages)
+            if (page->sdf == sdf && page->packer.insert(width, height, x, y))
+                return *page;
+
+        auto page = std::make_unique<Page>();
+        page->packer.reset(PageSize, PageSize);
+        page->pixels.assign(static_cast<std::size_t>(PageSize) * PageSize * 4, 0);
+        page->dirty   = true;
+        page->created = false;
+        page->sdf     = sdf;
+
+        const bool inserted = page->packer.insert(width, height, x, y);
+        assert(inserted || !"failed to insert glyph to new page!");
+        (void)inserted;
+
+        mPages.emplace_back(std::move(page));
+        return *mPages.back();
+    }
+}  // namespace mall
@@ -14,24 +14,41 @@ namespace mall
         : mMaxWidth(0)
         , mMaxHeight(0)
         , mpContext(context)
+        , mFrameStats()
+        , mLastFrameStats()
+        , mResourceGeneration(0)
+        , mPipelined(false)
+        , mWriteIndex(0)
+        , mPacketSubmitted(false)
+        , mRenderThreadExit(false)
     {
-        mpContext->createTextureFromFile("resources/textures/texture.png", mDebugTex);
+        if (mpContext)
+            mpContext->createTextureFromFile("resources/textures/texture.png", mDebugTex);
     }
 
     Graphics::Graphics(const std::shared_ptr<Cutlass::Context>& context, const std::vector<Cutlass::WindowInfo>& windows)
         : mMaxWidth(0)
         , mMaxHeight(0)
         , mpContext(context)
+        , mFrameStats()
+        , mLastFrameStats()
+        , mResourceGeneration(0)
+        , mPipelined(false)
+        , mWriteIndex(0)
+        , mPacketSubmitted(false)
+        , mRenderThreadExit(false)
     {
         assert(windows.size() > 0 || !"no window!");
         for (const auto& window : windows)
             createWindow(window);
 
-        mpContext->createTextureFromFile("resources/textures/texture.png", mDebugTex);
+        if (mpContext)
+            mpContext->createTextureFromFile("resources/textures/texture.png", mDebugTex);
     }
 
     Graphics::~Graphics()
     {
+        setPipelined(false);
         std::cerr << "Graphics Engine shut down\n";
     }
 
@@ -43,6 +60,8 @@ namespace mall
 
     uint32_t Graphics::createWindow(const Cutlass::WindowInfo& wi)
     {
+        std::lock_guard<std::mutex> lock(mContextMutex);
+
         Window window;
 
         if (wi.width > mMaxWidth)
@@ -55,6 +74,28 @@ namespace mall
 
         window.frameCount = wi.frameCount;
 
+        if (!mpContext)
+        {  // ヘッドレス : 既定パスの並びだけ用意する
+            const std::pair<DefaultRenderPass, const char*> defaultPasses[] =
+                {
+                    {DefaultRenderPass::eGeometry, "geometry"},
+                    {DefaultRenderPass::eLighting, "lighting"},
+                    {DefaultRenderPass::eForward, "forward"},
+                    {DefaultRenderPass::eSprite, "sprite"},
+                };
+
+            for (const auto& pass : defaultPasses)
+            {
+                RenderPass rp;
+                rp.passName = std::string(pass.second);
+                window.insertRenderPass(static_cast<int>(pass.first), rp);
+            }
+
+            mWindows.emplace_back(window);
+
+            return mWindows.size() - 1;
+        }
+
         {  // window
             auto&& res = mpContext->createWindow(wi, window.window);
             assert(res == Cutlass::Result::eSuccess || !"failed to create window!");
@@ -204,9 +245,20 @@ namespace mall
         height_out   = window.height;
     }
 
+    uint32_t Graphics::getFrameCount(uint32_t windowID) const
+    {
+        assert(windowID < mWindows.size() || !"invalid window ID!");
+        return mWindows[windowID].frameCount;
+    }
+
     Cutlass::HBuffer Graphics::createBuffer(const Cutlass::BufferInfo& info)
     {
         Cutlass::HBuffer handle;
+        ++mResourceGeneration;
+        if (!mpContext)
+            return handle;
+
+        std::lock_guard<std::mutex> lock(mContextMutex);
         auto&& res = mpContext->createBuffer(info, handle);
         assert(res == Cutlass::Result::eSuccess || !"failed to create buffer!");
         return handle;
@@ -214,6 +266,18 @@ namespace mall
 
     void Graphics::destroyBuffer(const Cutlass::HBuffer& handle)
     {
+        ++mResourceGeneration;
+
+        if (!mpContext)
+            return;
+
+        if (mPipelined)
+        {
+            getWritePacket().destroyBuffers.emplace_back(handle);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mContextMutex);
         auto&& res = mpContext->destroyBuffer(handle);
         assert(res == Cutlass::Result::eSuccess || !"failed to destroy buffer!");
     }
@@ -221,6 +285,29 @@ namespace mall
     void Graphics::writeBuffer(const size_t size, const void* const pData, const Cutlass::HBuffer& handle)
     {
         assert((size > 0 && pData) || !"invalid writing to buffer memory!");
+
+        ++mFrameStats.bufferWriteCount;
+        mFrameStats.uploadedBytes += size;
+
+        if (!mpContext)
+            return;
+
+        if (mPipelined)
+        {  // 実行時まで内容を保持する
+            auto& packet = getWritePacket();
+
+            RenderPacket::Op op{};
+            op.type   = RenderPacket::OpType::eWriteBuffer;
+            op.offset = packet.data.size();
+            op.size   = size;
+            op.buffer = handle;
+
+            packet.data.insert(packet.data.end(), static_cast<const std::uint8_t*>(pData), static_cast<const std::uint8_t*>(pData) + size);
+            packet.ops.emplace_back(op);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mContextMutex);
         auto&& res = mpContext->writeBuffer(size, pData, handle);
         assert(res == Cutlass::Result::eSuccess || !"failed to write data to buffer!");
     }
@@ -229,6 +316,11 @@ namespace mall
     Cutlass::HTexture Graphics::createTexture(const Cutlass::TextureInfo& info)
     {
         Cutlass::HTexture handle;
+        ++mResourceGeneration;
+        if (!mpContext)
+            return handle;
+
+        std::lock_guard<std::mutex> lock(mContextMutex);
         auto&& res = mpContext->createTexture(info, handle);
         assert(res == Cutlass::Result::eSuccess || !"failed to create texture!");
         return handle;
@@ -236,6 +328,18 @@ namespace mall
 
     void Graphics::destroyTexture(const Cutlass::HTexture& handle)
     {
+        ++mResourceGeneration;
+
+        if (!mpContext)
+            return;
+
+        if (mPipelined)
+        {
+            getWritePacket().destroyTextures.emplace_back(handle);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mContextMutex);
         auto&& res = mpContext->destroyTexture(handle);
         assert(res == Cutlass::Result::eSuccess || !"failed to destroy texture!");
     }
@@ -244,6 +348,11 @@ namespace mall
     Cutlass::HTexture Graphics::createTextureFromFile(const char* fileName)
     {
         Cutlass::HTexture handle;
+        ++mResourceGeneration;
+        if (!mpContext)
+            return handle;
+
+        std::lock_guard<std::mutex> lock(mContextMutex);
         auto&& res = mpContext->createTextureFromFile(fileName, handle);
         assert(res == Cutlass::Result::eSuccess || !"failed to create texture from file!");
         return handle;
@@ -251,6 +360,14 @@ namespace mall
 
     void Graphics::getTextureSize(const Cutlass::HTexture& handle, uint32_t& width_out, uint32_t& height_out, uint32_t& depth_out)
     {
+        if (!mpContext)
+        {  // ヘッドレス時はサイズを持たない
+            width_out = height_out = 0;
+            depth_out = 1;
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mContextMutex);
         auto&& res = mpContext->getTextureSize(handle, width_out, height_out, depth_out);
         assert(res == Cutlass::Result::eSuccess || !"failed to get texture size!");
     }
@@ -259,6 +376,46 @@ namespace mall
     void Graphics::writeTexture(const void* const pData, const Cutlass::HTexture& handle)
     {
         assert(pData || !"invalid writing to buffer memory!");
+
+        if (!mpContext)
+        {
+            ++mFrameStats.textureWriteCount;
+            return;
+        }
+
+        // RGBA8として扱う
+        uint32_t width = 0, height = 0, depth = 0;
+        getTextureSize(handle, width, height, depth);
+
+        writeTexture(static_cast<std::size_t>(width) * height * depth * 4, pData, handle);
+    }
+
+    void Graphics::writeTexture(const size_t size, const void* const pData, const Cutlass::HTexture& handle)
+    {
+        assert((size > 0 && pData) || !"invalid writing to texture memory!");
+
+        ++mFrameStats.textureWriteCount;
+        mFrameStats.uploadedBytes += size;
+
+        if (!mpContext)
+            return;
+
+        if (mPipelined)
+        {
+            auto& packet = getWritePacket();
+
+            RenderPacket::Op op{};
+            op.type    = RenderPacket::OpType::eWriteTexture;
+            op.offset  = packet.data.size();
+            op.size    = size;
+            op.texture = handle;
+
+            packet.data.insert(packet.data.end(), static_cast<const std::uint8_t*>(pData), static_cast<const std::uint8_t*>(pData) + size);
+            packet.ops.emplace_back(op);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mContextMutex);
         auto&& res = mpContext->writeTexture(pData, handle);
         assert(res == Cutlass::Result::eSuccess || !"failed to write data to texture!");
     }
@@ -270,6 +427,11 @@ namespace mall
         assert(windowID < mWindows.size() || !"invalid window ID!");
         auto& window = mWindows[windowID];
 
+        if (!mpContext)
+            return Cutlass::HGraphicsPipeline();
+
+        std::lock_guard<std::mutex> lock(mContextMutex);
+
         auto&& iter = window.graphicsPipelines.find(gpi);
 
         if (iter != window.graphicsPipelines.end())
@@ -339,17 +501,22 @@ namespace mall
         assert(windowID < mWindows.size() || !"invalid window ID!");
         auto& window = mWindows[windowID];
 
+        std::lock_guard<std::mutex> lock(mContextMutex);
+
         RenderPass renderPass;
 
         renderPass.passName = std::string(passName);
 
-        mpContext->createRenderPass(rpi, renderPass.renderPass);
+        if (mpContext)
+        {
+            mpContext->createRenderPass(rpi, renderPass.renderPass);
 
-        Cutlass::CommandList cl;
-        cl.begin(renderPass.renderPass);
-        cl.end();
+            Cutlass::CommandList cl;
+            cl.begin(renderPass.renderPass);
+            cl.end();
 
-        mpContext->createCommandBuffer(cl, renderPass.command);
+            mpContext->createCommandBuffer(cl, renderPass.command);
+        }
 
         window.insertRenderPass(executionOrder, renderPass);
 
@@ -427,31 +594,37 @@ namespace mall
         assert(windowID < mWindows.size() || !"invalid window ID!");
         auto& window = mWindows[windowID];
 
-        Cutlass::Result res = Cutlass::Result::eSuccess;
+        ++mFrameStats.commandListCount;
+        mFrameStats.commandCount += cl.getInternalCommandData().size();
+
+        if (!mpContext)
+            return;
+
+        if (!window.renderPasses[window.findRenderPass(getExecutionOrder(passID))].second.frameCommands.empty())
+            selectCommand(windowID, getExecutionOrder(passID), NoFrameCommand);
+
         switch (passID)
         {
             case DefaultRenderPass::eGeometry:
-                res = mpContext->updateCommandBuffer(cl, window.renderPasses[window.geometryPassIndex].second.command);
+                updateCommand(cl, window.renderPasses[window.geometryPassIndex].second.command);
                 //std::cerr << "geom\n";
                 break;
             case DefaultRenderPass::eLighting:
-                res = mpContext->updateCommandBuffer(cl, window.renderPasses[window.lightingPassIndex].second.command);
+                updateCommand(cl, window.renderPasses[window.lightingPassIndex].second.command);
                 //std::cerr << "light\n";
                 break;
             case DefaultRenderPass::eForward:
-                res = mpContext->updateCommandBuffer(cl, window.renderPasses[window.forwardPassIndex].second.command);
+                updateCommand(cl, window.renderPasses[window.forwardPassIndex].second.command);
                 //std::cerr << "forward\n";
                 break;
             case DefaultRenderPass::eSprite:
-                res = mpContext->updateCommandBuffer(cl, window.renderPasses[window.spritePassIndex].second.command);
+                updateCommand(cl, window.renderPasses[window.spritePassIndex].second.command);
                 //std::cerr << "sprite\n";
                 break;
             default:
                 assert(!"invalid default render pass!");
                 break;
         }
-
-        assert(res == Cutlass::Result::eSuccess || !"failed to write command buffer!");
     }
 
     void Graphics::writeCommand(const int executionOrder, const Cutlass::CommandList& cl, const uint32_t windowID)
@@ -462,8 +635,74 @@ namespace mall
         std::size_t index = window.findRenderPass(executionOrder);
         assert(index < window.renderPasses.size() || !"the renderpass that have this execution order is not registered");
 
-        auto res = mpContext->updateCommandBuffer(cl, window.renderPasses[index].second.command);
-        assert(res == Cutlass::Result::eSuccess || !"failed to write command buffer!");
+        ++mFrameStats.commandListCount;
+        mFrameStats.commandCount += cl.getInternalCommandData().size();
+
+        if (!mpContext)
+            return;
+
+        if (!window.renderPasses[index].second.frameCommands.empty())
+            selectCommand(windowID, executionOrder, NoFrameCommand);
+
+        updateCommand(cl, window.renderPasses[index].second.command);
+    }
+
+    void Graphics::writeFrameCommand(const DefaultRenderPass passID, const Cutlass::CommandList& cl, const uint32_t frameIndex, const uint32_t windowID)
+    {
+        writeFrameCommand(getExecutionOrder(passID), cl, frameIndex, windowID);
+    }
+
+    void Graphics::writeFrameCommand(const int executionOrder, const Cutlass::CommandList& cl, const uint32_t frameIndex, const uint32_t windowID)
+    {
+        assert(windowID < mWindows.size() || !"invalid window ID!");
+        auto& window = mWindows[windowID];
+
+        std::size_t index = window.findRenderPass(executionOrder);
+        assert(index < window.renderPasses.size() || !"the renderpass that have this execution order is not registered");
+        assert(frameIndex < window.frameCount || !"invalid frame index!");
+
+        ++mFrameStats.commandListCount;
+        mFrameStats.commandCount += cl.getInternalCommandData().size();
+
+        if (!mpContext)
+            return;
+
+        auto& pass = window.renderPasses[index].second;
+        if (pass.frameCommands.empty())
+        {  // 空のコマンドで作っておき, 中身はupdateCommandで書き込む
+            std::lock_guard<std::mutex> lock(mContextMutex);
+
+            Cutlass::CommandList empty;
+            empty.begin(pass.renderPass);
+            empty.end();
+
+            pass.frameCommands.resize(window.frameCount);
+            for (auto& command : pass.frameCommands)
+            {
+                auto&& res = mpContext->createCommandBuffer(empty, command);
+                assert(res == Cutlass::Result::eSuccess || !"failed to create frame command buffer!");
+            }
+        }
+
+        updateCommand(cl, pass.frameCommands[frameIndex]);
+        selectCommand(windowID, executionOrder, frameIndex);
+    }
+
+    void Graphics::useFrameCommand(const DefaultRenderPass passID, const uint32_t frameIndex, const uint32_t windowID)
+    {
+        useFrameCommand(getExecutionOrder(passID), frameIndex, windowID);
+    }
+
+    void Graphics::useFrameCommand(const int executionOrder, const uint32_t frameIndex, const uint32_t windowID)
+    {
+        assert(windowID < mWindows.size() || !"invalid window ID!");
+        auto& window = mWindows[windowID];
+
+        if (!mpContext)
+            return;
+
+        assert(frameIndex < window.renderPasses[window.findRenderPass(executionOrder)].second.frameCommands.size() || !"the frame command is not written!");
+        selectCommand(windowID, executionOrder, frameIndex);
     }
 
 
@@ -490,6 +729,31 @@ namespace mall
     //}
 
     void Graphics::update()
+    {
+        mLastFrameStats = mFrameStats;
+        mFrameStats     = FrameStats();
+
+        if (!mpContext)
+            return;
+
+        if (mPipelined)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mPacketMutex);
+                // 描画スレッドは高々1フレーム遅れで追従する
+                mPacketCV.wait(lock, [&]() { return !mPacketSubmitted; });
+                mWriteIndex ^= 1;
+                mPacketSubmitted = true;
+            }
+            mPacketCV.notify_all();
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mContextMutex);
+        execute();
+    }
+
+    void Graphics::execute()
     {
         for (const auto& window : mWindows)
         {
@@ -509,7 +773,10 @@ namespace mall
             //    mpContext->execute(pass.second.command);
 
             for (const auto& pass : window.renderPasses)
-                mpContext->execute(pass.second.command);
+            {
+                const auto& rp = pass.second;
+                mpContext->execute(rp.frameIndex == NoFrameCommand ? rp.command : rp.frameCommands[rp.frameIndex]);
+            }
 
             //mpContext->updateCommandBuffer(window.presentCommandLists, window.presentCommandBuffer);
             mpContext->execute(window.presentCommandBuffer);
@@ -517,11 +784,189 @@ namespace mall
         }
     }
 
+    void Graphics::updateCommand(const Cutlass::CommandList& cl, const Cutlass::HCommandBuffer& command)
+    {
+        if (mPipelined)
+        {
+            auto& packet = getWritePacket();
+
+            RenderPacket::Op op{};
+            op.type    = RenderPacket::OpType::eUpdateCommand;
+            op.offset  = packet.commandLists.size();
+            op.command = command;
+
+            packet.commandLists.emplace_back(cl);
+            packet.ops.emplace_back(op);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mContextMutex);
+        auto&& res = mpContext->updateCommandBuffer(cl, command);
+        assert(res == Cutlass::Result::eSuccess || !"failed to write command buffer!");
+    }
+
+    void Graphics::selectCommand(const uint32_t windowID, const int executionOrder, const std::size_t frameIndex)
+    {
+        if (mPipelined)
+        {  // 描画スレッドが前のフレームを実行し終えてから切り替える
+            RenderPacket::Op op{};
+            op.type           = RenderPacket::OpType::eSelectCommand;
+            op.windowID       = windowID;
+            op.executionOrder = executionOrder;
+            op.frameIndex     = frameIndex;
+
+            getWritePacket().ops.emplace_back(op);
+            return;
+        }
+
+        auto& window = mWindows[windowID];
+        window.renderPasses[window.findRenderPass(executionOrder)].second.frameIndex = frameIndex;
+    }
+
+    void Graphics::setPipelined(const bool enable)
+    {
+        if (!mpContext || enable == mPipelined)
+            return;
+
+        if (enable)
+        {
+            mPacketSubmitted  = false;
+            mRenderThreadExit = false;
+            mPipelined        = true;
+            mRenderThread     = std::thread(&Graphics::renderThreadLoop, this);
+            return;
+        }
+
+        {  // 渡し済みのフレームを実行し終えてから止める
+            std::unique_lock<std::mutex> lock(mPacketMutex);
+            mPacketCV.wait(lock, [&]() { return !mPacketSubmitted; });
+            mRenderThreadExit = true;
+        }
+        mPacketCV.notify_all();
+        mRenderThread.join();
+
+        mPipelined = false;
+
+        // 記録途中の分は次のupdateで実行されるよう反映だけしておく
+        applyPacket(getWritePacket(), false);
+    }
+
+    bool Graphics::isPipelined() const
+    {
+        return mPipelined;
+    }
+
+    std::mutex& Graphics::getContextMutex()
+    {
+        return mContextMutex;
+    }
+
+    void Graphics::applyPacket(RenderPacket& packet, const bool executeFrame)
+    {
+        // ゲームスレッドのリソース作成, 転送, パスの追加と重ならないよう, 実行と表示までロックしたまま行う
+        std::lock_guard<std::mutex> lock(mContextMutex);
+
+        for (const auto& op : packet.ops)
+        {
+            Cutlass::Result res = Cutlass::Result::eSuccess;
+            switch (op.type)
+            {
+                case RenderPacket::OpType::eWriteBuffer:
+                    res = mpContext->writeBuffer(op.size, packet.data.data() + op.offset, op.buffer);
+                    break;
+                case RenderPacket::OpType::eWriteTexture:
+                    res = mpContext->writeTexture(packet.data.data() + op.offset, op.texture);
+                    break;
+                case RenderPacket::OpType::eUpdateCommand:
+                    res = mpContext->updateCommandBuffer(packet.commandLists[op.offset], op.command);
+                    break;
+                case RenderPacket::OpType::eSelectCommand:
+                {
+                    auto& window = mWindows[op.windowID];
+                    window.renderPasses[window.findRenderPass(op.executionOrder)].second.frameIndex = op.frameIndex;
+                    break;
+                }
+                default:
+                    assert(!"invalid render packet op!");
+                    break;
+            }
+
+            assert(res == Cutlass::Result::eSuccess || !"failed to apply render packet!");
+        }
+
+        if (executeFrame)
+            execute();
+
+        for (const auto& buffer : packet.destroyBuffers)
+            mpContext->destroyBuffer(buffer);
+        for (const auto& texture : packet.destroyTextures)
+            mpContext->destroyTexture(texture);
+
+        packet.clear();
+    }
+
+    void Graphics::renderThreadLoop()
+    {
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(mPacketMutex);
+            mPacketCV.wait(lock, [&]() { return mPacketSubmitted || mRenderThreadExit; });
+
+            if (!mPacketSubmitted)
+                return;
+
+            auto& packet = mPackets[mWriteIndex ^ 1];
+            lock.unlock();
+
+            // mContextMutexはapplyPacketの中で取る
+            applyPacket(packet, true);
+
+            lock.lock();
+            mPacketSubmitted = false;
+            lock.unlock();
+            mPacketCV.notify_all();
+        }
+    }
+
+    Graphics::RenderPacket& Graphics::getWritePacket()
+    {
+        return mPackets[mWriteIndex];
+    }
+
+    void Graphics::RenderPacket::clear()
+    {
+        // 容量は次のフレームのために残す
+        ops.clear();
+        data.clear();
+        commandLists.clear();
+        destroyBuffers.clear();
+        destroyTextures.clear();
+    }
+
     bool Graphics::shouldClose()
     {
+        if (!mpContext)
+            return false;
+
+        std::lock_guard<std::mutex> lock(mContextMutex);
         return mpContext->shouldClose();
     }
 
+    bool Graphics::isHeadless() const
+    {
+        return !mpContext;
+    }
+
+    std::uint64_t Graphics::getResourceGeneration() const
+    {
+        return mResourceGeneration;
+    }
+
+    const Graphics::FrameStats& Graphics::getFrameStats() const
+    {
+        return mLastFrameStats;
+    }
+
     Graphics::RenderPass& Graphics::Window::insertRenderPass(int executionOrder, const RenderPass& renderPass)
     {
         auto&& pair = std::pair<int, RenderPass>(executionOrder, renderPass);
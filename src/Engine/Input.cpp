@@ -1,14 +1,20 @@
 #include "../../include/Mall/Engine/Input.hpp"
 
 #include <Cutlass/Event.hpp>
+#include <GLFW/glfw3.h>
 
+#include <cmath>
 #include <iostream>
 
 namespace mall
 {
     Input::Input(const std::shared_ptr<Cutlass::Context>& context)
         : mpContext(context)
+        , mPrevCursorX(0)
+        , mPrevCursorY(0)
+        , mActivity(false)
     {
+        mPrevKeys.fill(false);
     }
 
     Input::~Input()
@@ -19,18 +25,84 @@ namespace mall
     bool Input::getKey(const Cutlass::Key key) const
     {
         // return !!mKeys[static_cast<size_t>(key)];
+        if (!mpContext)
+            return false;
+
         return mpContext->getKey(key);
     }
 
     void Input::getCursorPos(double& x, double& y) const
     {
+        if (!mpContext)
+        {
+            x = y = 0;
+            return;
+        }
+
         mpContext->getMousePos(x, y);
     }
 
+    bool Input::hasActivity() const
+    {
+        return mActivity;
+    }
+
     void Input::update()
     {
-        mpContext->updateInput();
+        if (!mpContext)
+            return;
+
+        // イベントの取り出しはゲームスレッドからGLFWに直接行う
+        // Contextを経由しないので, 描画スレッドが使うmutex(Graphics::getContextMutex)を待たない
+        glfwPollEvents();
         // for (const auto key : Cutlass::keyMap)
         //     mKeys[static_cast<uint32_t>(key)] += static_cast<uint32_t>(mpContext->getKey(key));
+
+        mActivity = false;
+
+        for (const auto key : Cutlass::keyMap)
+        {
+            const auto index   = static_cast<std::size_t>(key);
+            const bool pressed = mpContext->getKey(key);
+            // 押されている間と離した瞬間
+            mActivity |= pressed || mPrevKeys[index];
+            mPrevKeys[index] = pressed;
+        }
+
+        {
+            double x = 0, y = 0;
+            mpContext->getMousePos(x, y);
+            mActivity |= x != mPrevCursorX || y != mPrevCursorY;
+            mPrevCursorX = x;
+            mPrevCursorY = y;
+        }
+
+        // ゲームパッドはウィンドウに依らないのでGLFWから直接読む
+        mActivity |= pollGamepadActivity();
+    }
+
+    bool Input::pollGamepadActivity() const
+    {
+        for (int jid = GLFW_JOYSTICK_1; jid <= GLFW_JOYSTICK_LAST; ++jid)
+        {
+            GLFWgamepadstate state;
+            if (!glfwJoystickIsGamepad(jid) || !glfwGetGamepadState(jid, &state))
+                continue;
+
+            for (const auto button : state.buttons)
+                if (button == GLFW_PRESS)
+                    return true;
+
+            // スティックは0, トリガーは-1が離した状態
+            for (int axis = 0; axis <= GLFW_GAMEPAD_AXIS_LAST; ++axis)
+            {
+                const bool trigger = axis == GLFW_GAMEPAD_AXIS_LEFT_TRIGGER || axis == GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER;
+                const float value  = trigger ? state.axes[axis] + 1.f : std::abs(state.axes[axis]);
+                if (value > GamepadDeadZone)
+                    return true;
+            }
+        }
+
+        return false;
     }
-}  // namespace mall
\ No newline at end of file
+}  // namespace mall
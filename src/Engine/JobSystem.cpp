@@ -0,0 +1,160 @@
+#include "../../include/Mall/Engine/JobSystem.hpp"
+
+#include <cassert>
+#include <iostream>
+
+namespace mall
+{
+    namespace
+    {
+        // ワーカースレッドが自分の所属とキューを引くため
+        thread_local const JobSystem* tpOwner   = nullptr;
+        thread_local std::uint32_t tWorkerIndex = 0;
+    }  // namespace
+
+    JobSystem::JobSystem(const std::uint32_t workerNum)
+        : mRunning(true)
+        , mPendingNum(0)
+    {
+        std::uint32_t num = workerNum;
+        if (num == 0)
+        {
+            const std::uint32_t hardwareNum = std::thread::hardware_concurrency();
+            num                             = hardwareNum > 1 ? hardwareNum - 1 : 0;
+        }
+
+        for (std::uint32_t i = 0; i < num + 1; ++i)
+            mQueues.emplace_back(std::make_unique<Queue>());
+
+        mWorkers.reserve(num);
+        for (std::uint32_t i = 0; i < num; ++i)
+            mWorkers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            mRunning.store(false, std::memory_order_release);
+        }
+        mSleepCV.notify_all();
+
+        for (auto& worker : mWorkers)
+            worker.join();
+
+        std::cerr << "Job system shut down\n";
+    }
+
+    void JobSystem::submit(Job&& job, Counter& counter)
+    {
+        assert(job);
+
+        counter.mCount.fetch_add(1, std::memory_order_relaxed);
+
+        {
+            auto& queue = *mQueues[getQueueIndex()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.emplace_back(Task{std::move(job), &counter});
+        }
+
+        mPendingNum.fetch_add(1, std::memory_order_release);
+
+        // 待機判定との競合で起こし損ねないよう, 一度ロックを通す
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+        }
+        mSleepCV.notify_one();
+    }
+
+    void JobSystem::wait(const Counter& counter)
+    {
+        const std::uint32_t index = getQueueIndex();
+
+        while (!counter.done())
+            if (!tryRun(index))
+                std::this_thread::yield();
+    }
+
+    std::uint32_t JobSystem::getThreadNum() const
+    {
+        return static_cast<std::uint32_t>(mWorkers.size()) + 1;
+    }
+
+    void JobSystem::workerLoop(const std::uint32_t index)
+    {
+        tpOwner      = this;
+        tWorkerIndex = index;
+
+        while (true)
+        {
+            if (tryRun(index))
+                continue;
+
+            std::unique_lock<std::mutex> lock(mSleepMutex);
+            mSleepCV.wait(lock, [&]() { return !mRunning.load(std::memory_order_acquire) || mPendingNum.load(std::memory_order_acquire) > 0; });
+
+            if (!mRunning.load(std::memory_order_acquire))
+                return;
+        }
+    }
+
+    bool JobSystem::tryRun(const std::uint32_t index)
+    {
+        Task task;
+        if (!tryPop(index, task) && !trySteal(index, task))
+            return false;
+
+        mPendingNum.fetch_sub(1, std::memory_order_relaxed);
+
+        task.job();
+
+        task.pCounter->mCount.fetch_sub(1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool JobSystem::tryPop(const std::uint32_t index, Task& task_out)
+    {
+        auto& queue = *mQueues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tasks.empty())
+            return false;
+
+        // 自分のキューは新しいものから(キャッシュに残っている可能性が高い)
+        task_out = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+
+        return true;
+    }
+
+    bool JobSystem::trySteal(const std::uint32_t index, Task& task_out)
+    {
+        const std::size_t queueNum = mQueues.size();
+
+        for (std::size_t i = 1; i < queueNum; ++i)
+        {
+            auto& queue = *mQueues[(index + i) % queueNum];
+            std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+
+            if (!lock.owns_lock() || queue.tasks.empty())
+                continue;
+
+            // 他のキューからは古いものから盗む
+            task_out = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+
+            return true;
+        }
+
+        return false;
+    }
+
+    std::uint32_t JobSystem::getQueueIndex() const
+    {
+        if (tpOwner == this)
+            return tWorkerIndex;
+
+        return static_cast<std::uint32_t>(mWorkers.size());
+    }
+}  // namespace mall
@@ -105,9 +105,9 @@ namespace mall
         }
     }
 
-    void Physics::update(const float deltaTime)
+    void Physics::update(const float deltaTime, const int maxSubSteps, const float fixedTimeStep)
     {
-        mDynamicsWorld->stepSimulation(deltaTime, 10);
+        mDynamicsWorld->stepSimulation(deltaTime, maxSubSteps, fixedTimeStep);
     }
 
 }  // namespace mall
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "../../include/Mall/Engine/Profiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace mall
+{
+    Profiler::ScopedTimer::ScopedTimer(Profiler& profiler, const char* name)
+        : mProfiler(profiler)
+        , mName(name)
+        , mBegin(profiler.now())
+    {
+    }
+
+    Profiler::ScopedTimer::ScopedTimer(const std::unique_ptr<Profiler>& profiler, const char* name)
+        : ScopedTimer(*profiler, name)
+    {
+    }
+
+    Profiler::ScopedTimer::~ScopedTimer()
+    {
+        mProfiler.record(mName, mBegin, mProfiler.now());
+    }
+
+    Profiler::Profiler()
+        : mFrames(new Frame[MaxFrameNum])
+        , mFrameCount(0)
+        , mOrigin(std::chrono::steady_clock::now())
+    {
+        for (std::size_t i = 0; i < MaxFrameNum; ++i)
+        {
+            mFrames[i].frame = 0;
+            mFrames[i].eventCount.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    Profiler::~Profiler()
+    {
+        std::cerr << "Profiler shut down\n";
+    }
+
+    void Profiler::beginFrame(const std::uint32_t frame)
+    {
+        const std::uint64_t next = mFrameCount.load(std::memory_order_relaxed) + 1;
+
+        auto& target = mFrames[next % MaxFrameNum];
+        target.frame = frame;
+        target.eventCount.store(0, std::memory_order_relaxed);
+
+        mFrameCount.store(next, std::memory_order_release);
+    }
+
+    void Profiler::record(const char* name, const std::uint64_t begin, const std::uint64_t end)
+    {
+        auto& target = mFrames[mFrameCount.load(std::memory_order_acquire) % MaxFrameNum];
+
+        const std::uint32_t index = target.eventCount.fetch_add(1, std::memory_order_relaxed);
+        if (index >= MaxEventNumPerFrame)
+            return;
+
+        auto& event    = target.events[index];
+        event.name     = name;
+        event.begin    = begin;
+        event.end      = end;
+        event.threadID = getThreadID();
+    }
+
+    std::uint64_t Profiler::now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mOrigin).count();
+    }
+
+    double Profiler::getAverageTime(std::string_view name, std::size_t frameNum) const
+    {
+        const std::uint64_t frameCount = mFrameCount.load(std::memory_order_acquire);
+
+        // 記録中のフレームは含めない
+        frameNum = std::min({frameNum, MaxFrameNum - 1, static_cast<std::size_t>(frameCount)});
+        if (frameNum == 0)
+            return 0;
+
+        std::uint64_t sum = 0;
+        for (std::size_t i = 1; i <= frameNum; ++i)
+        {
+            const auto& frame         = mFrames[(frameCount - i) % MaxFrameNum];
+            const std::uint32_t count = std::min<std::uint32_t>(frame.eventCount.load(std::memory_order_relaxed), MaxEventNumPerFrame);
+            for (std::uint32_t j = 0; j < count; ++j)
+                if (name == frame.events[j].name)
+                    sum += frame.events[j].end - frame.events[j].begin;
+        }
+
+        return sum / 1000000. / frameNum;
+    }
+
+    bool Profiler::writeChromeTrace(std::string_view path) const
+    {
+        std::ofstream ofs(std::string(path), std::ios::out | std::ios::trunc);
+        if (!ofs)
+        {
+            std::cerr << "failed to open trace file!\npath : " << path << "\n";
+            return false;
+        }
+
+        const std::uint64_t frameCount = mFrameCount.load(std::memory_order_acquire);
+        const std::size_t frameNum     = std::min(static_cast<std::size_t>(frameCount) + 1, MaxFrameNum);
+
+        ofs << std::fixed << std::setprecision(3);
+        ofs << "{\"traceEvents\":[";
+
+        bool first = true;
+        // 古いフレームから順に書き出す
+        for (std::size_t i = frameNum; i > 0; --i)
+        {
+            const auto& frame         = mFrames[(frameCount + 1 - i) % MaxFrameNum];
+            const std::uint32_t count = std::min<std::uint32_t>(frame.eventCount.load(std::memory_order_relaxed), MaxEventNumPerFrame);
+            for (std::uint32_t j = 0; j < count; ++j)
+            {
+                const auto& event = frame.events[j];
+
+                if (!first)
+                    ofs << ",";
+                first = false;
+
+                ofs << "\n{\"name\":\"";
+                for (const char* c = event.name; *c; ++c)
+                {
+                    if (*c == '"' || *c == '\\')
+                        ofs << '\\';
+                    ofs << *c;
+                }
+                ofs << "\",\"cat\":\"mall\",\"ph\":\"X\""
+                    << ",\"ts\":" << event.begin / 1000.
+                    << ",\"dur\":" << (event.end - event.begin) / 1000.
+                    << ",\"pid\":0,\"tid\":" << event.threadID
+                    << ",\"args\":{\"frame\":" << frame.frame << "}}";
+            }
+        }
+
+        ofs << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        return static_cast<bool>(ofs);
+    }
+
+    std::uint32_t Profiler::getThreadID()
+    {
+        static std::atomic<std::uint32_t> nextID(0);
+        thread_local std::uint32_t threadID = nextID.fetch_add(1, std::memory_order_relaxed);
+        return threadID;
+    }
+}  // namespace mall
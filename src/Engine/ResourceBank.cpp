@@ -1,10 +1,16 @@
 #include "../../include/Mall/Engine/ResourceBank.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <limits>
 #include <regex>
 
+#include "../../include/Mall/Engine/Graphics.hpp"
+
 #define STBI_WRITE_NO_STDIO
 #define STBI_MSC_SECURE_CRT
 
@@ -12,6 +18,10 @@
 #include <stb/stb_truetype.h>
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb/stb_image_write.h>
+// テクスチャアトラス用, Cutlass側の実装と衝突しないよう内部リンケージにする
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
 
 namespace mall
 {
@@ -56,6 +66,12 @@ namespace mall
 
     ResourceBank::ResourceBank(const std::shared_ptr<Cutlass::Context>& context)
         : mpContext(context)
+        , mpContextMutex(nullptr)
+        , mpGraphics(nullptr)
+        , mpSceneBVH(nullptr)
+        , mpSpriteBVH(nullptr)
+        , mpGlyphAtlas(nullptr)
+        , mGeneration(0)
     {
     }
 
@@ -68,6 +84,9 @@ namespace mall
 
     bool ResourceBank::create(std::string_view path, MeshData& meshData, MaterialData& materialData, const glm::mat4& defaultAxis)
     {
+        ++mGeneration;
+        auto&& lock = lockContext();
+
         auto&& strPath = std::string(path);
         auto&& iter    = mModelCacheMap.find(strPath);
 
@@ -90,6 +109,9 @@ namespace mall
 
             for (auto& mesh : model.meshes)
             {
+                if (!mpContext)  // ヘッドレス
+                    break;
+
                 Cutlass::BufferInfo bi;
                 bi.setVertexBuffer<MeshData::Vertex>(mesh.vertices.size());
                 mpContext->createBuffer(bi, mesh.VB);
@@ -106,28 +128,33 @@ namespace mall
             auto& model = iter->second;
 
             meshData.meshes.create(model.meshes.data(), model.meshes.size());
-            meshData.loaded      = true;
-            meshData.defaultAxis = defaultAxis;
+            meshData.loaded         = true;
+            meshData.defaultAxis    = defaultAxis;
+            meshData.bvhProxy       = SceneBVH::InvalidID;
+            meshData.bvhUserData    = 0;
+            meshData.prevWorldSteps = 0;
 
             materialData.textures.create(model.material.textures.data(), model.material.textures.size());
         }
 
-        {
-            Cutlass::BufferInfo bi;
-            bi.setUniformBuffer<MeshData::RenderingInfo::SceneCBParam>();
-            mpContext->createBuffer(bi, meshData.renderingInfo.sceneCB);
-        }
-
         return true;
     }
 
     void ResourceBank::destroy(MeshData& meshData, MaterialData& materialData)
     {
-        mpContext->destroyBuffer(meshData.renderingInfo.sceneCB);
+        ++mGeneration;
+        // 描画用の定数はRenderSystemがフレームごとに確保するので, エンティティ単位で解放するのはBVHのプロキシのみ
+        // モデル自体はキャッシュとしてclearCacheで解放する
+        if (mpSceneBVH && meshData.bvhProxy != SceneBVH::InvalidID)
+            mpSceneBVH->destroyProxy(meshData.bvhProxy);
+        meshData.bvhProxy = SceneBVH::InvalidID;
     }
 
     bool ResourceBank::create(std::string_view path, SkeletalMeshData& skeletalMeshData, MaterialData& materialData, const glm::mat4& defaultAxis)
     {
+        ++mGeneration;
+        auto&& lock = lockContext();
+
         auto&& strPath = std::string(path);
         auto&& iter    = mSkeletalModelCacheMap.find(strPath);
         if (iter == mSkeletalModelCacheMap.end())
@@ -150,6 +177,9 @@ namespace mall
 
             for (auto& mesh : model.meshes)
             {
+                if (!mpContext)  // ヘッドレス
+                    break;
+
                 Cutlass::BufferInfo bi;
                 bi.setVertexBuffer<MeshData::Vertex>(mesh.vertices.size());
                 mpContext->createBuffer(bi, mesh.VB);
@@ -169,8 +199,11 @@ namespace mall
             auto& model = iter->second;
 
             skeletalMeshData.meshes.create(model.meshes.data(), model.meshes.size());
-            skeletalMeshData.loaded      = true;
-            skeletalMeshData.defaultAxis = defaultAxis;
+            skeletalMeshData.loaded         = true;
+            skeletalMeshData.defaultAxis    = defaultAxis;
+            skeletalMeshData.bvhProxy       = SceneBVH::InvalidID;
+            skeletalMeshData.bvhUserData    = 0;
+            skeletalMeshData.prevWorldSteps = 0;
             skeletalMeshData.skeleton.create(&model.skeleton.value());
             skeletalMeshData.skeleton.get().scene.create(model.pScene.value());
             skeletalMeshData.skeleton.get().globalInverse = glm::mat4(1.f);
@@ -186,22 +219,16 @@ namespace mall
             }
         }
 
-        {
-            Cutlass::BufferInfo bi;
-            bi.setUniformBuffer<SkeletalMeshData::RenderingInfo::SceneCBParam>();
-            mpContext->createBuffer(bi, skeletalMeshData.renderingInfo.sceneCB);
-
-            bi.setUniformBuffer<SkeletalMeshData::RenderingInfo::BoneCBParam>();
-            mpContext->createBuffer(bi, skeletalMeshData.renderingInfo.boneCB);
-        }
-
         return true;
     }
 
     void ResourceBank::destroy(SkeletalMeshData& skeletalMeshData, MaterialData& material)
     {
-        mpContext->destroyBuffer(skeletalMeshData.renderingInfo.sceneCB);
-        mpContext->destroyBuffer(skeletalMeshData.renderingInfo.boneCB);
+        ++mGeneration;
+        // MeshDataと同じく, エンティティ単位で解放するのはBVHのプロキシのみ
+        if (mpSceneBVH && skeletalMeshData.bvhProxy != SceneBVH::InvalidID)
+            mpSceneBVH->destroyProxy(skeletalMeshData.bvhProxy);
+        skeletalMeshData.bvhProxy = SceneBVH::InvalidID;
     }
 
     bool ResourceBank::create(const std::initializer_list<std::string_view>& paths, std::string_view name, SpriteData& sprite)
@@ -216,68 +243,99 @@ namespace mall
 
     bool ResourceBank::create(const std::vector<std::string_view>& paths, std::string_view name, SpriteData& spriteData)
     {
+        ++mGeneration;
+        auto&& lock = lockContext();
+
         auto&& strName = std::string(name);
         auto&& iter    = mSpriteCacheMap.find(strName);
         if (iter == mSpriteCacheMap.end())
         {
-            iter = mSpriteCacheMap.emplace(strName, Sprite()).first;
-            iter->second.textures.reserve(paths.size());
+            iter         = mSpriteCacheMap.emplace(strName, Sprite()).first;
+            auto& sprite = iter->second;
+            sprite.textures.reserve(paths.size());
+            sprite.sizes.reserve(paths.size());
+            sprite.uvRects.reserve(paths.size());
+            sprite.textureKeys.reserve(paths.size());
+            sprite.atlased.reserve(paths.size());
 
             for (auto& path : paths)
             {
+                // 読み込んだ順にアトラスへ詰めていく, 同じページのフレームは描画をまとめられる
+                AtlasRegion region;
+                if (mpContext && insertAtlas(path, region))
+                {
+                    sprite.textures.emplace_back(region.pPage->texture);
+                    sprite.sizes.emplace_back(region.size);
+                    sprite.uvRects.emplace_back(region.uvRect);
+                    sprite.textureKeys.emplace_back(&region.pPage->texture);
+                    sprite.atlased.emplace_back(1);
+                    continue;
+                }
+
                 auto&& texIter = mTextureCacheMap.find(std::string(path));
                 if (texIter == mTextureCacheMap.end())
                 {
                     Cutlass::HTexture texture;
-                    auto res = mpContext->createTextureFromFile(path.data(), texture);
+                    auto res = mpContext ? mpContext->createTextureFromFile(path.data(), texture) : Cutlass::Result::eSuccess;
                     if (res != Cutlass::Result::eSuccess)
                     {
                         std::cerr << "failed to load texture!\npath : " << path << "\n";
                         assert(!"failed to load texture!");
+                        flushAtlas();
+                        mSpriteCacheMap.erase(iter);
                         return false;
                     }
 
                     texIter = mTextureCacheMap.emplace(path, texture).first;
                 }
 
-                iter->second.textures.emplace_back(texIter->second);
+                sprite.textures.emplace_back(texIter->second);
+
+                // 描画のたびに問い合わせないよう読み込み時に取得しておく(ヘッドレス時は0)
+                glm::uvec2 size(0);
+                std::uint32_t depth = 1;
+                if (mpContext)
+                    mpContext->getTextureSize(texIter->second, size.x, size.y, depth);
+                assert(depth == 1);
+                sprite.sizes.emplace_back(size);
+                sprite.uvRects.emplace_back(0.f, 0.f, 1.f, 1.f);
+                // mapの要素のアドレスは変わらないので, 同じファイルなら同じ値になる
+                sprite.textureKeys.emplace_back(&texIter->second);
+                sprite.atlased.emplace_back(0);
             }
-        }
-
-        spriteData.textures.create(iter->second.textures.data(), iter->second.textures.size());
-        spriteData.index = 0;
 
-        {
-            Cutlass::BufferInfo bi;
-            bi.setVertexBuffer<SpriteData::RenderingInfo::Vertex>(4);
-            mpContext->createBuffer(bi, spriteData.renderingInfo.spriteVB);
+            flushAtlas();
         }
 
-        return true;
+        return getSprite(name, spriteData);
     }
 
     bool ResourceBank::getSprite(std::string_view name, SpriteData& spriteData)
     {
+        ++mGeneration;
         auto&& strName = std::string(name);
         auto&& iter    = mSpriteCacheMap.find(strName);
         if (iter == mSpriteCacheMap.end())
             return false;
 
-        spriteData.textures.create(iter->second.textures.data(), iter->second.textures.size());
-        spriteData.index = 0;
-
-        {
-            Cutlass::BufferInfo bi;
-            bi.setVertexBuffer<SpriteData::RenderingInfo::Vertex>(4);
-            mpContext->createBuffer(bi, spriteData.renderingInfo.spriteVB);
-        }
+        auto& sprite = iter->second;
+        spriteData.textures.create(sprite.textures.data(), sprite.textures.size());
+        spriteData.sizes.create(sprite.sizes.data(), sprite.sizes.size());
+        spriteData.uvRects.create(sprite.uvRects.data(), sprite.uvRects.size());
+        spriteData.textureKeys.create(sprite.textureKeys.data(), sprite.textureKeys.size());
+        spriteData.index       = 0;
+        spriteData.bvhProxy    = SceneBVH::InvalidID;
+        spriteData.bvhUserData = 0;
 
         return true;
     }
 
     void ResourceBank::destroy(SpriteData& spriteData)
     {
-        mpContext->destroyBuffer(spriteData.renderingInfo.spriteVB);
+        ++mGeneration;
+        if (mpSpriteBVH && spriteData.bvhProxy != SceneBVH::InvalidID)
+            mpSpriteBVH->destroyProxy(spriteData.bvhProxy);
+        spriteData.bvhProxy = SceneBVH::InvalidID;
     }
 
     bool ResourceBank::create(std::string_view path, SoundData& soundData)
@@ -497,6 +555,9 @@ namespace mall
 
     bool ResourceBank::create(std::string_view path, TextData& text)
     {
+        ++mGeneration;
+        auto&& lock = lockContext();
+
         auto&& strPath = std::string(path);
         auto&& iter    = mFontCacheMap.find(strPath);
 
@@ -536,42 +597,120 @@ namespace mall
 
         text.fontInfo.create(&iter->second.fontInfo);
         text.fontBuffer.create(&iter->second.fontBuffer);
-
-        Cutlass::TextureInfo ti;
-        ti.setSRTex2D(1, 1, true);
-        mpContext->createTexture(ti, text.texture);
-
+        // 文字の矩形はTextSystemが組み立てる, グリフのテクスチャはEngine::glyphAtlasが持つ
+        std::uint32_t slotID = 0;
+        if (mFreeTextSlots.empty())
         {
-            Cutlass::BufferInfo bi;
-            bi.setVertexBuffer<TextData::RenderingInfo::Vertex>(4);
-            mpContext->createBuffer(bi, text.renderingInfo.spriteVB);
+            slotID = static_cast<std::uint32_t>(mTextSlots.size());
+            mTextSlots.emplace_back();
+            mTextSlots.back().storage = std::make_unique<TextData::Storage>();
         }
+        else
+        {
+            slotID = mFreeTextSlots.back();
+            mFreeTextSlots.pop_back();
+        }
+
+        // 最初にmarkされるまではsweepしない
+        auto& slot  = mTextSlots[slotID];
+        slot.owner  = nullptr;
+        slot.marked = false;
+        slot.alive  = true;
+        text.storage.create(slot.storage.get());
+        text.storageID = slotID;
+        text.pixelHeight = TextData::DefaultPixelHeight;
+        text.sdfFlag     = false;
+        text.wrapFlag    = true;
 
         return true;
     }
 
     void ResourceBank::destroy(TextData& text)
     {
-        mpContext->destroyBuffer(text.renderingInfo.spriteVB);
+        ++mGeneration;
+
+        assert(text.storage.isCreated() || !"text was not created or already destroyed!");
+        if (!text.storage.isCreated())
+            return;
+
+        // コピー元が先にdestroyしていた場合などは, 他のテキストのスロットを解放しないようにする
+        const bool owned = text.storageID < mTextSlots.size() && mTextSlots[text.storageID].alive &&
+                           mTextSlots[text.storageID].storage.get() == text.storage.data();
+        assert(owned || !"text storage was already released!");
+        if (owned)
+            releaseTextSlot(text.storageID);
+
+        text.storage.reset();
+    }
+
+    void ResourceBank::markText(const TextData& text, const void* owner)
+    {
+        if (!text.storage.isCreated() || text.storageID >= mTextSlots.size())
+            return;
+
+        auto& slot = mTextSlots[text.storageID];
+        if (slot.storage.get() != &text.storage.get())
+            return;
+
+        slot.owner  = owner;
+        slot.marked = true;
+    }
+
+    std::size_t ResourceBank::sweepTexts(const void* owner)
+    {
+        std::size_t swept = 0;
+        for (std::uint32_t i = 0; i < static_cast<std::uint32_t>(mTextSlots.size()); ++i)
+        {
+            auto& slot = mTextSlots[i];
+            if (!slot.alive || slot.owner == nullptr || slot.owner != owner)
+                continue;
+
+            if (slot.marked)
+            {
+                slot.marked = false;
+                continue;
+            }
+
+            releaseTextSlot(i);
+            ++swept;
+        }
+
+        if (swept > 0)
+            ++mGeneration;
+
+        return swept;
+    }
+
+    void ResourceBank::releaseTextSlot(std::uint32_t slotID)
+    {
+        auto& slot = mTextSlots[slotID];
+        // 長い文字列の領域を持ち続けないよう, 中身ごと作り直す
+        *slot.storage = TextData::Storage();
+        slot.owner    = nullptr;
+        slot.marked   = false;
+        slot.alive    = false;
+        mFreeTextSlots.emplace_back(slotID);
     }
 
     void ResourceBank::clearCache(std::string_view pathOrName)
     {
+        ++mGeneration;
+
         {
             auto&& iter = mModelCacheMap.find(pathOrName.data());
             if (iter != mModelCacheMap.end())
             {
                 for (auto& m : iter->second.meshes)
                 {
-                    mpContext->destroyBuffer(m.VB);
-                    mpContext->destroyBuffer(m.IB);
+                    destroyBuffer(m.VB);
+                    destroyBuffer(m.IB);
                 }
 
                 iter->second.pScene.reset();
 
                 for (auto& t : iter->second.material.textures)
                 {
-                    mpContext->destroyTexture(t.handle);
+                    destroyTexture(t.handle);
                 }
 
                 mModelCacheMap.erase(iter);
@@ -586,8 +725,8 @@ namespace mall
             {
                 for (auto& m : iter->second.meshes)
                 {
-                    mpContext->destroyBuffer(m.VB);
-                    mpContext->destroyBuffer(m.IB);
+                    destroyBuffer(m.VB);
+                    destroyBuffer(m.IB);
                 }
 
                 iter->second.skeleton.reset();  // explicit
@@ -595,7 +734,7 @@ namespace mall
 
                 for (auto& t : iter->second.material.textures)
                 {
-                    mpContext->destroyTexture(t.handle);
+                    destroyTexture(t.handle);
                 }
 
                 mSkeletalModelCacheMap.erase(iter);
@@ -608,9 +747,11 @@ namespace mall
             auto&& iter = mSpriteCacheMap.find(pathOrName.data());
             if (iter != mSpriteCacheMap.end())
             {
-                for (auto& t : iter->second.textures)
+                // アトラスの領域は個別に空けられないので, ページはclearCacheAllで解放する
+                for (std::size_t i = 0; i < iter->second.textures.size(); ++i)
                 {
-                    mpContext->destroyTexture(t);
+                    if (!iter->second.atlased[i])
+                        destroyTexture(iter->second.textures[i]);
                 }
 
                 mSpriteCacheMap.erase(iter);
@@ -631,30 +772,35 @@ namespace mall
 
         {
             auto&& iter = mFontCacheMap.find(pathOrName.data());
-            delete[] iter->second.fontBuffer;
-
             if (iter != mFontCacheMap.end())
+            {
+                delete[] iter->second.fontBuffer;
+                if (mpGlyphAtlas)
+                    mpGlyphAtlas->forget(iter->second.fontInfo);
                 mFontCacheMap.erase(iter);
+            }
             return;
         }
     }
 
     void ResourceBank::clearCacheAll()
     {
+        ++mGeneration;
+
         {
             for (auto& p : mModelCacheMap)
             {
                 for (auto& m : p.second.meshes)
                 {
-                    mpContext->destroyBuffer(m.VB);
-                    mpContext->destroyBuffer(m.IB);
+                    destroyBuffer(m.VB);
+                    destroyBuffer(m.IB);
                 }
 
                 p.second.pScene.reset();
 
                 for (auto& t : p.second.material.textures)
                 {
-                    mpContext->destroyTexture(t.handle);
+                    destroyTexture(t.handle);
                 }
             }
 
@@ -666,8 +812,8 @@ namespace mall
             {
                 for (auto& m : p.second.meshes)
                 {
-                    mpContext->destroyBuffer(m.VB);
-                    mpContext->destroyBuffer(m.IB);
+                    destroyBuffer(m.VB);
+                    destroyBuffer(m.IB);
                 }
 
                 p.second.skeleton.reset();  // explicit
@@ -675,7 +821,7 @@ namespace mall
 
                 for (auto& t : p.second.material.textures)
                 {
-                    mpContext->destroyTexture(t.handle);
+                    destroyTexture(t.handle);
                 }
             }
 
@@ -685,13 +831,20 @@ namespace mall
         {
             for (auto& p : mSpriteCacheMap)
             {
-                for (auto& t : p.second.textures)
+                for (std::size_t i = 0; i < p.second.textures.size(); ++i)
                 {
-                    mpContext->destroyTexture(t);
+                    if (!p.second.atlased[i])
+                        destroyTexture(p.second.textures[i]);
                 }
             }
 
             mSpriteCacheMap.clear();
+
+            for (auto& page : mAtlasPages)
+                destroyTexture(page->texture);
+
+            mAtlasPages.clear();
+            mAtlasRegionMap.clear();
         }
 
         {
@@ -705,12 +858,193 @@ namespace mall
 
         {
             for (auto& p : mFontCacheMap)
+            {
+                if (mpGlyphAtlas)
+                    mpGlyphAtlas->forget(p.second.fontInfo);
                 delete[] p.second.fontBuffer;
+            }
 
             mFontCacheMap.clear();
         }
     }
 
+    void ResourceBank::setContextMutex(std::mutex* pMutex)
+    {
+        mpContextMutex = pMutex;
+    }
+
+    void ResourceBank::setGraphics(Graphics* pGraphics)
+    {
+        mpGraphics = pGraphics;
+    }
+
+    std::uint64_t ResourceBank::getGeneration() const
+    {
+        return mGeneration;
+    }
+
+    void ResourceBank::setSceneBVH(SceneBVH* pSceneBVH)
+    {
+        mpSceneBVH = pSceneBVH;
+    }
+
+    void ResourceBank::setSpriteBVH(SceneBVH* pSpriteBVH)
+    {
+        mpSpriteBVH = pSpriteBVH;
+    }
+
+    void ResourceBank::setGlyphAtlas(GlyphAtlas* pGlyphAtlas)
+    {
+        mpGlyphAtlas = pGlyphAtlas;
+    }
+
+    std::size_t ResourceBank::getAtlasPageCount() const
+    {
+        return mAtlasPages.size();
+    }
+
+    bool ResourceBank::insertAtlas(std::string_view path, AtlasRegion& region_out)
+    {
+        auto&& strPath = std::string(path);
+        auto&& iter    = mAtlasRegionMap.find(strPath);
+        if (iter != mAtlasRegionMap.end())
+        {
+            region_out = iter->second;
+            return true;
+        }
+
+        int width = 0, height = 0, channels = 0;
+        stbi_uc* pImage = stbi_load(strPath.c_str(), &width, &height, &channels, 4);
+        if (!pImage)
+            return false;
+
+        constexpr std::uint32_t Padding = AtlasPadding;
+        const auto w                    = static_cast<std::uint32_t>(width);
+        const auto h                    = static_cast<std::uint32_t>(height);
+        if (w + Padding * 2 > AtlasPageSize || h + Padding * 2 > AtlasPageSize)
+        {
+            stbi_image_free(pImage);
+            return false;
+        }
+
+        // 既存のページに入らなければページを足す
+        AtlasPage* pPage = nullptr;
+        std::uint32_t x = 0, y = 0;
+        for (auto& page : mAtlasPages)
+        {
+            if (page->packer.insert(w + Padding * 2, h + Padding * 2, x, y))
+            {
+                pPage = page.get();
+                break;
+            }
+        }
+
+        if (!pPage)
+        {
+            auto page = std::make_unique<AtlasPage>();
+            page->packer.reset(AtlasPageSize, AtlasPageSize);
+            page->pixels.assign(static_cast<std::size_t>(AtlasPageSize) * AtlasPageSize * 4, 0);
+            page->dirty = true;
+
+            Cutlass::TextureInfo ti;
+            ti.setSRTex2D(AtlasPageSize, AtlasPageSize, true);
+            if (mpContext->createTexture(ti, page->texture) != Cutlass::Result::eSuccess)
+            {
+                std::cerr << "failed to create atlas page!\n";
+                assert(!"failed to create atlas page!");
+                stbi_image_free(pImage);
+                return false;
+            }
+
+            page->packer.insert(w + Padding * 2, h + Padding * 2, x, y);
+            pPage = page.get();
+            mAtlasPages.emplace_back(std::move(page));
+        }
+
+        // 周りのPadding分は端のピクセルを延ばして埋める(線形補間で隣の画像を拾わないように)
+        const std::size_t pitch = static_cast<std::size_t>(AtlasPageSize) * 4;
+        for (std::uint32_t dy = 0; dy < h + Padding * 2; ++dy)
+        {
+            const std::uint32_t sy = std::min(std::max(dy, Padding) - Padding, h - 1);
+            std::uint8_t* pDst     = pPage->pixels.data() + (y + dy) * pitch + static_cast<std::size_t>(x) * 4;
+            const stbi_uc* pSrc    = pImage + static_cast<std::size_t>(sy) * w * 4;
+
+            for (std::uint32_t dx = 0; dx < Padding; ++dx)
+            {
+                std::memcpy(pDst + dx * 4, pSrc, 4);
+                std::memcpy(pDst + (Padding + w + dx) * 4, pSrc + (w - 1) * 4, 4);
+            }
+            std::memcpy(pDst + Padding * 4, pSrc, static_cast<std::size_t>(w) * 4);
+        }
+
+        stbi_image_free(pImage);
+        pPage->dirty = true;
+
+        const float inv   = 1.f / AtlasPageSize;
+        region_out.pPage  = pPage;
+        region_out.size   = glm::uvec2(w, h);
+        region_out.uvRect = glm::vec4((x + Padding) * inv, (y + Padding) * inv, (x + Padding + w) * inv, (y + Padding + h) * inv);
+
+        mAtlasRegionMap.emplace(strPath, region_out);
+
+        return true;
+    }
+
+    void ResourceBank::flushAtlas()
+    {
+        if (!mpContext)
+            return;
+
+        for (auto& page : mAtlasPages)
+        {
+            if (!page->dirty)
+                continue;
+
+            auto&& res = mpContext->writeTexture(page->pixels.data(), page->texture);
+            assert(res == Cutlass::Result::eSuccess || !"failed to write atlas page!");
+            page->dirty = false;
+        }
+    }
+
+    std::unique_lock<std::mutex> ResourceBank::lockContext()
+    {
+        if (!mpContextMutex)
+            return std::unique_lock<std::mutex>();
+
+        return std::unique_lock<std::mutex>(*mpContextMutex);
+    }
+
+    void ResourceBank::destroyBuffer(const Cutlass::HBuffer& handle)
+    {
+        // Graphicsはパイプライン実行時に描画スレッドが使い終わるまで破棄を遅らせる(ロックも中で取る)
+        if (mpGraphics)
+        {
+            mpGraphics->destroyBuffer(handle);
+            return;
+        }
+
+        if (!mpContext)
+            return;
+
+        auto&& lock = lockContext();
+        mpContext->destroyBuffer(handle);
+    }
+
+    void ResourceBank::destroyTexture(const Cutlass::HTexture& handle)
+    {
+        if (mpGraphics)
+        {
+            mpGraphics->destroyTexture(handle);
+            return;
+        }
+
+        if (!mpContext)
+            return;
+
+        auto&& lock = lockContext();
+        mpContext->destroyTexture(handle);
+    }
+
     void ResourceBank::processNode(const aiNode* node, Model& model_out)
     {
         auto& scene = model_out.pScene.value();
@@ -764,6 +1098,22 @@ namespace mall
             vertices.push_back(vertex);
         }
 
+        {  // 境界, 球の中心はAABBの中心とし半径は最も遠い頂点まで
+            targetMesh.aabbMin = targetMesh.aabbMax = vertices.empty() ? glm::vec3(0) : vertices.front().pos;
+            for (const auto& vertex : vertices)
+            {
+                targetMesh.aabbMin = glm::min(targetMesh.aabbMin, vertex.pos);
+                targetMesh.aabbMax = glm::max(targetMesh.aabbMax, vertex.pos);
+            }
+
+            const glm::vec3 center = (targetMesh.aabbMin + targetMesh.aabbMax) * 0.5f;
+            float radius2          = 0;
+            for (const auto& vertex : vertices)
+                radius2 = std::max(radius2, glm::dot(vertex.pos - center, vertex.pos - center));
+
+            targetMesh.boundingSphere = glm::vec4(center, std::sqrt(radius2));
+        }
+
         std::vector<VertexBoneData> vbdata;
         if (model_out.skeleton)
         {
@@ -773,6 +1123,17 @@ namespace mall
             {
                 vertices[i].joint  = glm::make_vec4(vbdata[i].id);
                 vertices[i].weight = glm::make_vec4(vbdata[i].weights);
+
+                // 動かすボーンごとに頂点の範囲を広げておく(RenderSystemが姿勢に合わせた境界を求める)
+                for (uint32_t k = 0; k < 4; ++k)
+                {
+                    if (vbdata[i].weights[k] <= 0)
+                        continue;
+
+                    auto& bone   = model_out.skeleton.value().bones[static_cast<std::size_t>(vbdata[i].id[k])];
+                    bone.aabbMin = glm::min(bone.aabbMin, vertices[i].pos);
+                    bone.aabbMax = glm::max(bone.aabbMax, vertices[i].pos);
+                }
                 // std::cerr << to_string(vertices[i].weight0) << "\n";
                 //  float sum = vertices[i].weight.x + vertices[i].weight.y + vertices[i].weight.z + vertices[i].weight.w;
                 //  assert(sum <= 1.01f);
@@ -818,6 +1179,8 @@ namespace mall
             {
                 boneIndex = skeleton_out.bones.size();
                 skeleton_out.bones.emplace_back();
+                skeleton_out.bones[boneIndex].aabbMin = glm::vec3(std::numeric_limits<float>::max());
+                skeleton_out.bones[boneIndex].aabbMax = glm::vec3(-std::numeric_limits<float>::max());
             }
             else  //あった
                 boneIndex = skeleton_out.boneMap[boneName];
@@ -874,7 +1237,11 @@ namespace mall
             MaterialData::Texture& texture = textures.emplace_back();
 
             const aiTexture* embeddedTexture = scene->GetEmbeddedTexture(path.C_Str());
-            if (embeddedTexture != nullptr)
+            if (!mpContext)
+            {
+                // ヘッドレス時はテクスチャを作らない
+            }
+            else if (embeddedTexture != nullptr)
             {
                 Cutlass::TextureInfo ti;
                 ti.setSRTex2D(embeddedTexture->mWidth, embeddedTexture->mHeight, true);
@@ -0,0 +1,516 @@
+#include "../../include/Mall/Engine/SceneBVH.hpp"
+
+#include "../../include/Mall/Utility/Frustum.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+namespace mall
+{
+    namespace
+    {
+        inline SceneBVH::AABB emptyAABB()
+        {
+            return SceneBVH::AABB{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+        }
+
+        inline void merge(SceneBVH::AABB& to, const SceneBVH::AABB& from)
+        {
+            to.min = glm::min(to.min, from.min);
+            to.max = glm::max(to.max, from.max);
+        }
+
+        // 表面積の半分(比較にしか使わないので十分)
+        inline float halfArea(const SceneBVH::AABB& aabb)
+        {
+            const glm::vec3 e = glm::max(aabb.max - aabb.min, glm::vec3(0.f));
+            return e.x * e.y + e.y * e.z + e.z * e.x;
+        }
+
+        inline bool overlaps(const SceneBVH::AABB& a, const SceneBVH::AABB& b)
+        {
+            return a.min.x <= b.max.x && b.min.x <= a.max.x
+                && a.min.y <= b.max.y && b.min.y <= a.max.y
+                && a.min.z <= b.max.z && b.min.z <= a.max.z;
+        }
+
+        // スラブ法, 交差すれば入る位置をtNearに返す
+        inline bool intersectRay(const SceneBVH::AABB& aabb, const glm::vec3& origin, const glm::vec3& invDir, const float maxT, float& tNear)
+        {
+            const glm::vec3 t0 = (aabb.min - origin) * invDir;
+            const glm::vec3 t1 = (aabb.max - origin) * invDir;
+            const glm::vec3 tMin = glm::min(t0, t1);
+            const glm::vec3 tMax = glm::max(t0, t1);
+
+            const float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.f));
+            const float exit  = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxT));
+
+            tNear = enter;
+            return enter <= exit;
+        }
+    }  // namespace
+
+    SceneBVH::AABB SceneBVH::transform(const AABB& local, const glm::mat4& world)
+    {
+        // 中心を変換し, 半径は各軸へ射影した長さの和で広げる(8頂点を変換するより安い)
+        const glm::vec3 center = (local.min + local.max) * 0.5f;
+        const glm::vec3 extent = (local.max - local.min) * 0.5f;
+
+        const glm::vec3 c = glm::vec3(world * glm::vec4(center, 1.f));
+        glm::vec3 e;
+        for (int r = 0; r < 3; ++r)
+            e[r] = std::abs(world[0][r]) * extent.x + std::abs(world[1][r]) * extent.y + std::abs(world[2][r]) * extent.z;
+
+        return AABB{ c - e, c + e };
+    }
+
+    SceneBVH::SceneBVH()
+        : mSize(0)
+        , mBuiltCost(0.f)
+        , mStructureChanged(false)
+        , mMoved(false)
+    {
+    }
+
+    SceneBVH::~SceneBVH()
+    {
+        std::cerr << "Scene BVH shut down\n";
+    }
+
+    SceneBVH::ProxyID SceneBVH::createProxy(const AABB& bounds, const std::uint32_t layer, const std::uint64_t userData, const void* owner)
+    {
+        ProxyID proxy = InvalidID;
+        if (!mFreeIDs.empty())
+        {
+            proxy = mFreeIDs.back();
+            mFreeIDs.pop_back();
+        }
+        else
+        {
+            proxy = static_cast<ProxyID>(mProxies.size());
+            mProxies.emplace_back();
+        }
+
+        mProxies[proxy]   = Proxy{ bounds, layer, userData, owner, true, true };
+        mStructureChanged = true;
+
+        ++mSize;
+
+        return proxy;
+    }
+
+    void SceneBVH::destroyProxy(const ProxyID proxy)
+    {
+        checkProxy(proxy);
+
+        // 木からはrebuildで取り除く, それまでは問い合わせで読み飛ばす
+        mProxies[proxy].alive = false;
+        mFreeIDs.emplace_back(proxy);
+        mStructureChanged = true;
+
+        --mSize;
+    }
+
+    void SceneBVH::updateProxy(const ProxyID proxy, const AABB& bounds)
+    {
+        checkProxy(proxy);
+        mProxies[proxy].marked = true;
+
+        AABB& current = mProxies[proxy].bounds;
+        if (current.min == bounds.min && current.max == bounds.max)
+            return;
+
+        current = bounds;
+        mMoved  = true;
+    }
+
+    const SceneBVH::AABB& SceneBVH::getBounds(const ProxyID proxy) const
+    {
+        checkProxy(proxy);
+        return mProxies[proxy].bounds;
+    }
+
+    void SceneBVH::setUserData(const ProxyID proxy, const std::uint64_t userData)
+    {
+        checkProxy(proxy);
+        mProxies[proxy].userData = userData;
+    }
+
+    std::uint64_t SceneBVH::getUserData(const ProxyID proxy) const
+    {
+        checkProxy(proxy);
+        return mProxies[proxy].userData;
+    }
+
+    std::size_t SceneBVH::sweep(const std::uint32_t layerMask, const void* owner)
+    {
+        std::size_t count = 0;
+        for (ProxyID proxy = 0; proxy < static_cast<ProxyID>(mProxies.size()); ++proxy)
+        {
+            auto& p = mProxies[proxy];
+            if (!p.alive || (p.layer & layerMask) == 0 || p.owner != owner)
+                continue;
+
+            if (p.marked)
+                p.marked = false;
+            else
+            {
+                destroyProxy(proxy);
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+    void SceneBVH::update()
+    {
+        if (mStructureChanged)
+        {
+            rebuild();
+            return;
+        }
+
+        if (!mMoved)
+            return;
+
+        // 移動で木の質が落ちすぎていたら作り直す
+        if (refit() > mBuiltCost * RebuildCostRatio)
+            rebuild();
+
+        mMoved = false;
+    }
+
+    void SceneBVH::queryFrustum(const Frustum& frustum, const std::uint32_t layerMask, std::vector<ProxyID>& out) const
+    {
+        if (mNodes.empty())
+            return;
+
+        // 完全に内側のノードは子孫の判定を省く
+        std::uint32_t stack[StackSize];
+        bool inside[StackSize];
+        std::size_t top = 0;
+        stack[top]      = 0;
+        inside[top++]   = false;
+
+        while (top > 0)
+        {
+            --top;
+            const Node& node = mNodes[stack[top]];
+            bool contained   = inside[top];
+
+            if (!(node.layer & layerMask))
+                continue;
+
+            if (!contained)
+            {
+                const Frustum::Result result = frustum.classify(node.bounds.min, node.bounds.max);
+                if (result == Frustum::Result::eOutside)
+                    continue;
+                contained = result == Frustum::Result::eInside;
+            }
+
+            if (node.count == 0)
+            {
+                assert(top + 2 <= StackSize);
+                stack[top]    = node.first;
+                inside[top++] = contained;
+                stack[top]    = node.first + 1;
+                inside[top++] = contained;
+                continue;
+            }
+
+            for (std::uint32_t i = 0; i < node.count; ++i)
+            {
+                const ProxyID id   = mLeafProxies[node.first + i];
+                const Proxy& proxy = mProxies[id];
+                if (!proxy.alive || !(proxy.layer & layerMask))
+                    continue;
+
+                if (contained || frustum.classify(proxy.bounds.min, proxy.bounds.max) != Frustum::Result::eOutside)
+                    out.emplace_back(id);
+            }
+        }
+    }
+
+    void SceneBVH::queryAABB(const AABB& bounds, const std::uint32_t layerMask, std::vector<ProxyID>& out) const
+    {
+        if (mNodes.empty())
+            return;
+
+        std::uint32_t stack[StackSize];
+        std::size_t top = 0;
+        stack[top++]    = 0;
+
+        while (top > 0)
+        {
+            const Node& node = mNodes[stack[--top]];
+            if (!(node.layer & layerMask) || !overlaps(node.bounds, bounds))
+                continue;
+
+            if (node.count == 0)
+            {
+                assert(top + 2 <= StackSize);
+                stack[top++] = node.first;
+                stack[top++] = node.first + 1;
+                continue;
+            }
+
+            for (std::uint32_t i = 0; i < node.count; ++i)
+            {
+                const ProxyID id   = mLeafProxies[node.first + i];
+                const Proxy& proxy = mProxies[id];
+                if (proxy.alive && (proxy.layer & layerMask) && overlaps(proxy.bounds, bounds))
+                    out.emplace_back(id);
+            }
+        }
+    }
+
+    bool SceneBVH::raycast(const glm::vec3& origin, const glm::vec3& dir, const float maxT, const std::uint32_t layerMask, RayHit& hit) const
+    {
+        if (mNodes.empty())
+            return false;
+
+        // 0除算はinfになりスラブ法ではそのまま扱える
+        const glm::vec3 invDir = 1.f / dir;
+
+        hit.proxy = InvalidID;
+        hit.t     = maxT;
+
+        std::uint32_t stack[StackSize];
+        std::size_t top = 0;
+        stack[top++]    = 0;
+
+        while (top > 0)
+        {
+            const Node& node = mNodes[stack[--top]];
+
+            float tNear = 0.f;
+            if (!(node.layer & layerMask) || !intersectRay(node.bounds, origin, invDir, hit.t, tNear))
+                continue;
+
+            if (node.count == 0)
+            {
+                // 近い方の子を先に調べると遠い方を枝刈りしやすい
+                float tLeft = 0.f, tRight = 0.f;
+                const bool left  = intersectRay(mNodes[node.first].bounds, origin, invDir, hit.t, tLeft);
+                const bool right = intersectRay(mNodes[node.first + 1].bounds, origin, invDir, hit.t, tRight);
+
+                assert(top + 2 <= StackSize);
+                if (left && right)
+                {
+                    stack[top++] = tLeft < tRight ? node.first + 1 : node.first;
+                    stack[top++] = tLeft < tRight ? node.first : node.first + 1;
+                }
+                else if (left)
+                    stack[top++] = node.first;
+                else if (right)
+                    stack[top++] = node.first + 1;
+                continue;
+            }
+
+            for (std::uint32_t i = 0; i < node.count; ++i)
+            {
+                const ProxyID id   = mLeafProxies[node.first + i];
+                const Proxy& proxy = mProxies[id];
+                if (!proxy.alive || !(proxy.layer & layerMask))
+                    continue;
+
+                float t = 0.f;
+                if (intersectRay(proxy.bounds, origin, invDir, hit.t, t) && (hit.proxy == InvalidID || t < hit.t))
+                {
+                    hit.proxy = id;
+                    hit.t     = t;
+                }
+            }
+        }
+
+        return hit.proxy != InvalidID;
+    }
+
+    std::size_t SceneBVH::size() const
+    {
+        return mSize;
+    }
+
+    void SceneBVH::rebuild()
+    {
+        mLeafProxies.clear();
+        mLeafProxies.reserve(mSize);
+        for (ProxyID id = 0; id < mProxies.size(); ++id)
+            if (mProxies[id].alive)
+                mLeafProxies.emplace_back(id);
+
+        mNodes.clear();
+        mStructureChanged = false;
+        mMoved            = false;
+
+        if (mLeafProxies.empty())
+        {
+            mBuiltCost = 0.f;
+            return;
+        }
+
+        // 内部ノード数は葉の数 - 1以下
+        mNodes.reserve(mLeafProxies.size() * 2);
+        mNodes.emplace_back();
+        build(0, 0, static_cast<std::uint32_t>(mLeafProxies.size()), 0);
+
+        mBuiltCost = refit();
+    }
+
+    void SceneBVH::build(const std::uint32_t node, const std::uint32_t begin, const std::uint32_t end, const std::uint32_t depth)
+    {
+        AABB bounds         = emptyAABB();
+        AABB centroidBounds = emptyAABB();
+        for (std::uint32_t i = begin; i < end; ++i)
+        {
+            const AABB& b = mProxies[mLeafProxies[i]].bounds;
+            merge(bounds, b);
+
+            const glm::vec3 c = (b.min + b.max) * 0.5f;
+            merge(centroidBounds, AABB{ c, c });
+        }
+
+        const std::uint32_t count = end - begin;
+        mNodes[node].bounds       = bounds;
+
+        const auto makeLeaf = [&]() {
+            mNodes[node].first = begin;
+            mNodes[node].count = count;
+        };
+
+        if (count <= MaxLeafSize || depth >= MaxDepth)
+        {
+            makeLeaf();
+            return;
+        }
+
+        // 中心の分布をBinNum個のビンに分け, 各軸の各境界で分割したときのSAHコストを比べる
+        int bestAxis            = -1;
+        std::uint32_t bestSplit = 0;
+        float bestCost          = FLT_MAX;
+
+        const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (extent[axis] <= 0.f)
+                continue;
+
+            AABB binBounds[BinNum];
+            std::uint32_t binCounts[BinNum] = {};
+            for (std::uint32_t b = 0; b < BinNum; ++b)
+                binBounds[b] = emptyAABB();
+
+            const float scale = BinNum / extent[axis];
+            for (std::uint32_t i = begin; i < end; ++i)
+            {
+                const AABB& pb        = mProxies[mLeafProxies[i]].bounds;
+                const float c         = (pb.min[axis] + pb.max[axis]) * 0.5f;
+                const std::uint32_t b = std::min(BinNum - 1, static_cast<std::uint32_t>((c - centroidBounds.min[axis]) * scale));
+                ++binCounts[b];
+                merge(binBounds[b], pb);
+            }
+
+            // 右からの累積を先に求め, 左から走査しながらコストを計算する
+            float rightAreas[BinNum];
+            std::uint32_t rightCounts[BinNum];
+            AABB acc               = emptyAABB();
+            std::uint32_t accCount = 0;
+            for (std::uint32_t b = BinNum - 1; b > 0; --b)
+            {
+                merge(acc, binBounds[b]);
+                accCount += binCounts[b];
+                rightAreas[b]  = halfArea(acc);
+                rightCounts[b] = accCount;
+            }
+
+            acc      = emptyAABB();
+            accCount = 0;
+            for (std::uint32_t b = 0; b + 1 < BinNum; ++b)
+            {
+                merge(acc, binBounds[b]);
+                accCount += binCounts[b];
+                if (accCount == 0 || rightCounts[b + 1] == 0)
+                    continue;
+
+                const float cost = halfArea(acc) * accCount + rightAreas[b + 1] * rightCounts[b + 1];
+                if (cost < bestCost)
+                {
+                    bestCost  = cost;
+                    bestAxis  = axis;
+                    bestSplit = b + 1;
+                }
+            }
+        }
+
+        std::uint32_t mid = begin + count / 2;
+        if (bestAxis >= 0)
+        {
+            const float scale = BinNum / extent[bestAxis];
+            const float base  = centroidBounds.min[bestAxis];
+            auto* const pMid  = std::partition(mLeafProxies.data() + begin, mLeafProxies.data() + end, [&](const ProxyID id) {
+                const AABB& pb = mProxies[id].bounds;
+                const float c  = (pb.min[bestAxis] + pb.max[bestAxis]) * 0.5f;
+                return std::min(BinNum - 1, static_cast<std::uint32_t>((c - base) * scale)) < bestSplit;
+            });
+            mid = static_cast<std::uint32_t>(pMid - mLeafProxies.data());
+        }
+        // 中心が全て重なっているときは順序のまま半分に分ける
+
+        const std::uint32_t children = static_cast<std::uint32_t>(mNodes.size());
+        mNodes.emplace_back();
+        mNodes.emplace_back();
+        mNodes[node].first = children;
+        mNodes[node].count = 0;
+
+        build(children, begin, mid, depth + 1);
+        build(children + 1, mid, end, depth + 1);
+    }
+
+    float SceneBVH::refit()
+    {
+        if (mNodes.empty())
+            return 0.f;
+
+        float cost = 0.f;
+
+        // 子は親より後ろにあるので, 後ろから走査すれば下から順に更新される
+        for (std::size_t i = mNodes.size(); i-- > 0;)
+        {
+            Node& node = mNodes[i];
+            if (node.count == 0)
+            {
+                const Node& left  = mNodes[node.first];
+                const Node& right = mNodes[node.first + 1];
+                node.bounds       = left.bounds;
+                merge(node.bounds, right.bounds);
+                node.layer = left.layer | right.layer;
+                cost += halfArea(node.bounds);
+                continue;
+            }
+
+            node.bounds = emptyAABB();
+            node.layer  = 0;
+            for (std::uint32_t p = 0; p < node.count; ++p)
+            {
+                const Proxy& proxy = mProxies[mLeafProxies[node.first + p]];
+                merge(node.bounds, proxy.bounds);
+                node.layer |= proxy.layer;
+            }
+            cost += halfArea(node.bounds) * node.count;
+        }
+
+        // 根の大きさで正規化する(全体が移動しても比較できるように)
+        const float rootArea = halfArea(mNodes[0].bounds);
+        return rootArea > 0.f ? cost / rootArea : 0.f;
+    }
+
+    void SceneBVH::checkProxy(const ProxyID proxy) const
+    {
+        assert((proxy < mProxies.size() && mProxies[proxy].alive) || !"invalid scene BVH proxy!");
+    }
+}  // namespace mall
@@ -0,0 +1,156 @@
+#include "../../include/Mall/Engine/SpriteBatcher.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "../../include/Mall/Engine/Graphics.hpp"
+#include "../../include/Mall/Utility/Hash.hpp"
+
+namespace mall
+{
+    SpriteBatcher::SpriteBatcher(Graphics& graphics, const std::uint32_t frameCount)
+        : mGraphics(graphics)
+        , mFrames(std::max<std::uint32_t>(frameCount, 1), Frame{ Cutlass::HBuffer(), 0 })
+        , mFrameIndex(0)
+        , mIndexCapacity(0)
+    {
+    }
+
+    SpriteBatcher::~SpriteBatcher()
+    {
+        for (auto& frame : mFrames)
+            if (frame.capacity > 0)
+                mGraphics.destroyBuffer(frame.vertexBuffer);
+
+        if (mIndexCapacity > 0)
+            mGraphics.destroyBuffer(mIndexBuffer);
+    }
+
+    void SpriteBatcher::clear()
+    {
+        mVertices.clear();
+        mBatches.clear();
+    }
+
+    void SpriteBatcher::push(const Cutlass::HTexture& texture, const void* key, const Vertex (&vertices)[4], const std::uint32_t pipeline)
+    {
+        const auto quad = static_cast<std::uint32_t>(mVertices.size() / 4);
+        mVertices.insert(mVertices.end(), vertices, vertices + 4);
+
+        if (!mBatches.empty() && mBatches.back().key == key && mBatches.back().pipeline == pipeline)
+            ++mBatches.back().quadCount;
+        else
+            mBatches.push_back({ texture, key, pipeline, quad, 1 });
+    }
+
+    std::uint64_t SpriteBatcher::hashBatches(const std::uint64_t seed) const
+    {
+        std::uint64_t hash = seed;
+        for (const auto& batch : mBatches)
+        {
+            hash = hashCombine(hash, batch.key);
+            hash = hashCombine(hash, static_cast<std::uint64_t>(batch.pipeline));
+            hash = hashCombine(hash, static_cast<std::uint64_t>(batch.firstQuad) << 32 | batch.quadCount);
+        }
+
+        return hash;
+    }
+
+    void SpriteBatcher::upload()
+    {
+        mFrameIndex = (mFrameIndex + 1) % mFrames.size();
+
+        const std::size_t quadCount = mVertices.size() / 4;
+        if (quadCount == 0)
+            return;
+
+        auto& frame = mFrames[mFrameIndex];
+        if (frame.capacity < quadCount)
+        {
+            if (frame.capacity > 0)
+                mGraphics.destroyBuffer(frame.vertexBuffer);
+
+            frame.capacity = std::max(InitialCapacity, frame.capacity * 2);
+            while (frame.capacity < quadCount)
+                frame.capacity *= 2;
+
+            Cutlass::BufferInfo bi;
+            bi.setVertexBuffer<Vertex>(frame.capacity * 4);
+            frame.vertexBuffer = mGraphics.createBuffer(bi);
+        }
+
+        // インデックスは矩形ごとに同じ並びなので, 足りなくなったときだけ作り直す
+        if (mIndexCapacity < frame.capacity)
+        {
+            if (mIndexCapacity > 0)
+                mGraphics.destroyBuffer(mIndexBuffer);
+
+            mIndexCapacity = frame.capacity;
+
+            std::vector<std::uint32_t> indices(mIndexCapacity * 6);
+            for (std::size_t i = 0; i < mIndexCapacity; ++i)
+            {
+                const auto base    = static_cast<std::uint32_t>(i * 4);
+                indices[i * 6 + 0] = base + 0;
+                indices[i * 6 + 1] = base + 2;
+                indices[i * 6 + 2] = base + 1;
+                indices[i * 6 + 3] = base + 1;
+                indices[i * 6 + 4] = base + 2;
+                indices[i * 6 + 5] = base + 3;
+            }
+
+            Cutlass::BufferInfo bi;
+            bi.setIndexBuffer<std::uint32_t>(indices.size());
+            mIndexBuffer = mGraphics.createBuffer(bi);
+            mGraphics.writeBuffer(indices.size() * sizeof(std::uint32_t), indices.data(), mIndexBuffer);
+        }
+
+        mGraphics.writeBuffer(mVertices.size() * sizeof(Vertex), mVertices.data(), frame.vertexBuffer);
+    }
+
+    void SpriteBatcher::record(Cutlass::CommandList& cl, const Cutlass::HGraphicsPipeline* pPipelines, const Cutlass::ShaderResourceSet& bufferSet) const
+    {
+        if (mBatches.empty())
+            return;
+
+        assert(pPipelines);
+        assert(mFrames[mFrameIndex].capacity * 4 >= mVertices.size() || !"sprite batch was not uploaded!");
+
+        std::uint32_t boundPipeline = ~0u;
+        for (const auto& batch : mBatches)
+        {
+            if (batch.pipeline != boundPipeline)
+            {
+                cl.bind(pPipelines[batch.pipeline]);
+                cl.bind(0, bufferSet);
+                cl.bind(mFrames[mFrameIndex].vertexBuffer, mIndexBuffer);
+                boundPipeline = batch.pipeline;
+            }
+
+            Cutlass::ShaderResourceSet textureSet;
+            textureSet.bind(0, batch.texture);
+            cl.bind(1, textureSet);
+            cl.renderIndexed(batch.quadCount * 6, 1, batch.firstQuad * 6, 0, 0);
+        }
+    }
+
+    std::size_t SpriteBatcher::getQuadCount() const
+    {
+        return mVertices.size() / 4;
+    }
+
+    std::size_t SpriteBatcher::getBatchCount() const
+    {
+        return mBatches.size();
+    }
+
+    std::size_t SpriteBatcher::getFrameIndex() const
+    {
+        return mFrameIndex;
+    }
+
+    std::size_t SpriteBatcher::getFrameCount() const
+    {
+        return mFrames.size();
+    }
+}  // namespace mall
@@ -0,0 +1,115 @@
+#include "../../include/Mall/Engine/SystemScheduler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace mall
+{
+    bool AccessSet::conflicts(const AccessSet& other) const
+    {
+        auto&& contains = [](const std::vector<std::type_index>& v, const std::type_index& type)
+        {
+            return std::find(v.begin(), v.end(), type) != v.end();
+        };
+
+        for (const auto& type : mWrites)
+            if (contains(other.mWrites, type) || contains(other.mReads, type))
+                return true;
+
+        for (const auto& type : mReads)
+            if (contains(other.mWrites, type))
+                return true;
+
+        return false;
+    }
+
+    SystemScheduler::SystemScheduler()
+        : mRemainingCapacity(0)
+    {
+    }
+
+    SystemScheduler::~SystemScheduler()
+    {
+        assert(mNodes.empty() || !"scheduled tasks were not dispatched!");
+    }
+
+    void SystemScheduler::submit(const AccessSet& access, std::function<void()>&& task)
+    {
+        assert(task);
+
+        const std::size_t index = mNodes.size();
+
+        // 先に登録された衝突するタスクの後に実行する
+        for (std::size_t i = 0; i < index; ++i)
+            if (mNodes[i].access.conflicts(access))
+                mNodes[i].successors.emplace_back(index);
+
+        mNodes.emplace_back(Node{access, std::move(task), {}});
+    }
+
+    void SystemScheduler::dispatch(JobSystem& jobSystem)
+    {
+        if (mNodes.empty())
+            return;
+
+        if (mRemainingCapacity < mNodes.size())
+        {
+            mRemainingCapacity = mNodes.size();
+            mRemaining.reset(new std::atomic<std::uint32_t>[mRemainingCapacity]);
+        }
+
+        for (std::size_t i = 0; i < mNodes.size(); ++i)
+            mRemaining[i].store(0, std::memory_order_relaxed);
+        for (const auto& node : mNodes)
+            for (const auto& s : node.successors)
+                mRemaining[s].fetch_add(1, std::memory_order_relaxed);
+
+        JobSystem::Counter counter;
+        for (std::size_t i = 0; i < mNodes.size(); ++i)
+            if (mRemaining[i].load(std::memory_order_relaxed) == 0)
+                jobSystem.submit([this, &jobSystem, &counter, i]() { run(jobSystem, counter, i); }, counter);
+
+        jobSystem.wait(counter);
+
+        mNodes.clear();
+    }
+
+    bool SystemScheduler::empty() const
+    {
+        return mNodes.empty();
+    }
+
+    void SystemScheduler::addFrameTask(const void* pOwner, const int order, std::function<void()>&& task)
+    {
+        assert(task);
+
+        auto&& iter = std::upper_bound(mFrameTasks.begin(), mFrameTasks.end(), order, [](const int order, const FrameTask& frameTask)
+                                       { return order < frameTask.order; });
+        mFrameTasks.insert(iter, FrameTask{pOwner, order, std::move(task)});
+    }
+
+    void SystemScheduler::removeFrameTasks(const void* pOwner)
+    {
+        mFrameTasks.erase(std::remove_if(mFrameTasks.begin(), mFrameTasks.end(), [pOwner](const FrameTask& frameTask)
+                                         { return frameTask.pOwner == pOwner; }),
+                          mFrameTasks.end());
+    }
+
+    void SystemScheduler::runFrameTasks()
+    {
+        for (const auto& frameTask : mFrameTasks)
+            frameTask.task();
+    }
+
+    void SystemScheduler::run(JobSystem& jobSystem, JobSystem::Counter& counter, const std::size_t index)
+    {
+        auto& node = mNodes[index];
+        node.task();
+
+        // 自身の完了前に後続を登録するので, counterが途中で0になることはない
+        for (const auto& s : node.successors)
+            if (mRemaining[s].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                jobSystem.submit([this, &jobSystem, &counter, s]() { run(jobSystem, counter, s); }, counter);
+    }
+}  // namespace mall
@@ -0,0 +1,225 @@
+#include "../../include/Mall/Engine/TransformHierarchy.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace mall
+{
+    TransformHierarchy::TransformHierarchy()
+        : mSize(0)
+        , mStructureChanged(false)
+    {
+    }
+
+    TransformHierarchy::~TransformHierarchy()
+    {
+        std::cerr << "Transform hierarchy shut down\n";
+    }
+
+    TransformHierarchy::NodeID TransformHierarchy::create(const NodeID parent)
+    {
+        NodeID node = InvalidID;
+        if (!mFreeIDs.empty())
+        {
+            node = mFreeIDs.back();
+            mFreeIDs.pop_back();
+        }
+        else
+        {
+            node = static_cast<NodeID>(mIndices.size());
+            mIndices.emplace_back(InvalidIndex);
+            mParentIDs.emplace_back(InvalidID);
+        }
+
+        // 親より後ろに追加するので並び順は崩れない
+        mParentIDs[node] = parent;
+        mIndices[node]   = static_cast<std::uint32_t>(mIDs.size());
+        mIDs.emplace_back(node);
+        mParents.emplace_back(parent == InvalidID ? InvalidIndex : static_cast<std::uint32_t>(indexOf(parent)));
+        mLocals.emplace_back(1.f);
+        mWorlds.emplace_back(1.f);
+        mDirty.emplace_back(1);
+        mChanged.emplace_back(0);
+
+        ++mSize;
+
+        return node;
+    }
+
+    void TransformHierarchy::destroy(const NodeID node)
+    {
+        const std::size_t index = indexOf(node);
+
+        for (NodeID child = 0; child < mParentIDs.size(); ++child)
+        {
+            if (mParentIDs[child] != node || mIndices[child] == InvalidIndex)
+                continue;
+
+            mParentIDs[child]         = InvalidID;
+            mParents[mIndices[child]] = InvalidIndex;
+            mDirty[mIndices[child]]   = 1;
+        }
+
+        // 詰めるのはrebuildで行う
+        mIDs[index]       = InvalidID;
+        mIndices[node]    = InvalidIndex;
+        mParentIDs[node]  = InvalidID;
+        mFreeIDs.emplace_back(node);
+        mStructureChanged = true;
+
+        --mSize;
+    }
+
+    void TransformHierarchy::setParent(const NodeID node, const NodeID parent)
+    {
+        const std::size_t index = indexOf(node);
+
+        for (NodeID ancestor = parent; ancestor != InvalidID; ancestor = mParentIDs[ancestor])
+        {
+            if (ancestor == node)
+            {
+                std::cerr << "failed to set parent : cyclic hierarchy!\n";
+                assert(!"failed to set parent : cyclic hierarchy!");
+                return;
+            }
+        }
+
+        mParentIDs[node]  = parent;
+        mParents[index]   = parent == InvalidID ? InvalidIndex : static_cast<std::uint32_t>(indexOf(parent));
+        mDirty[index]     = 1;
+        mStructureChanged = true;
+    }
+
+    TransformHierarchy::NodeID TransformHierarchy::getParent(const NodeID node) const
+    {
+        assert(node < mParentIDs.size());
+        return mParentIDs[node];
+    }
+
+    void TransformHierarchy::setLocal(const NodeID node, const glm::mat4& local)
+    {
+        const std::size_t index = indexOf(node);
+        mLocals[index]          = local;
+        mDirty[index]           = 1;
+    }
+
+    const glm::mat4& TransformHierarchy::getLocal(const NodeID node) const
+    {
+        return mLocals[indexOf(node)];
+    }
+
+    void TransformHierarchy::propagate()
+    {
+        if (mStructureChanged)
+            rebuild();
+
+        const std::size_t num = mIDs.size();
+        for (std::size_t i = 0; i < num; ++i)
+        {
+            const std::uint32_t parent = mParents[i];
+            const bool changed         = mDirty[i] || (parent != InvalidIndex && mChanged[parent]);
+
+            mChanged[i] = changed;
+            mDirty[i]   = 0;
+
+            if (!changed)
+                continue;
+
+            mWorlds[i] = parent == InvalidIndex ? mLocals[i] : mWorlds[parent] * mLocals[i];
+        }
+    }
+
+    const glm::mat4& TransformHierarchy::getWorld(const NodeID node) const
+    {
+        return mWorlds[indexOf(node)];
+    }
+
+    bool TransformHierarchy::isChanged(const NodeID node) const
+    {
+        return mChanged[indexOf(node)] != 0;
+    }
+
+    std::size_t TransformHierarchy::size() const
+    {
+        return mSize;
+    }
+
+    void TransformHierarchy::rebuild()
+    {
+        // 各ノードの深さを求める(親を辿り, 既知の深さに当たったら戻りながら埋める)
+        std::vector<std::uint32_t> depths(mParentIDs.size(), InvalidIndex);
+        std::vector<NodeID> chain;
+        std::uint32_t maxDepth = 0;
+
+        for (const NodeID id : mIDs)
+        {
+            if (id == InvalidID)
+                continue;
+
+            NodeID cur = id;
+            while (cur != InvalidID && depths[cur] == InvalidIndex)
+            {
+                chain.emplace_back(cur);
+                cur = mParentIDs[cur];
+            }
+
+            std::uint32_t depth = cur == InvalidID ? 0 : depths[cur] + 1;
+            while (!chain.empty())
+            {
+                depths[chain.back()] = depth++;
+                chain.pop_back();
+            }
+
+            maxDepth = std::max(maxDepth, depths[id]);
+        }
+
+        // 深さごとの計数ソート, 同じ深さの中では元の順序を保つ
+        std::vector<std::uint32_t> offsets(maxDepth + 2, 0);
+        for (const NodeID id : mIDs)
+            if (id != InvalidID)
+                ++offsets[depths[id] + 1];
+        for (std::size_t d = 1; d < offsets.size(); ++d)
+            offsets[d] += offsets[d - 1];
+
+        std::vector<NodeID> ids(mSize);
+        std::vector<glm::mat4> locals(mSize);
+        std::vector<glm::mat4> worlds(mSize);
+        std::vector<std::uint8_t> dirty(mSize);
+
+        for (std::size_t i = 0; i < mIDs.size(); ++i)
+        {
+            const NodeID id = mIDs[i];
+            if (id == InvalidID)
+                continue;
+
+            const std::uint32_t to = offsets[depths[id]]++;
+            ids[to]                = id;
+            locals[to]             = mLocals[i];
+            worlds[to]             = mWorlds[i];
+            dirty[to]              = mDirty[i];
+            mIndices[id]           = to;
+        }
+
+        mIDs    = std::move(ids);
+        mLocals = std::move(locals);
+        mWorlds = std::move(worlds);
+        mDirty  = std::move(dirty);
+        mChanged.assign(mSize, 0);
+
+        mParents.resize(mSize);
+        for (std::size_t i = 0; i < mSize; ++i)
+        {
+            const NodeID parent = mParentIDs[mIDs[i]];
+            mParents[i]         = parent == InvalidID ? InvalidIndex : mIndices[parent];
+        }
+
+        mStructureChanged = false;
+    }
+
+    std::size_t TransformHierarchy::indexOf(const NodeID node) const
+    {
+        assert((node < mIndices.size() && mIndices[node] != InvalidIndex) || !"invalid transform hierarchy node!");
+        return mIndices[node];
+    }
+}  // namespace mall
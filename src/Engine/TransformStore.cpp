@@ -0,0 +1,319 @@
+#include "../../include/Mall/Engine/TransformStore.hpp"
+
+#include "../../include/Mall/Utility/TransformMath.hpp"
+
+#include <cassert>
+#include <iostream>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace mall
+{
+    namespace
+    {
+        // v += a * dt を要素ごとに計算する
+        inline void madd(float* v, const float* a, const float dt, std::size_t begin, const std::size_t end)
+        {
+#if defined(__AVX__)
+            const __m256 dt8 = _mm256_set1_ps(dt);
+            for (; begin + 8 <= end; begin += 8)
+            {
+                const __m256 r = _mm256_add_ps(_mm256_loadu_ps(v + begin), _mm256_mul_ps(_mm256_loadu_ps(a + begin), dt8));
+                _mm256_storeu_ps(v + begin, r);
+            }
+#endif
+#if defined(__SSE2__)
+            const __m128 dt4 = _mm_set1_ps(dt);
+            for (; begin + 4 <= end; begin += 4)
+            {
+                const __m128 r = _mm_add_ps(_mm_loadu_ps(v + begin), _mm_mul_ps(_mm_loadu_ps(a + begin), dt4));
+                _mm_storeu_ps(v + begin, r);
+            }
+#endif
+            for (; begin < end; ++begin)
+                v[begin] += a[begin] * dt;
+        }
+    }  // namespace
+
+    void TransformStore::QuatArray::push(const glm::quat& q)
+    {
+        x.emplace_back(q.x);
+        y.emplace_back(q.y);
+        z.emplace_back(q.z);
+        w.emplace_back(q.w);
+    }
+
+    void TransformStore::QuatArray::pop()
+    {
+        x.pop_back();
+        y.pop_back();
+        z.pop_back();
+        w.pop_back();
+    }
+
+    void TransformStore::QuatArray::set(const std::size_t index, const glm::quat& q)
+    {
+        x[index] = q.x;
+        y[index] = q.y;
+        z[index] = q.z;
+        w[index] = q.w;
+    }
+
+    glm::quat TransformStore::QuatArray::get(const std::size_t index) const
+    {
+        // glm::quatのコンストラクタは(w, x, y, z)の順
+        return glm::quat(w[index], x[index], y[index], z[index]);
+    }
+
+    void TransformStore::QuatArray::move(const std::size_t from, const std::size_t to)
+    {
+        x[to] = x[from];
+        y[to] = y[from];
+        z[to] = z[from];
+        w[to] = w[from];
+    }
+
+    void TransformStore::Vec3Array::push(const glm::vec3& v)
+    {
+        x.emplace_back(v.x);
+        y.emplace_back(v.y);
+        z.emplace_back(v.z);
+    }
+
+    void TransformStore::Vec3Array::pop()
+    {
+        x.pop_back();
+        y.pop_back();
+        z.pop_back();
+    }
+
+    void TransformStore::Vec3Array::set(const std::size_t index, const glm::vec3& v)
+    {
+        x[index] = v.x;
+        y[index] = v.y;
+        z[index] = v.z;
+    }
+
+    glm::vec3 TransformStore::Vec3Array::get(const std::size_t index) const
+    {
+        return glm::vec3(x[index], y[index], z[index]);
+    }
+
+    void TransformStore::Vec3Array::move(const std::size_t from, const std::size_t to)
+    {
+        x[to] = x[from];
+        y[to] = y[from];
+        z[to] = z[from];
+    }
+
+    TransformStore::TransformStore()
+    {
+    }
+
+    TransformStore::~TransformStore()
+    {
+        std::cerr << "Transform store shut down\n";
+    }
+
+    TransformStore::ID TransformStore::create(const glm::vec3& pos, const glm::vec3& vel, const glm::vec3& acc, const glm::vec3& scale, const glm::quat& rot)
+    {
+        ID id = InvalidID;
+        if (!mFreeIDs.empty())
+        {
+            id = mFreeIDs.back();
+            mFreeIDs.pop_back();
+        }
+        else
+        {
+            id = static_cast<ID>(mIndices.size());
+            mIndices.emplace_back(InvalidID);
+            mMarks.emplace_back(0);
+            mOwners.emplace_back(nullptr);
+        }
+
+        // 作った直後のsweepでは所有者がまだ見つからないことがあるので残す
+        mMarks[id]  = 1;
+        mOwners[id] = nullptr;
+
+        mIndices[id] = static_cast<std::uint32_t>(mIDs.size());
+        mIDs.emplace_back(id);
+
+        mPos.push(pos);
+        mVel.push(vel);
+        mAcc.push(acc);
+        mScale.push(scale);
+        mRot.push(rot);
+        mWorlds.emplace_back(composeTRS(pos, rot, scale));
+
+        return id;
+    }
+
+    void TransformStore::destroy(const ID id)
+    {
+        const std::size_t index = indexOf(id);
+        const std::size_t last  = mIDs.size() - 1;
+
+        // 末尾の要素で穴を埋める
+        if (index != last)
+        {
+            mPos.move(last, index);
+            mVel.move(last, index);
+            mAcc.move(last, index);
+            mScale.move(last, index);
+            mRot.move(last, index);
+            mWorlds[index] = mWorlds[last];
+
+            mIDs[index]          = mIDs[last];
+            mIndices[mIDs[last]] = static_cast<std::uint32_t>(index);
+        }
+
+        mPos.pop();
+        mVel.pop();
+        mAcc.pop();
+        mScale.pop();
+        mRot.pop();
+        mWorlds.pop_back();
+        mIDs.pop_back();
+
+        mIndices[id] = InvalidID;
+        mFreeIDs.emplace_back(id);
+    }
+
+    void TransformStore::mark(const ID id, const void* owner)
+    {
+        assert((id < mIndices.size() && mIndices[id] != InvalidID) || !"invalid transform store ID!");
+        assert(owner || !"invalid transform store owner!");
+        mMarks[id]  = 1;
+        mOwners[id] = owner;
+    }
+
+    std::size_t TransformStore::sweep(const void* owner)
+    {
+        std::size_t destroyed = 0;
+
+        // 末尾から見ていけば, destroyで穴に移ってくるのは確認済みの要素になる
+        for (std::size_t i = mIDs.size(); i-- > 0;)
+        {
+            const ID id = mIDs[i];
+            if (mOwners[id] != owner)
+                continue;
+
+            if (mMarks[id])
+                mMarks[id] = 0;
+            else
+            {
+                destroy(id);
+                ++destroyed;
+            }
+        }
+
+        return destroyed;
+    }
+
+    std::size_t TransformStore::size() const
+    {
+        return mIDs.size();
+    }
+
+    glm::vec3 TransformStore::getPos(const ID id) const
+    {
+        return mPos.get(indexOf(id));
+    }
+
+    glm::vec3 TransformStore::getVel(const ID id) const
+    {
+        return mVel.get(indexOf(id));
+    }
+
+    glm::vec3 TransformStore::getAcc(const ID id) const
+    {
+        return mAcc.get(indexOf(id));
+    }
+
+    glm::vec3 TransformStore::getScale(const ID id) const
+    {
+        return mScale.get(indexOf(id));
+    }
+
+    glm::quat TransformStore::getRot(const ID id) const
+    {
+        return mRot.get(indexOf(id));
+    }
+
+    void TransformStore::setPos(const ID id, const glm::vec3& pos)
+    {
+        mPos.set(indexOf(id), pos);
+    }
+
+    void TransformStore::setVel(const ID id, const glm::vec3& vel)
+    {
+        mVel.set(indexOf(id), vel);
+    }
+
+    void TransformStore::setAcc(const ID id, const glm::vec3& acc)
+    {
+        mAcc.set(indexOf(id), acc);
+    }
+
+    void TransformStore::setScale(const ID id, const glm::vec3& scale)
+    {
+        mScale.set(indexOf(id), scale);
+    }
+
+    void TransformStore::setRot(const ID id, const glm::quat& rot)
+    {
+        mRot.set(indexOf(id), rot);
+    }
+
+    void TransformStore::integrate(const float deltaTime, const std::size_t begin, const std::size_t end)
+    {
+        assert(begin <= end && end <= size());
+
+        // 速度を先に更新し, 更新後の速度で位置を進める
+        madd(mVel.x.data(), mAcc.x.data(), deltaTime, begin, end);
+        madd(mVel.y.data(), mAcc.y.data(), deltaTime, begin, end);
+        madd(mVel.z.data(), mAcc.z.data(), deltaTime, begin, end);
+
+        madd(mPos.x.data(), mVel.x.data(), deltaTime, begin, end);
+        madd(mPos.y.data(), mVel.y.data(), deltaTime, begin, end);
+        madd(mPos.z.data(), mVel.z.data(), deltaTime, begin, end);
+    }
+
+    void TransformStore::integrate(const float deltaTime)
+    {
+        integrate(deltaTime, 0, size());
+    }
+
+    void TransformStore::composeWorld(const std::size_t begin, const std::size_t end)
+    {
+        assert(begin <= end && end <= size());
+
+        composeTRS(mPos.x.data() + begin, mPos.y.data() + begin, mPos.z.data() + begin,
+                   mRot.x.data() + begin, mRot.y.data() + begin, mRot.z.data() + begin, mRot.w.data() + begin,
+                   mScale.x.data() + begin, mScale.y.data() + begin, mScale.z.data() + begin,
+                   end - begin, mWorlds.data() + begin);
+    }
+
+    void TransformStore::composeWorld()
+    {
+        composeWorld(0, size());
+    }
+
+    const glm::mat4& TransformStore::getWorld(const ID id) const
+    {
+        return mWorlds[indexOf(id)];
+    }
+
+    const glm::mat4* TransformStore::getWorldData() const
+    {
+        return mWorlds.data();
+    }
+
+    std::size_t TransformStore::indexOf(const ID id) const
+    {
+        assert((id < mIndices.size() && mIndices[id] != InvalidID) || !"invalid transform store ID!");
+        return mIndices[id];
+    }
+}  // namespace mall
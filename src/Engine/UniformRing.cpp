@@ -0,0 +1,96 @@
+#include "../../include/Mall/Engine/UniformRing.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <glm/glm.hpp>
+#include <iostream>
+
+#include "../../include/Mall/Engine/Graphics.hpp"
+
+namespace mall
+{
+    UniformRing::UniformRing(Graphics& graphics, const std::size_t blockSize, const std::uint32_t frameCount)
+        : mGraphics(graphics)
+        , mBlockSize(blockSize)
+        , mFrames(std::max<std::uint32_t>(frameCount, 1))
+        , mFrameIndex(0)
+        , mBlockCount(0)
+    {
+        assert(blockSize > 0 && blockSize % 16 == 0);
+    }
+
+    UniformRing::~UniformRing()
+    {
+        for (auto& blocks : mFrames)
+            for (auto& block : blocks)
+                mGraphics.destroyBuffer(block.buffer);
+    }
+
+    void UniformRing::beginFrame()
+    {
+        mFrameIndex = (mFrameIndex + 1) % mFrames.size();
+        mBlockCount = 0;
+    }
+
+    UniformRing::Allocation UniformRing::allocate(const std::size_t size, const std::size_t alignment)
+    {
+        if (size > mBlockSize)
+        {
+            std::cerr << "uniform allocation is larger than block size!\n";
+            assert(!"uniform allocation is larger than block size!");
+        }
+
+        auto& blocks = mFrames[mFrameIndex];
+
+        std::size_t offset = 0;
+        if (mBlockCount > 0)
+        {
+            const auto& block = blocks[mBlockCount - 1];
+            offset            = (block.used + alignment - 1) / alignment * alignment;
+        }
+
+        if (mBlockCount == 0 || offset + size > mBlockSize)
+        {
+            if (mBlockCount == blocks.size())
+            {
+                Cutlass::BufferInfo bi;
+                bi.setUniformBuffer<glm::vec4>(mBlockSize / sizeof(glm::vec4));
+
+                Block block;
+                block.buffer = mGraphics.createBuffer(bi);
+                block.data.resize(mBlockSize);
+                blocks.emplace_back(std::move(block));
+            }
+
+            blocks[mBlockCount++].used = 0;
+            offset                     = 0;
+        }
+
+        auto& block = blocks[mBlockCount - 1];
+        block.used  = offset + size;
+
+        return Allocation{ block.buffer, offset, block.data.data() + offset };
+    }
+
+    void UniformRing::flush()
+    {
+        auto& blocks = mFrames[mFrameIndex];
+        for (std::size_t i = 0; i < mBlockCount; ++i)
+            mGraphics.writeBuffer(blocks[i].used, blocks[i].data.data(), blocks[i].buffer);
+    }
+
+    std::size_t UniformRing::getBlockSize() const
+    {
+        return mBlockSize;
+    }
+
+    std::size_t UniformRing::getFrameIndex() const
+    {
+        return mFrameIndex;
+    }
+
+    std::size_t UniformRing::getFrameCount() const
+    {
+        return mFrames.size();
+    }
+}  // namespace mall